@@ -0,0 +1,185 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "../src/OfflineManipulator.h"
+#include "../src/StandInBackend.h"
+
+/** Number of heap allocations of all threads */
+static atomic<unsigned long> allocations(0);
+
+/* Eigen allocates with malloc instead of new, so malloc itself is counted (glibc) */
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *memory, size_t size);
+
+    void *malloc(size_t size)
+    {
+        allocations.fetch_add(1, memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        allocations.fetch_add(1, memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *memory, size_t size)
+    {
+        allocations.fetch_add(1, memory_order_relaxed);
+        return __libc_realloc(memory, size);
+    }
+}
+
+/**
+ * Counts the allocations while the control thread streams a synchronized
+ * motion. Only the control thread works in this time, the caller sleeps.
+ *
+ * @param manipulator The manipulator
+ * @param target Target of the motion
+ * @return the number of allocations per cycle
+ */
+static double streamingAllocations(Manipulator &manipulator, const JointVector &target)
+{
+    manipulator.setAxisSynchronized(target);
+
+    CycleStatistics before;
+    CycleStatistics after;
+    manipulator.getCycleStatistics(before);
+
+    unsigned long startCount = allocations.load();
+    manipulator.waitForMotion(manipulator.lastMotion(), 10);
+    unsigned long count = allocations.load() - startCount;
+
+    manipulator.getCycleStatistics(after);
+    unsigned long cycles = after.cycles - before.cycles;
+
+    printf("Streaming:               %lu allocations in %lu cycles\n", count, cycles);
+    return (cycles > 0) ? double(count) / cycles : 0;
+}
+
+/**
+ * Counts the allocations of the calls a control loop of a caller makes,
+ * once with the fixed-size vectors and once with the dynamic ones.
+ *
+ * @param manipulator The manipulator
+ * @param iterations Number of loop iterations
+ * @return the number of allocations per iteration with fixed-size vectors
+ */
+static double callerAllocations(Manipulator &manipulator, int iterations)
+{
+    PoseVector tcp;
+    JointVector angles;
+    JointVectorDeg anglesDeg;
+    manipulator.getSensedPosition(tcp);
+
+    unsigned long startCount = allocations.load();
+    for (int n = 0; n < iterations; n++)
+    {
+        manipulator.getSensedAxis(angles);
+        manipulator.getSensedAxis(anglesDeg);
+        manipulator.getSensedPosition(tcp);
+        manipulator.setPose(tcp);
+        manipulator.setAxis(anglesDeg);
+    }
+    unsigned long fixedCount = allocations.load() - startCount;
+
+    /* Declared in the loop like the read outs of the GUI */
+    startCount = allocations.load();
+    for (int n = 0; n < iterations; n++)
+    {
+        VectorXd dynamicTcp;
+        VectorXd dynamicAngles(ARMJOINTS);
+        VectorXi dynamicAnglesDeg(ARMJOINTS);
+
+        manipulator.getSensedAxis(dynamicAngles);
+        manipulator.getSensedAxis(dynamicAnglesDeg);
+        manipulator.getSensedPosition(dynamicTcp);
+        manipulator.setPose(dynamicTcp);
+        manipulator.setAxis(dynamicAnglesDeg);
+    }
+    unsigned long dynamicCount = allocations.load() - startCount;
+
+    printf("Caller loop:             %lu allocations in %d iterations (fixed-size vectors)\n", fixedCount, iterations);
+    printf("                         %lu allocations in %d iterations (dynamic vectors)\n", dynamicCount, iterations);
+    return double(fixedCount) / iterations;
+}
+
+/**
+ * Counts the allocations of an arm, which is first moved to the candle
+ * position.
+ *
+ * @param manipulator The arm
+ * @param iterations Number of caller iterations
+ * @return true if neither the control thread nor the fixed-size calls allocate
+ */
+static bool countAllocations(Manipulator &manipulator, int iterations)
+{
+    manipulator.waitForMotion(manipulator.lastMotion(), 20);
+    manipulator.setAxis(JointVector::Zero().eval());
+    manipulator.waitForMotion(manipulator.lastMotion(), 20);
+
+    /* The first motion creates the per thread buffers, e.g. of the latency probes */
+    streamingAllocations(manipulator, JointVector::Constant(0.1));
+    double streaming = streamingAllocations(manipulator, JointVector::Constant(-0.2));
+    double caller = callerAllocations(manipulator, iterations);
+
+    printf("Per cycle / iteration:   %.3f / %.3f\n", streaming, caller);
+    return streaming == 0 && caller == 0;
+}
+
+/**
+ * Benchmark for the heap usage of the manipulator.
+ * Counts the allocations of the control thread while it streams a motion
+ * and the allocations of a caller which reads the state and sends
+ * commands in a loop. This is done for the offline manipulator and for the
+ * real Manipulator on a StandInBackend, whose control thread reads and
+ * writes the joints through the backend like with the youBot driver. The
+ * allocations of the driver itself aren't counted, the stand-in replaces it.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional number of caller iterations and config path (default ../config)
+ * @return 0 if neither the control threads nor the fixed-size calls allocate
+ */
+int main(int argc, char **argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 10000;
+    string configPath = (argc > 2) ? argv[2] : "../config";
+
+    printf("Offline manipulator:\n");
+    OfflineManipulator offline;
+    bool offlineFree = countAllocations(offline, iterations);
+
+    /* After the calibration the arm drives home */
+    printf("Manipulator with stand-in backend:\n");
+    Manipulator manipulator(new StandInBackend(), "youbot-manipulator", configPath);
+    bool backendFree = countAllocations(manipulator, iterations);
+
+    return (offlineFree && backendFree) ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "../src/ArmManager.h"
+#include "../src/StandInBackend.h"
+
+/**
+ * Runs a number of arms on stand-in backends in one manager, which move
+ * between two poses for a given time, and prints the timing of their
+ * control threads. The setpoints and readouts of all arms take the lock of
+ * the shared EtherCAT master, like on the youBot.
+ *
+ * @param count Number of arms
+ * @param seconds Duration of the run
+ * @param configPath Path to the config files
+ * @param meanJitter Receives the mean jitter of all arms in microseconds
+ * @return the number of overruns of all arms
+ */
+static unsigned long runArms(int count, double seconds, const string &configPath, double &meanJitter)
+{
+    ArmManager manager;
+    for (int i = 0; i < count; i++)
+    {
+        manager.addArm(new Manipulator(new StandInBackend(), "youbot-manipulator", configPath), "arm");
+    }
+
+    /* After the calibration the arms drive home, the run starts at the candle position */
+    vector<JointVector> targets(count, JointVector::Zero());
+    manager.waitForMotions(20);
+    manager.setAxisSynchronized(targets.data());
+    manager.waitForMotions(20);
+
+    vector<CycleStatistics> before(count);
+    manager.getCycleStatistics(before.data());
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    chrono::steady_clock::time_point end = start + chrono::milliseconds(int(seconds * 1000));
+
+    for (int n = 0; chrono::steady_clock::now() < end; n++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            targets[i].setConstant((n % 2 == 0) ? 0.2 : -0.2);
+        }
+        manager.setAxisSynchronized(targets.data());
+        manager.waitForMotions(10);
+    }
+
+    double time = chrono::duration<double, std::micro>(chrono::steady_clock::now() - start).count();
+    vector<CycleStatistics> statistics(count);
+    manager.getCycleStatistics(statistics.data());
+
+    unsigned long overruns = 0;
+    double maxCycleTime = 0;
+    double maxJitter = 0;
+    double maxExecutionTime = 0;
+    meanJitter = 0;
+
+    /* The slowest arm defines the cycle time, the execution time includes the wait for the lock */
+    for (int i = 0; i < count; i++)
+    {
+        unsigned long cycles = statistics[i].cycles - before[i].cycles;
+        maxCycleTime = max(maxCycleTime, (cycles > 0) ? time / cycles : 0.);
+        overruns += statistics[i].overruns - before[i].overruns;
+        meanJitter += statistics[i].meanJitter / count;
+        maxJitter = max(maxJitter, statistics[i].maxJitter);
+        maxExecutionTime = max(maxExecutionTime, statistics[i].maxExecutionTime);
+    }
+
+    printf("%4d   %-14s %11.1f %10.1f %10.1f %12.1f %9lu\n", count, (manager.getCore(0) < 0) ? "all" : "own core",
+           maxCycleTime, meanJitter, maxJitter, maxExecutionTime, overruns);
+    return overruns;
+}
+
+/**
+ * Benchmark for several arms in one process.
+ * Adds one arm after the other and compares the cycle time and the timing
+ * of the control threads. The arms run on stand-in backends, so their
+ * process data calls are serialized by the same lock as on the youBot.
+ * Each control thread is bound to its own core if the machine has enough
+ * cores.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional maximum number of arms, duration of each run in seconds and config path (default ../config)
+ * @return 0 if the mean jitter with all arms stays within 5 % of the cycle time of the one with one arm
+ */
+int main(int argc, char **argv)
+{
+    int maximum = (argc > 1) ? atoi(argv[1]) : 4;
+    double seconds = (argc > 2) ? atof(argv[2]) : 3;
+    string configPath = (argc > 3) ? argv[3] : "../config";
+
+    printf("Cores: %u\n", thread::hardware_concurrency());
+    printf("Arms   Control thread  Cycle [us]  Jitter [us]: mean       max.  exec. max.  Overruns\n");
+
+    double firstJitter = 0;
+    double lastJitter = 0;
+
+    for (int count = 1; count <= maximum; count++)
+    {
+        runArms(count, seconds, configPath, lastJitter);
+        firstJitter = (count == 1) ? lastJitter : firstJitter;
+    }
+    printf("Mean jitter with %d arms: %.1f us (%.1f us with one arm)\n", maximum, lastJitter, firstJitter);
+
+    return (lastJitter <= firstJitter + 0.05 * DEFAULT_CYCLE_TIME_US) ? 0 : 1;
+}
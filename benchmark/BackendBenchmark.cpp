@@ -0,0 +1,150 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "../src/Manipulator.h"
+#include "../src/StandInBackend.h"
+
+/**
+ * Drives random poses around the candle position and waits for each motion.
+ *
+ * @param manipulator The arm
+ * @param count Number of poses
+ * @return the number of motions which didn't complete
+ */
+static int runProgram(Manipulator &manipulator, int count)
+{
+    int timeouts = 0;
+
+    for (int n = 0; n < count; n++)
+    {
+        JointVector pose;
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            pose[i] = 0.6 * (rand() / (double) RAND_MAX - 0.5);
+        }
+
+        bool sent = manipulator.setAxisSynchronized(pose);
+        timeouts += (sent && manipulator.waitForMotion(manipulator.lastMotion(), 20)) ? 0 : 1;
+
+        /* Every fourth pose the gripper moves, which runs in parallel to the next motion */
+        if (n % 4 == 3)
+        {
+            manipulator.setGripper((n % 8 == 3) ? 0 : 23);
+        }
+    }
+    manipulator.waitForGripper(manipulator.lastGripper(), 10);
+
+    return timeouts;
+}
+
+/**
+ * Prints the counters of the manipulator and the backend.
+ *
+ * @param manipulator The arm
+ * @param backend The backend of the arm
+ */
+static void printStatistics(Manipulator &manipulator, StandInBackend &backend)
+{
+    CommandStatistics commands;
+    CycleStatistics cycles;
+    StandInStatistics standIn;
+    manipulator.getCommandStatistics(commands);
+    manipulator.getCycleStatistics(cycles);
+    backend.getStatistics(standIn);
+
+    printf("  Commands:              %lu (%lu failed, %lu joints skipped), latency mean %.2f us, max. %.2f us, "
+           "skew max. %.2f us\n", commands.commands, commands.failedCommands, commands.skippedJoints,
+           commands.meanLatency, commands.maxLatency, commands.maxSkew);
+    printf("  Control cycles:        %lu (%lu overruns), jitter mean %.2f us, max. %.2f us, execution max. %.2f us\n",
+           cycles.cycles, cycles.overruns, cycles.meanJitter, cycles.maxJitter, cycles.maxExecutionTime);
+    printf("  Backend:               %llu cycles, %llu joint setpoints, %llu readouts, %llu mailbox messages, "
+           "%llu faults\n", (unsigned long long) standIn.cycles, (unsigned long long) standIn.setpoints,
+           (unsigned long long) standIn.readouts, (unsigned long long) standIn.mailbox,
+           (unsigned long long) standIn.faults);
+}
+
+/**
+ * Benchmark for the real Manipulator without an arm.
+ * The Manipulator runs on a StandInBackend, so its startup, control
+ * thread, command and readback pipeline and gripper thread are the same
+ * as with the youBot. A pose program is driven once without and once with
+ * injected faults of the backend, which the manipulator has to survive.
+ * The latency histograms of the hot paths are printed at the end.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional number of poses, fault interval and config path (default ../config)
+ * @return 0 if all motions completed and the injected faults were handled
+ */
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 20;
+    int faultInterval = (argc > 2) ? atoi(argv[2]) : 100;
+    string configPath = (argc > 3) ? argv[3] : "../config";
+    srand(42);
+
+    /* The mailbox of the youBot needs some milliseconds per message */
+    StandInBackend *backend = new StandInBackend();
+    backend->setMailboxDelay(2000);
+
+    /* After the calibration the arm drives home, the program starts at the candle position */
+    Manipulator manipulator(backend, "youbot-manipulator", configPath);
+    manipulator.waitForMotion(manipulator.lastMotion(), 20);
+    manipulator.setAxisSynchronized(JointVector::Zero().eval());
+    manipulator.waitForMotion(manipulator.lastMotion(), 20);
+
+    StartupTiming startup;
+    manipulator.getStartupTiming(startup);
+    printf("Startup:                 %.3f s (commutation %.3f s, verification %.3f s, calibration %.3f s)\n",
+           startup.total, startup.commutation, startup.verification, startup.calibration);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int timeouts = runProgram(manipulator, count);
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("Program:                 %d poses in %.2f s, %d timeouts\n", count, time, timeouts);
+    printStatistics(manipulator, *backend);
+
+    /* The control thread has to go on if the connection fails now and then */
+    CommandStatistics before;
+    manipulator.getCommandStatistics(before);
+    backend->setFaultInterval(faultInterval);
+
+    start = chrono::steady_clock::now();
+    int faultTimeouts = runProgram(manipulator, count);
+    time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    backend->setFaultInterval(0);
+
+    CommandStatistics after;
+    StandInStatistics standIn;
+    manipulator.getCommandStatistics(after);
+    backend->getStatistics(standIn);
+    printf("With faults (1/%d):      %d poses in %.2f s, %d timeouts\n", faultInterval, count, time, faultTimeouts);
+    printStatistics(manipulator, *backend);
+
+    LatencyProbes::printReport(stdout);
+
+    return (timeouts == 0 && faultTimeouts == 0 && standIn.faults > 0 &&
+            after.failedCommands > before.failedCommands) ? 0 : 1;
+}
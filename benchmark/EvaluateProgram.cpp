@@ -0,0 +1,187 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "../src/MonteCarloEvaluator.h"
+#include "../src/OfflineManipulator.h"
+#include "../src/PoseProgram.h"
+
+/** Number of motions listed as worst case */
+static const int WORST_SEGMENTS = 5;
+
+/**
+ * Creates a random pick and place program. The arm picks at every fourth
+ * pose and places two poses later.
+ *
+ * @param count Number of poses
+ * @param poses List which receives the axis values
+ * @param grippers List which receives the gripper spacings
+ */
+static void createProgram(int count, vector<JointVector> &poses, vector<double> &grippers)
+{
+    srand(42);
+    poses.resize(count);
+    grippers.resize(count);
+
+    for (int n = 0; n < count; n++)
+    {
+        /* Around a pose in front of the robot, away from the singular candle position */
+        JointVector center;
+        center << 0, 0.6, -0.9, 0.9, 0;
+
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            poses[n][i] = center[i] + 0.6 * (rand() / (double) RAND_MAX - 0.5);
+        }
+        grippers[n] = (n % 4 == 1) ? 0 : (n % 4 == 3) ? 23 : numeric_limits<double>::quiet_NaN();
+    }
+}
+
+/**
+ * Prints the statistics of an evaluation.
+ *
+ * @param result The result
+ * @param threads Number of threads
+ */
+static void printResult(const EvaluationResult &result, int threads)
+{
+    const vector<double> &times = result.cycleTimes;
+    const vector<double> &throughput = result.throughput;
+    double meanTime = 0;
+    double meanThroughput = 0;
+
+    for (size_t r = 0; r < times.size(); r++)
+    {
+        meanTime += times[r] / times.size();
+    }
+    for (size_t r = 0; r < throughput.size(); r++)
+    {
+        meanThroughput += throughput[r] / throughput.size();
+    }
+
+    printf("Runs:                    %d (%d failed) on %d threads in %.2f s (%.0f runs/s)\n", result.runs, result.failed,
+           threads, result.wallTime, result.runs / result.wallTime);
+    printf("Cycle time:              mean %.3f s, 5%% %.3f s, 50%% %.3f s, 95%% %.3f s, max. %.3f s\n", meanTime,
+           EvaluationResult::percentile(times, 5), EvaluationResult::percentile(times, 50),
+           EvaluationResult::percentile(times, 95), EvaluationResult::percentile(times, 100));
+    if (throughput.empty())
+    {
+        printf("Throughput (%d picks):    n/a\n", result.picksPerCycle);
+    }
+    else
+    {
+        printf("Throughput (%d picks):    mean %.1f, 5%% %.1f, 50%% %.1f, 95%% %.1f, min. %.1f picks/hour\n",
+               result.picksPerCycle, meanThroughput, EvaluationResult::percentile(throughput, 5),
+               EvaluationResult::percentile(throughput, 50), EvaluationResult::percentile(throughput, 95),
+               EvaluationResult::percentile(throughput, 0));
+    }
+
+    /* The motions with the longest worst case */
+    vector<int> order;
+    for (size_t n = 0; n < result.worstSegments.size(); n++)
+    {
+        order.push_back(n);
+    }
+    sort(order.begin(), order.end(), [&result](int a, int b) { return result.worstSegments[a] > result.worstSegments[b]; });
+
+    printf("Worst motions:\n");
+    for (int k = 0; k < WORST_SEGMENTS && k < (int) order.size(); k++)
+    {
+        int n = order[k];
+        printf("  Pose %4d:             max. %.3f s (run %d), mean %.3f s\n", n + 1, result.worstSegments[n],
+               result.worstRuns[n], result.meanSegments[n]);
+    }
+}
+
+/**
+ * Batch tool for the Monte Carlo evaluation of a pose program.
+ * Runs the program many times on the virtual clock with varied joint
+ * limits, controller gains, arrival tolerances and tcp noise (see
+ * MonteCarloEvaluator) and prints the distribution of the cycle time and
+ * the throughput and the motions with the longest worst case.
+ *
+ * With more than one thread the evaluation is repeated on one thread to
+ * measure the speedup, both evaluations must give the same results.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional pose file ("-" for a random program), number of runs, number of threads (0 for one per core),
+ *             arm name and config path (default youbot-manipulator in ../config)
+ * @return 0 if a run was successful and the results don't depend on the number of threads
+ */
+int main(int argc, char **argv)
+{
+    string fileName = (argc > 1) ? argv[1] : "-";
+    int runs = (argc > 2) ? atoi(argv[2]) : 1000;
+    int threads = (argc > 3) ? atoi(argv[3]) : 0;
+    string armName = (argc > 4) ? argv[4] : "youbot-manipulator";
+    string configPath = (argc > 5) ? argv[5] : "../config";
+
+    SimulationParameters parameters;
+    if (!OfflineManipulator::readSimulationParameters(armName, configPath, parameters))
+    {
+        parameters = SimulationParameters();
+        printf("No config file %s/%s.cfg, using the defaults\n", configPath.c_str(), armName.c_str());
+    }
+
+    KinematicsSolver solver;
+    PoseProgram program;
+    vector<JointVector> poses;
+    vector<double> grippers;
+
+    if (fileName != "-")
+    {
+        if (!program.load(fileName, solver, JointVector::Zero()) || program.size() == 0)
+        {
+            printf("Can't read %s: %s\n", fileName.c_str(), program.getError().c_str());
+            return 1;
+        }
+        poses.assign(program.poses(), program.poses() + program.size());
+        grippers.assign(program.grippers(), program.grippers() + program.size());
+    }
+    else
+    {
+        createProgram(40, poses, grippers);
+    }
+
+    MonteCarloEvaluator evaluator(solver, threads);
+    evaluator.setSimulationParameters(parameters);
+    EvaluationResult result;
+    bool success = evaluator.evaluate(poses.data(), grippers.data(), poses.size(), runs, 42, result);
+    printResult(result, evaluator.threads());
+
+    if (evaluator.threads() > 1)
+    {
+        MonteCarloEvaluator single(solver, 1);
+        single.setSimulationParameters(parameters);
+        EvaluationResult reference;
+        single.evaluate(poses.data(), grippers.data(), poses.size(), runs, 42, reference);
+
+        double speedup = reference.wallTime / result.wallTime;
+        printf("Scaling:                 %.2f times faster than one thread (%.0f%% efficiency)\n", speedup,
+               100. * speedup / evaluator.threads());
+        success = success && (reference.cycleTimes == result.cycleTimes);
+    }
+    return success ? 0 : 1;
+}
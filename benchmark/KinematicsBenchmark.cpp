@@ -0,0 +1,274 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <eigen3/Eigen/StdVector>
+#include "../src/KinematicsSolver.h"
+#include "../src/IKCache.h"
+#include "../src/WorkerPool.h"
+#include "../src/ybparams.h"
+
+typedef vector<JointVector, aligned_allocator<JointVector> > JointVectorList;
+typedef vector<PoseVector, aligned_allocator<PoseVector> > PoseVectorList;
+
+/** Variant of the arm with a 2.5 cm longer gripper */
+struct LongGripperDH : public YouBotDH
+{
+    static constexpr double d(int joint) { return (joint == 4) ? 0.2425 : YouBotDH::d(joint); }
+};
+typedef KinematicChain<ARMJOINTS, LongGripperDH> LongGripperChain;
+
+/**
+ * Creates random joint configurations inside the datasheet limits.
+ *
+ * @param count Number of configurations
+ * @param configurations List which receives the configurations
+ */
+static void createConfigurations(int count, JointVectorList &configurations)
+{
+    srand(42);
+    configurations.resize(count);
+
+    for (int n = 0; n < count; n++)
+    {
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            double ratio = rand() / (double) RAND_MAX;
+            configurations[n][i] = BOTTOM_LIMIT_SD[i] + ratio * (TOP_LIMIT_SD[i] - BOTTOM_LIMIT_SD[i]);
+        }
+    }
+}
+
+/**
+ * Returns the elapsed time since start in nanoseconds.
+ */
+static double elapsedNs(const chrono::steady_clock::time_point &start)
+{
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Micro benchmark for the kinematics solver.
+ * Measures the mean time of the forward and inverse transformation with
+ * fixed size vectors and with the dynamic VectorXd interface.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional number of configurations
+ * @return 0 if all round trips were successful
+ */
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 100000;
+    KinematicsSolver solver;
+    JointVectorList configurations;
+    PoseVectorList poses(count);
+    createConfigurations(count, configurations);
+
+    /* Forward transformation with fixed size types */
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int n = 0; n < count; n++)
+    {
+        solver.forwardTransformation(configurations[n], poses[n]);
+    }
+    double fkNs = elapsedNs(start) / count;
+
+    /* Forward transformation with the dynamic interface */
+    double sink = 0;
+    start = chrono::steady_clock::now();
+    for (int n = 0; n < count; n++)
+    {
+        VectorXd angles = configurations[n];
+        VectorXd tcp;
+        solver.forwardTransformation(angles, tcp);
+        sink += tcp[0];
+    }
+    double fkDynamicNs = elapsedNs(start) / count;
+
+    /* Compile time chain against the generic DH loop for the same (modified) arm */
+    KinematicsSolver runtimeSolver;
+    DHParameters longGripper = runtimeSolver.getDHParameters();
+    longGripper.d[4] = LongGripperDH::d(4);
+    runtimeSolver.setDHParameters(longGripper);
+
+    Matrix4d transformation;
+    double chainError = 0;
+    start = chrono::steady_clock::now();
+    for (int n = 0; n < count; n++)
+    {
+        LongGripperChain::forward(configurations[n], transformation);
+        sink += transformation(0, 3);
+    }
+    double fkChainNs = elapsedNs(start) / count;
+
+    start = chrono::steady_clock::now();
+    for (int n = 0; n < count; n++)
+    {
+        runtimeSolver.forwardTransformation(configurations[n], transformation);
+        sink += transformation(0, 3);
+    }
+    double fkRuntimeNs = elapsedNs(start) / count;
+
+    for (int n = 0; n < count; n++)
+    {
+        Matrix4d reference;
+        runtimeSolver.forwardTransformation(configurations[n], reference);
+        LongGripperChain::forward(configurations[n], transformation);
+        for (int row = 0; row < 3; row++)
+            for (int col = 0; col < 4; col++)
+                chainError = max(chainError, fabs(reference(row, col) - transformation(row, col)));
+    }
+
+    /* Forward transformation of all configurations with the SIMD kernel */
+    vector<double> soaAngles(ARMJOINTS * count);
+    vector<double> soaPoses(6 * count);
+    const double *angleArrays[ARMJOINTS];
+    double *poseArrays[6];
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        angleArrays[i] = &soaAngles[i * count];
+        for (int n = 0; n < count; n++)
+        {
+            soaAngles[i * count + n] = configurations[n][i];
+        }
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        poseArrays[i] = &soaPoses[i * count];
+    }
+    start = chrono::steady_clock::now();
+    solver.forwardTransformation(angleArrays, count, poseArrays);
+    double fkSoaNs = elapsedNs(start) / count;
+
+    /* Compare the kernel with the DH chain (angles are compared on the circle) */
+    double maxSoaError = 0;
+    for (int n = 0; n < count; n++)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            double difference = poseArrays[i][n] - poses[n][i];
+            difference = (i < 3) ? difference : atan2(sin(difference), cos(difference));
+            maxSoaError = max(maxSoaError, fabs(difference));
+        }
+    }
+
+    /* Inverse transformation of all reachable poses */
+    int solved = 0;
+    double maxError = 0;
+    JointVector angles;
+    start = chrono::steady_clock::now();
+    for (int n = 0; n < count; n++)
+    {
+        solved += solver.inverseTransformation(poses[n], angles) ? 1 : 0;
+        sink += angles[0];
+    }
+    double ikNs = elapsedNs(start) / count;
+
+    /* Inverse transformation of all poses as one batch on all cores */
+    JointVectorList batchAngles(count);
+    unique_ptr<bool[]> batchSuccess(new bool[count]);
+    start = chrono::steady_clock::now();
+    int batchSolved = solver.inverseTransformationBatch(poses.data(), count, batchAngles.data(), batchSuccess.get());
+    double batchMs = elapsedNs(start) / 1e6;
+
+    /* The poses as program: first valid branch against the branches with the shortest travel time */
+    JointVector candle = JointVector::Zero();
+    double firstBranchTime = 0;
+    for (int n = 0; n < count; n++)
+    {
+        firstBranchTime += solver.travelTime((n == 0) ? candle : batchAngles[n - 1], batchAngles[n]);
+    }
+    JointVectorList programAngles(count);
+    double programTime = 0;
+    start = chrono::steady_clock::now();
+    int programSolved = solver.inverseTransformationSequence(poses.data(), count, candle, programAngles.data(),
+                                                             batchSuccess.get(), &programTime);
+    double programMs = elapsedNs(start) / 1e6;
+
+    /* Repeated targets (e.g. pick and place) with the IK cache */
+    KinematicsSolver cachedSolver;
+    cachedSolver.enableCache(1024);
+    int targets = min(count, 16);
+    start = chrono::steady_clock::now();
+    for (int n = 0; n < count; n++)
+    {
+        cachedSolver.inverseTransformation(poses[n % targets], angles);
+        sink += angles[0];
+    }
+    double ikCachedNs = elapsedNs(start) / count;
+    IKCacheStatistics statistics;
+    cachedSolver.getCacheStatistics(statistics);
+
+    /* Small reachable corrections (all axes moved by 0.02 rad) solved iteratively from the previous configuration */
+    int converged = 0;
+    long iterations = 0;
+    IterativeIKResult iterativeResult;
+    PoseVectorList corrections(count);
+    for (int n = 0; n < count; n++)
+    {
+        JointVector moved = configurations[n] + JointVector::Constant(0.02);
+        solver.forwardTransformation(moved, corrections[n]);
+    }
+    start = chrono::steady_clock::now();
+    for (int n = 0; n < count; n++)
+    {
+        converged += solver.inverseTransformationIterative(corrections[n], configurations[n], angles,
+                                                           IterativeIKParameters(), &iterativeResult) ? 1 : 0;
+        iterations += iterativeResult.iterations;
+        sink += angles[0];
+    }
+    double ikIterativeNs = elapsedNs(start) / count;
+
+    /* Check round trip accuracy (not timed) */
+    for (int n = 0; n < count; n++)
+    {
+        PoseVector pose;
+        if (solver.inverseTransformation(poses[n], angles) && solver.forwardTransformation(angles, pose))
+        {
+            maxError = max(maxError, (pose.head<3>() - poses[n].head<3>()).norm());
+        }
+    }
+
+    printf("Configurations:          %d\n", count);
+    printf("FK (fixed size):         %8.1f ns\n", fkNs);
+    printf("FK (VectorXd):           %8.1f ns\n", fkDynamicNs);
+    printf("FK (compile time chain): %8.1f ns (generic DH loop %.1f ns, max. deviation %g)\n", fkChainNs, fkRuntimeNs, chainError);
+    printf("FK (SoA kernel):         %8.1f ns (%.1fx faster than VectorXd)\n", fkSoaNs, fkDynamicNs / fkSoaNs);
+    printf("FK SoA max. deviation:   %g\n", maxSoaError);
+    printf("IK (fixed size):         %8.1f ns\n", ikNs);
+    printf("IK solved:               %d / %d\n", solved, count);
+    printf("IK (cache, %2d targets):  %8.1f ns (%llu hits, %llu misses)\n", targets, ikCachedNs,
+           (unsigned long long) statistics.hits, (unsigned long long) statistics.misses);
+    printf("IK (iterative, small):   %8.1f ns (%.2f iterations, %d / %d converged)\n", ikIterativeNs,
+           iterations / (double) count, converged, count);
+    printf("IK batch (%2d threads):   %8.1f ms for all poses (%d solved)\n", WorkerPool::instance().size(), batchMs, batchSolved);
+    printf("Program (first branch):  %8.1f s travel time\n", firstBranchTime);
+    printf("Program (min. travel):   %8.1f s travel time (%.1f%% less, planned in %.1f ms)\n", programTime,
+           100. * (1. - programTime / firstBranchTime), programMs);
+    printf("Max. position error:     %g m\n", maxError);
+    printf("(checksum %g)\n", sink);
+
+    return (solved == count && batchSolved == count && programSolved == count && maxSoaError < 1e-9 && chainError < 1e-9) ? 0 : 1;
+}
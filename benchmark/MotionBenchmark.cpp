@@ -0,0 +1,216 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "../src/OfflineManipulator.h"
+
+/**
+ * Timing of one run through a pose program.
+ */
+struct ProgramRun
+{
+    /** Time of the whole program in seconds */
+    double total;
+
+    /** Time from the arrival at a pose until the next pose was sent in milliseconds */
+    double meanDwell;
+    double maxDwell;
+
+    /** Number of motions which didn't complete */
+    int timeouts;
+};
+
+/** Arrival time of the latest motion in nanoseconds since the clock's epoch */
+static atomic<int64_t> arrivalTime;
+
+/**
+ * Creates random poses around the candle position.
+ *
+ * @param count Number of poses
+ * @param poses List which receives the axis values
+ */
+static void createProgram(int count, vector<VectorXd> &poses)
+{
+    srand(42);
+    poses.resize(count);
+
+    for (int n = 0; n < count; n++)
+    {
+        poses[n] = VectorXd(ARMJOINTS);
+
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            poses[n][i] = 0.6 * (rand() / (double) RAND_MAX - 0.5);
+        }
+    }
+}
+
+/**
+ * Drives all poses of a program and waits for each motion.
+ *
+ * @param manipulator The arm
+ * @param poses The poses
+ * @param pollInterval Time between two checks in milliseconds (0 waits for the arrival event)
+ * @return the timing of the run
+ */
+static ProgramRun runProgram(Manipulator &manipulator, vector<VectorXd> &poses, int pollInterval)
+{
+    ProgramRun run = ProgramRun();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (size_t n = 0; n < poses.size(); n++)
+    {
+        manipulator.setAxisSynchronized(poses[n]);
+        unsigned long motion = manipulator.lastMotion();
+        bool complete;
+
+        if (pollInterval > 0)
+        {
+            /* Like the GUI timers before, check the arrival periodically */
+            do
+            {
+                this_thread::sleep_for(chrono::milliseconds(pollInterval));
+                complete = manipulator.motionComplete(motion);
+            }
+            while (!complete && chrono::steady_clock::now() - start < chrono::seconds(600));
+        }
+        else
+        {
+            complete = manipulator.waitForMotion(motion, 10);
+        }
+
+        /* The dwell ends when the next pose could be sent */
+        chrono::steady_clock::time_point arrival(chrono::steady_clock::duration(arrivalTime.load()));
+        double dwell = chrono::duration<double, std::milli>(chrono::steady_clock::now() - arrival).count();
+
+        run.timeouts += complete ? 0 : 1;
+        run.meanDwell += dwell / poses.size();
+        run.maxDwell = max(run.maxDwell, dwell);
+    }
+    run.total = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return run;
+}
+
+/**
+ * Drives the poses of a program and opens or closes the gripper at each
+ * pose, like a pick and place program.
+ *
+ * @param manipulator The arm
+ * @param poses The poses
+ * @param overlapped true to move the gripper during the final approach, false to move it after the arrival
+ * @return the time of the program in seconds
+ */
+static double runPickAndPlace(Manipulator &manipulator, vector<VectorXd> &poses, bool overlapped)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (size_t n = 0; n < poses.size(); n++)
+    {
+        int spacing = (n % 2 == 0) ? 0 : 23;
+        manipulator.setAxisSynchronized(poses[n]);
+        unsigned long motion = manipulator.lastMotion();
+
+        if (overlapped)
+        {
+            manipulator.setGripperBeforeArrival(spacing, GRIPPER_LEAD_TIME);
+            manipulator.waitForMotion(motion, 10);
+        }
+        else
+        {
+            manipulator.waitForMotion(motion, 10);
+            manipulator.setGripper(spacing);
+        }
+        manipulator.waitForGripper(manipulator.lastGripper(), 10);
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Benchmark for the arrival detection of motions.
+ * Drives a pose program on the offline manipulator twice: once polling the
+ * arrival every 200 ms like the former GUI timers and once waiting for the
+ * arrival event of the control thread. The synchronized motions themselves
+ * take the same time in both runs, the difference is the dwell at the poses.
+ * Then a part of the program is driven as pick and place program, with the
+ * gripper moving after the arrival or during the final approach.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional number of poses and poll interval in milliseconds
+ * @return 0 if all motions completed
+ */
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 100;
+    int pollInterval = (argc > 2) ? atoi(argv[2]) : 200;
+    vector<VectorXd> poses;
+    createProgram(count, poses);
+
+    OfflineManipulator manipulator;
+    manipulator.setMotionCallback([](unsigned long)
+    {
+        arrivalTime = chrono::steady_clock::now().time_since_epoch().count();
+    });
+
+    /* Short and fast motions, so the dwell is a large part of the program */
+    SimulationParameters parameters;
+    parameters.limits.acceleration.setConstant(50);
+    parameters.limits.jerk.setConstant(2000);
+    manipulator.setSimulationParameters(parameters);
+    double predicted = 0;
+
+    for (int n = 1; n < count; n++)
+    {
+        JointVector motion[2] = {JointVector(poses[n - 1]), JointVector(poses[n])};
+        predicted += manipulator.predictCycleTime(motion, 2);
+    }
+
+    VectorXd first = poses[0];
+    manipulator.setAxis(first);
+    manipulator.waitForMotion(manipulator.lastMotion(), 10);
+    ProgramRun polled = runProgram(manipulator, poses, pollInterval);
+
+    manipulator.setAxis(first);
+    manipulator.waitForMotion(manipulator.lastMotion(), 10);
+    ProgramRun evented = runProgram(manipulator, poses, 0);
+
+    vector<VectorXd> picks(poses.begin(), poses.begin() + min(count, 10));
+    manipulator.setAxis(first);
+    manipulator.waitForMotion(manipulator.lastMotion(), 10);
+    double serialized = runPickAndPlace(manipulator, picks, false);
+    double overlapped = runPickAndPlace(manipulator, picks, true);
+
+    printf("Poses:                   %d (predicted motion time %.2f s)\n", count, predicted);
+    printf("Polling (%3d ms):        %8.2f s, dwell mean %8.3f ms, max. %8.3f ms\n", pollInterval, polled.total,
+           polled.meanDwell, polled.maxDwell);
+    printf("Arrival event:           %8.2f s, dwell mean %8.3f ms, max. %8.3f ms\n", evented.total,
+           evented.meanDwell, evented.maxDwell);
+    printf("Dwell reduction:         %8.2f s per program (%.1f%% shorter cycle)\n",
+           (polled.meanDwell - evented.meanDwell) * count / 1000., 100. * (1. - evented.total / polled.total));
+    printf("Pick and place (%2d):     %8.2f s gripper after arrival, %.2f s during approach (%.2f s per pose)\n",
+           (int) picks.size(), serialized, overlapped, (serialized - overlapped) / picks.size());
+
+    return (polled.timeouts == 0 && evented.timeouts == 0) ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include "../src/OfflineManipulator.h"
+#include "../src/PoseProgram.h"
+#include "../src/ProgramSimulator.h"
+
+/**
+ * Prints the timing of a simulated program.
+ *
+ * @param timing The timing
+ * @param wallTime Time the simulation took in seconds
+ */
+static void printTiming(const ProgramTiming &timing, double wallTime)
+{
+    printf("Poses:                   %d%s\n", (int) timing.segments.size(), timing.complete ? "" : " (a motion failed)");
+    printf("Cycle time:              %.3f s (planned motions %.3f s)\n", timing.total, timing.predicted);
+    printf("Dwell:                   mean %.3f s, max. %.3f s, total %.3f s\n", timing.meanDwell, timing.maxDwell,
+           timing.totalDwell);
+    printf("Simulated:               %llu cycles in %.3f s (%.0f times real time)\n",
+           (unsigned long long) timing.cycles, wallTime, timing.total / wallTime);
+}
+
+/**
+ * Runs a program on the virtual clock.
+ *
+ * @param simulator The simulator
+ * @param poses The poses
+ * @param grippers The gripper spacings
+ * @param count Number of poses
+ * @param timing Receives the timing
+ * @return the time the simulation took in seconds
+ */
+static double simulate(ProgramSimulator &simulator, const JointVector *poses, const double *grippers, int count,
+                       ProgramTiming &timing)
+{
+    /* The arm starts at the last pose like in a repeated program */
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    simulator.run(poses[count - 1], poses, grippers, count, timing);
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Drives a program on the offline manipulator in real time like the
+ * automatic mode of the JointController.
+ *
+ * @param manipulator The arm
+ * @param poses The poses
+ * @param grippers The gripper spacings
+ * @param count Number of poses
+ * @param overruns Receives the number of cycles the control thread skipped meanwhile
+ * @return the time of the program in seconds
+ */
+static double driveProgram(OfflineManipulator &manipulator, const JointVector *poses, const double *grippers, int count,
+                           unsigned long &overruns)
+{
+    manipulator.setAxis(poses[count - 1]);
+    manipulator.waitForMotion(manipulator.lastMotion(), 10);
+
+    CycleStatistics statistics;
+    manipulator.getCycleStatistics(statistics);
+    overruns = statistics.overruns;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (int n = 0; n < count; n++)
+    {
+        manipulator.setAxisSynchronized(poses[n]);
+        if (!std::isnan(grippers[n]))
+        {
+            manipulator.setGripperBeforeArrival((int) round(grippers[n]), GRIPPER_LEAD_TIME);
+        }
+        manipulator.waitForMotion(manipulator.lastMotion(), 20);
+        manipulator.waitForGripper(manipulator.lastGripper(), 20);
+    }
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    manipulator.getCycleStatistics(statistics);
+    overruns = statistics.overruns - overruns;
+    return time;
+}
+
+/**
+ * Estimates the cycle time of a pose program without arm and without
+ * waiting: the program runs on the virtual clock of the ProgramSimulator
+ * and the total time, the time of each motion and the dwell at the poses
+ * are printed.
+ *
+ * Without a pose file a random pick and place program is simulated. Its
+ * first poses are also driven on the offline manipulator in real time, the
+ * virtual clock has to match that time.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional pose file, arm name and config path (default youbot-manipulator in ../config)
+ * @return 0 if all poses were reached (and the virtual clock matches the real time)
+ */
+int main(int argc, char **argv)
+{
+    string fileName = (argc > 1) ? argv[1] : "";
+    string armName = (argc > 2) ? argv[2] : "youbot-manipulator";
+    string configPath = (argc > 3) ? argv[3] : "../config";
+
+    /* The joints behave like the joints of the config file if it exists */
+    SimulationParameters parameters;
+    if (!OfflineManipulator::readSimulationParameters(armName, configPath, parameters))
+    {
+        parameters = SimulationParameters();
+        printf("No config file %s/%s.cfg, using the defaults\n", configPath.c_str(), armName.c_str());
+    }
+
+    ProgramSimulator simulator;
+    simulator.setSimulationParameters(parameters);
+    ProgramTiming timing;
+
+    if (!fileName.empty())
+    {
+        KinematicsSolver solver;
+        PoseProgram program;
+
+        if (!program.load(fileName, solver, JointVector::Zero()) || program.size() == 0)
+        {
+            printf("Can't read %s: %s\n", fileName.c_str(), program.getError().c_str());
+            return 1;
+        }
+
+        double wallTime = simulate(simulator, program.poses(), program.grippers(), program.size(), timing);
+        printTiming(timing, wallTime);
+
+        for (size_t n = 0; n < timing.segments.size(); n++)
+        {
+            printf("  Pose %4d:             motion %8.3f s, dwell %8.3f s\n", (int) n + 1, timing.segments[n],
+                   timing.dwells[n]);
+        }
+        return timing.complete ? 0 : 1;
+    }
+
+    /* Random pick and place program around the candle position, about half an hour */
+    int count = 900;
+    vector<JointVector> poses(count);
+    vector<double> grippers(count);
+    srand(42);
+
+    for (int n = 0; n < count; n++)
+    {
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            poses[n][i] = 0.6 * (rand() / (double) RAND_MAX - 0.5);
+        }
+        grippers[n] = (n % 4 == 1) ? 0 : (n % 4 == 3) ? 23 : numeric_limits<double>::quiet_NaN();
+    }
+
+    double wallTime = simulate(simulator, poses.data(), grippers.data(), count, timing);
+    printTiming(timing, wallTime);
+
+    /* The first poses in real time on the offline manipulator */
+    int checked = 12;
+    ProgramTiming part;
+    simulate(simulator, poses.data(), grippers.data(), checked, part);
+
+    OfflineManipulator manipulator;
+    manipulator.setSimulationParameters(parameters);
+    unsigned long overruns;
+    double realTime = driveProgram(manipulator, poses.data(), grippers.data(), checked, overruns);
+
+    /* The offline joints only move in the cycles which ran, skipped cycles delay the real run */
+    double deviation = realTime - overruns * DEFAULT_CYCLE_TIME_US * 1e-6 - part.total;
+
+    printf("Offline manipulator:     %d poses in %.3f s (%lu skipped cycles), virtual clock %.3f s (%+.1f ms per pose)\n",
+           checked, realTime, overruns, part.total, 1000. * deviation / checked);
+
+    /* The real run additionally waits for the threads, about one cycle per pose */
+    return (timing.complete && part.complete && fabs(deviation) < 0.01 * part.total + 0.005 * checked) ? 0 : 1;
+}
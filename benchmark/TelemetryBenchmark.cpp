@@ -0,0 +1,172 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include "../src/OfflineManipulator.h"
+
+/**
+ * Measures the time the control thread spends for recording. The records
+ * are written with the cycle time of the control thread, like a recording
+ * of the real arm.
+ *
+ * @param fileName The log file
+ * @param cycles Number of cycles
+ * @param cycleTime Cycle time in microseconds
+ * @return true if the overhead is below 1 % of the cycle time and no record was dropped
+ */
+static bool measureOverhead(const string &fileName, int cycles, int cycleTime)
+{
+    TelemetryRecorder recorder;
+    if (!recorder.open(fileName, cycleTime))
+    {
+        printf("Can't create %s\n", fileName.c_str());
+        return false;
+    }
+
+    JointVector angles = JointVector::Constant(0.1);
+    JointVector velocities = JointVector::Constant(0.2);
+    JointVector currents = JointVector::Constant(0.3);
+    JointVector torques = JointVector::Constant(0.4);
+    bool changed[ARMJOINTS] = {true, true, true, true, true};
+    double meanTime = 0;
+    double maxTime = 0;
+
+    chrono::steady_clock::time_point nextCycle = chrono::steady_clock::now();
+
+    for (int n = 0; n < cycles; n++)
+    {
+        /* One command and one state per cycle, as sent and read by the control thread */
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        recorder.recordCommand(n, angles, changed);
+        recorder.recordState(n, start, angles, velocities, currents, torques);
+        double time = chrono::duration<double, std::micro>(chrono::steady_clock::now() - start).count();
+
+        meanTime += time / cycles;
+        maxTime = max(maxTime, time);
+        angles[n % ARMJOINTS] += 1e-4;
+
+        nextCycle += chrono::microseconds(cycleTime);
+        this_thread::sleep_until(nextCycle);
+    }
+    recorder.close();
+
+    RecorderStatistics statistics;
+    recorder.getStatistics(statistics);
+    double overhead = 100. * meanTime / cycleTime;
+
+    printf("Cycles:                  %d with %d us cycle time\n", cycles, cycleTime);
+    printf("Records:                 %llu (%llu dropped), %.1f MB\n", (unsigned long long) statistics.records,
+           (unsigned long long) statistics.dropped, statistics.bytes / 1e6);
+    printf("Recording per cycle:     mean %.3f us, max. %.3f us\n", meanTime, maxTime);
+    printf("Overhead:                %.4f %% of the cycle time\n", overhead);
+
+    return overhead < 1. && statistics.dropped == 0;
+}
+
+/**
+ * Records a pose program on one offline manipulator and replays the log on
+ * another one. The replayed states must match the recorded ones.
+ *
+ * @param fileName The log file
+ * @return true if all states were replayed exactly
+ */
+static bool checkReplay(const string &fileName)
+{
+    OfflineManipulator recording;
+    VectorXd pose = VectorXd::Zero(ARMJOINTS);
+    recording.setAxis(pose);
+    recording.waitForMotion(recording.lastMotion(), 10);
+
+    if (!recording.startRecording(fileName))
+    {
+        return false;
+    }
+
+    for (int n = 0; n < 3; n++)
+    {
+        pose.setConstant((n % 2 == 0) ? 0.2 : -0.1);
+        recording.setAxisSynchronized(pose);
+        recording.waitForMotion(recording.lastMotion(), 10);
+    }
+    recording.stopRecording();
+
+    TelemetryLog log;
+    if (!log.load(fileName))
+    {
+        return false;
+    }
+
+    OfflineManipulator replay;
+    replay.startReplay(fileName);
+
+    while (replay.replayActive())
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    /* The history starts with the replay, the first states are the recorded ones */
+    vector<JointStateSnapshot> history(replay.getSensedHistoryCapacity());
+    int count = replay.getSensedHistory(&history[0], history.size());
+    int states = 0;
+    int mismatches = 0;
+
+    for (size_t r = 0; r < log.size(); r++)
+    {
+        const TelemetryRecord &record = log.record(r);
+
+        if (record.type == TELEMETRY_STATE)
+        {
+            for (int i = 0; i < ARMJOINTS && states < count; i++)
+            {
+                mismatches += (history[states].angles[i] != record.values[0][i]) ? 1 : 0;
+            }
+            states++;
+        }
+    }
+
+    printf("Replay:                  %d states (%d in the history), %d mismatches\n", states, count, mismatches);
+    return states > 0 && states <= count && mismatches == 0;
+}
+
+/**
+ * Benchmark for the telemetry recorder.
+ * Measures the time the control thread needs to record a command and a
+ * state per cycle and checks that a recorded pose program is replayed
+ * exactly by the offline manipulator.
+ *
+ * @param argc Number of given arguments
+ * @param argv Optional number of cycles and the log file
+ * @return 0 if the overhead is below 1 % and the replay matches
+ */
+int main(int argc, char **argv)
+{
+    int cycles = (argc > 1) ? atoi(argv[1]) : 5000;
+    string fileName = (argc > 2) ? argv[2] : "telemetry-benchmark.ybtl";
+
+    bool overhead = measureOverhead(fileName, cycles, DEFAULT_CYCLE_TIME_US);
+    bool replay = checkReplay(fileName);
+
+    return (overhead && replay) ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ArmBackend.h"
+
+mutex ArmBackend::etherCatMutex;
+
+YouBotBackend::YouBotBackend(const string &name, const string &path)
+{
+    this->kukaArm = new YouBotManipulator(name, path);
+}
+
+YouBotBackend::~YouBotBackend()
+{
+    delete this->kukaArm;
+}
+
+void YouBotBackend::doJointCommutation()
+{
+    this->kukaArm->doJointCommutation();
+}
+
+void YouBotBackend::calibrateManipulator(bool forceCalibration)
+{
+    this->kukaArm->calibrateManipulator(forceCalibration);
+}
+
+void YouBotBackend::getConfigurationParameter(int joint, YouBotSlaveMailboxMsg &message)
+{
+    this->kukaArm->getArmJoint(joint).getConfigurationParameter(message);
+}
+
+void YouBotBackend::getJointData(vector<JointSensedAngle> &data)
+{
+    /* The driver switches the automatic receive of the master for all joints */
+    lock_guard<mutex> lock(etherCatMutex);
+    this->kukaArm->getJointData(data);
+}
+
+void YouBotBackend::getJointData(vector<JointSensedVelocity> &data)
+{
+    lock_guard<mutex> lock(etherCatMutex);
+    this->kukaArm->getJointData(data);
+}
+
+void YouBotBackend::getJointData(vector<JointSensedCurrent> &data)
+{
+    lock_guard<mutex> lock(etherCatMutex);
+    this->kukaArm->getJointData(data);
+}
+
+void YouBotBackend::getJointData(vector<JointSensedTorque> &data)
+{
+    lock_guard<mutex> lock(etherCatMutex);
+    this->kukaArm->getJointData(data);
+}
+
+void YouBotBackend::setJointData(const vector<JointAngleSetpoint> &data, const bool changed[ARMJOINTS])
+{
+    /* No other arm may switch the automatic send until all changed joints are released */
+    lock_guard<mutex> lock(etherCatMutex);
+    bool allChanged = true;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        allChanged = allChanged && changed[i];
+    }
+
+    if (allChanged)
+    {
+        /* The driver buffers all joints and releases them to the same cycle */
+        this->kukaArm->setJointData(data);
+        return;
+    }
+
+    /* Same as above for the changed joints only */
+    EthercatMaster::getInstance().AutomaticSendOn(false);
+    try
+    {
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            if (changed[i])
+            {
+                this->kukaArm->getArmJoint(i + 1).setData(data[i]);
+            }
+        }
+    }
+    catch (std::exception &e)
+    {
+        /* Never leave the communication blocked */
+        EthercatMaster::getInstance().AutomaticSendOn(true);
+        throw;
+    }
+    EthercatMaster::getInstance().AutomaticSendOn(true);
+}
+
+void YouBotBackend::setJointData(int joint, const JointVelocitySetpoint &data)
+{
+    this->kukaArm->getArmJoint(joint).setData(data);
+}
+
+void YouBotBackend::openGripper()
+{
+    this->kukaArm->getArmGripper().open();
+}
+
+void YouBotBackend::closeGripper()
+{
+    this->kukaArm->getArmGripper().close();
+}
+
+void YouBotBackend::setGripperData(const GripperBarSpacingSetPoint &data)
+{
+    this->kukaArm->getArmGripper().setData(data);
+}
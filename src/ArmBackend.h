@@ -0,0 +1,167 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ARMBACKEND_H
+#define ARMBACKEND_H
+
+#include <youbot/YouBotManipulator.hpp>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ybparams.h"
+
+using namespace std;
+using namespace youbot;
+
+/**
+ * Interface of the arm behind the Manipulator. It has the calls of the
+ * youBot API the Manipulator uses, with the data types of the driver, so
+ * the whole command and readback path of the Manipulator (unit conversion,
+ * skew measurement and exception handling) runs unchanged on every
+ * backend. Like the driver, a backend reports errors with exceptions.
+ * Joints are numbered from 1 like in the driver.
+ *
+ * @author Stefan Wilkes
+ */
+class ArmBackend
+{
+public:
+
+    /**
+     * Destructor:
+     * Releases the arm.
+     */
+    virtual ~ArmBackend() {}
+
+    /**
+     * Enables the control of the motors (see YouBotManipulator::doJointCommutation).
+     */
+    virtual void doJointCommutation() = 0;
+
+    /**
+     * Calibrates the joints (see YouBotManipulator::calibrateManipulator).
+     *
+     * @param forceCalibration Flag if calibrated joints are calibrated again
+     */
+    virtual void calibrateManipulator(bool forceCalibration) = 0;
+
+    /**
+     * Reads a parameter of a motor controller over the mailbox.
+     *
+     * @param joint Number of the joint (1 - ARMJOINTS)
+     * @param message The request, receives the reply
+     */
+    virtual void getConfigurationParameter(int joint, YouBotSlaveMailboxMsg &message) = 0;
+
+    /**
+     * Reads the latest sensed values of all joints.
+     *
+     * @param data Receives one value per joint
+     */
+    virtual void getJointData(vector<JointSensedAngle> &data) = 0;
+    virtual void getJointData(vector<JointSensedVelocity> &data) = 0;
+    virtual void getJointData(vector<JointSensedCurrent> &data) = 0;
+    virtual void getJointData(vector<JointSensedTorque> &data) = 0;
+
+    /**
+     * Sets the angles of the changed joints, which are sent in the same cycle.
+     *
+     * @param data One setpoint per joint (kuka angles)
+     * @param changed Flag for each joint if its setpoint is sent
+     */
+    virtual void setJointData(const vector<JointAngleSetpoint> &data, const bool changed[ARMJOINTS]) = 0;
+
+    /**
+     * Sets the velocity of a single joint.
+     *
+     * @param joint Number of the joint (1 - ARMJOINTS)
+     * @param data The setpoint
+     */
+    virtual void setJointData(int joint, const JointVelocitySetpoint &data) = 0;
+
+    /**
+     * Commands of the gripper.
+     */
+    virtual void openGripper() = 0;
+    virtual void closeGripper() = 0;
+    virtual void setGripperData(const GripperBarSpacingSetPoint &data) = 0;
+
+protected:
+
+    /**
+     * Serializes the process data calls (setpoints and readouts) of all
+     * backends of the process, whose arms share one EtherCAT master.
+     */
+    static mutex etherCatMutex;
+};
+
+/**
+ * The youBot arm, which is connected over EtherCAT by the youBot API.
+ *
+ * The driver has one EtherCAT master per process. Setpoints of several
+ * joints are released to the same cycle by switching off the automatic
+ * send of this master, and readouts switch off its automatic receive.
+ * These switches aren't per arm, so all backends of a process serialize
+ * their process data calls with etherCatMutex. Otherwise another arm could
+ * release a half written batch.
+ *
+ * @author Stefan Wilkes
+ */
+class YouBotBackend : public ArmBackend
+{
+public:
+
+    /**
+     * Constructor:
+     * Connects to the arm.
+     *
+     * @param name The name of the config file (without ".cfg")
+     * @param path The path to the config file
+     */
+    YouBotBackend(const string &name, const string &path);
+
+    /**
+     * Destructor:
+     * Releases the arm.
+     */
+    virtual ~YouBotBackend();
+
+    virtual void doJointCommutation();
+    virtual void calibrateManipulator(bool forceCalibration);
+    virtual void getConfigurationParameter(int joint, YouBotSlaveMailboxMsg &message);
+    virtual void getJointData(vector<JointSensedAngle> &data);
+    virtual void getJointData(vector<JointSensedVelocity> &data);
+    virtual void getJointData(vector<JointSensedCurrent> &data);
+    virtual void getJointData(vector<JointSensedTorque> &data);
+    virtual void setJointData(const vector<JointAngleSetpoint> &data, const bool changed[ARMJOINTS]);
+    virtual void setJointData(int joint, const JointVelocitySetpoint &data);
+    virtual void openGripper();
+    virtual void closeGripper();
+    virtual void setGripperData(const GripperBarSpacingSetPoint &data);
+
+private:
+
+    /** Member Object for the youBot API for arm communication */
+    YouBotManipulator *kukaArm;
+};
+
+#endif // ARMBACKEND_H
@@ -0,0 +1,151 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ArmManager.h"
+#include <chrono>
+#include <thread>
+
+ArmManager::ArmManager()
+{
+}
+
+ArmManager::~ArmManager()
+{
+    for (size_t i = 0; i < this->arms.size(); i++)
+    {
+        delete this->arms[i].manipulator;
+    }
+}
+
+bool ArmManager::addArm(const string &name, const string &path, bool forceCalibration, int core)
+{
+    Manipulator *manipulator;
+
+    try
+    {
+        manipulator = new Manipulator(name, path, path + "/" + name + ".state", forceCalibration);
+    }
+    catch (std::exception &e)
+    {
+        return false;
+    }
+
+    this->addArm(manipulator, name, core);
+    return true;
+}
+
+int ArmManager::addArm(Manipulator *manipulator, const string &name, int core)
+{
+    Arm arm;
+    arm.manipulator = manipulator;
+    arm.name = name;
+    arm.core = (core < 0) ? this->nextCore() : core;
+
+    /* Without permission the thread keeps running on all cores */
+    if (!manipulator->setControlCore(arm.core))
+    {
+        arm.core = -1;
+    }
+    this->arms.push_back(arm);
+
+    return this->arms.size() - 1;
+}
+
+int ArmManager::size() const
+{
+    return this->arms.size();
+}
+
+Manipulator *ArmManager::getArm(int index)
+{
+    return this->arms[index].manipulator;
+}
+
+const string &ArmManager::getName(int index) const
+{
+    return this->arms[index].name;
+}
+
+int ArmManager::getCore(int index) const
+{
+    return this->arms[index].core;
+}
+
+void ArmManager::getSensedStates(JointStateSnapshot *states)
+{
+    for (size_t i = 0; i < this->arms.size(); i++)
+    {
+        this->arms[i].manipulator->getSensedState(states[i]);
+    }
+}
+
+void ArmManager::getCycleStatistics(CycleStatistics *statistics)
+{
+    for (size_t i = 0; i < this->arms.size(); i++)
+    {
+        this->arms[i].manipulator->getCycleStatistics(statistics[i]);
+    }
+}
+
+bool ArmManager::setAxis(const JointVector *targets)
+{
+    bool success = true;
+
+    for (size_t i = 0; i < this->arms.size(); i++)
+    {
+        success = this->arms[i].manipulator->setAxis(targets[i]) && success;
+    }
+    return success;
+}
+
+bool ArmManager::setAxisSynchronized(const JointVector *targets)
+{
+    bool success = true;
+
+    for (size_t i = 0; i < this->arms.size(); i++)
+    {
+        success = this->arms[i].manipulator->setAxisSynchronized(targets[i]) && success;
+    }
+    return success;
+}
+
+bool ArmManager::waitForMotions(double timeout)
+{
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() +
+        chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout));
+    bool complete = true;
+
+    for (size_t i = 0; i < this->arms.size() && complete; i++)
+    {
+        double remaining = chrono::duration<double>(deadline - chrono::steady_clock::now()).count();
+        Manipulator *manipulator = this->arms[i].manipulator;
+        complete = manipulator->waitForMotion(manipulator->lastMotion(), max(remaining, 0.));
+    }
+    return complete;
+}
+
+int ArmManager::nextCore() const
+{
+    int cores = thread::hardware_concurrency();
+
+    return (cores > 1) ? (this->arms.size() % (cores - 1)) + 1 : -1;
+}
@@ -0,0 +1,180 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ARMMANAGER_H
+#define ARMMANAGER_H
+
+#include <string>
+#include <vector>
+#include "Manipulator.h"
+
+using namespace std;
+
+/**
+ * An object of this class runs several youBot arms in one process.
+ *
+ * Each arm is a Manipulator with its own control thread, which is bound to
+ * its own core, so the cycle time of an arm doesn't depend on the number of
+ * arms. The first core is left for the GUI and the EtherCAT thread of the
+ * driver. The driver has one EtherCAT master per process, so all arms are
+ * slaves of the same bus and each config file selects the joints of one arm.
+ * The setpoints and readouts of all arms switch this master, so they are
+ * serialized by one lock of the process (see ArmBackend) and a control
+ * thread can wait for the process data call of another arm.
+ *
+ * The manager reads the states and sends the commands of all arms at once,
+ * a single arm is accessed by getArm(). All commands must be given by one
+ * thread.
+ *
+ * @author Stefan Wilkes
+ */
+class ArmManager
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates a manager without arms.
+     */
+    ArmManager();
+
+    /**
+     * Destructor:
+     * Stops and deletes all arms.
+     */
+    ~ArmManager();
+
+    /**
+     * Connects an arm. The calibration state is kept in <name>.state next to
+     * the config file.
+     *
+     * @param name The name of the config file of the arm (without ".cfg")
+     * @param path The path to the config file
+     * @param forceCalibration Flag if the arm is calibrated in any case
+     * @param core Core of the control thread (-1 for the next free core)
+     * @return true if the arm is connected
+     */
+    bool addArm(const string &name, const string &path, bool forceCalibration = false, int core = -1);
+
+    /**
+     * Adds an existing arm, e.g. an offline simulator. The manager deletes it.
+     *
+     * @param manipulator The arm
+     * @param name Name of the arm
+     * @param core Core of the control thread (-1 for the next free core)
+     * @return the index of the arm
+     */
+    int addArm(Manipulator *manipulator, const string &name, int core = -1);
+
+    /**
+     * Returns the number of arms.
+     *
+     * @return the number of arms
+     */
+    int size() const;
+
+    /**
+     * Returns an arm.
+     *
+     * @param index Index of the arm (0 - size() - 1)
+     * @return the arm
+     */
+    Manipulator *getArm(int index);
+
+    /**
+     * Returns the name of an arm.
+     *
+     * @param index Index of the arm (0 - size() - 1)
+     * @return the name of the config file of the arm
+     */
+    const string &getName(int index) const;
+
+    /**
+     * Returns the core the control thread of an arm runs on.
+     *
+     * @param index Index of the arm (0 - size() - 1)
+     * @return the core (-1 for all cores)
+     */
+    int getCore(int index) const;
+
+    /**
+     * Returns the latest sensed states of all arms.
+     *
+     * @param states Array which receives one state per arm
+     */
+    void getSensedStates(JointStateSnapshot *states);
+
+    /**
+     * Returns the timing of the control threads of all arms.
+     *
+     * @param statistics Array which receives the timing of each arm
+     */
+    void getCycleStatistics(CycleStatistics *statistics);
+
+    /**
+     * Sends an axis command to every arm.
+     *
+     * @param targets Array with the angles of each arm in radian
+     * @return true if all arms accepted their command
+     */
+    bool setAxis(const JointVector *targets);
+
+    /**
+     * Sends a synchronized motion to every arm (see Manipulator::setAxisSynchronized).
+     *
+     * @param targets Array with the angles of each arm in radian
+     * @return true if all arms accepted their motion
+     */
+    bool setAxisSynchronized(const JointVector *targets);
+
+    /**
+     * Blocks until all arms completed their latest motion.
+     *
+     * @param timeout Maximum time to wait in seconds
+     * @return true if all motions are complete
+     */
+    bool waitForMotions(double timeout);
+
+private:
+
+    /**
+     * One arm of the manager.
+     */
+    struct Arm
+    {
+        Manipulator *manipulator;
+        string name;
+        int core;
+    };
+
+    /**
+     * Returns the core for the next arm.
+     *
+     * @return the core, the first one is left for the GUI and the driver
+     */
+    int nextCore() const;
+
+    /** All arms in the order they were added */
+    vector<Arm> arms;
+};
+
+#endif // ARMMANAGER_H
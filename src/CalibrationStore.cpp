@@ -0,0 +1,140 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "CalibrationStore.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CalibrationStore::CalibrationStore() : file(-1), state(NULL)
+{
+}
+
+CalibrationStore::~CalibrationStore()
+{
+    this->close();
+}
+
+bool CalibrationStore::open(const string &fileName)
+{
+    this->close();
+
+    this->file = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (this->file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    bool sized = (fstat(this->file, &status) == 0) &&
+                 (status.st_size == sizeof(CalibrationState) || ftruncate(this->file, sizeof(CalibrationState)) == 0);
+
+    void *mapping = sized ? mmap(NULL, sizeof(CalibrationState), PROT_READ | PROT_WRITE, MAP_SHARED, this->file, 0)
+                          : MAP_FAILED;
+    if (mapping == MAP_FAILED)
+    {
+        ::close(this->file);
+        this->file = -1;
+        return false;
+    }
+    this->state = static_cast<CalibrationState *>(mapping);
+
+    /* A new file or one of another version never counts as calibrated */
+    if (memcmp(this->state->magic, "YBCS", 4) != 0 || this->state->version != CALIBRATION_STATE_VERSION ||
+        this->state->joints != ARMJOINTS)
+    {
+        memset(this->state, 0, sizeof(CalibrationState));
+        memcpy(this->state->magic, "YBCS", 4);
+        this->state->version = CALIBRATION_STATE_VERSION;
+        this->state->joints = ARMJOINTS;
+    }
+    return true;
+}
+
+void CalibrationStore::close()
+{
+    if (this->state != NULL)
+    {
+        munmap(this->state, sizeof(CalibrationState));
+        ::close(this->file);
+    }
+    this->file = -1;
+    this->state = NULL;
+}
+
+bool CalibrationStore::isOpen() const
+{
+    return this->state != NULL;
+}
+
+bool CalibrationStore::load(JointVector &angles) const
+{
+    /* An odd sequence means the process ended while the angles were written */
+    if (this->state == NULL || this->state->calibrated != 1 || (this->state->sequence & 1) != 0 ||
+        this->state->cycle == 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        angles[i] = this->state->angles[i];
+    }
+    return true;
+}
+
+void CalibrationStore::setCalibrated(bool calibrated)
+{
+    if (this->state != NULL)
+    {
+        this->state->calibrated = calibrated ? 1 : 0;
+        this->state->cycle = 0;
+
+        /* The flag must be in the file before the arm moves */
+        msync(this->state, sizeof(CalibrationState), MS_SYNC);
+    }
+}
+
+void CalibrationStore::update(uint64_t cycle, const JointVector &angles)
+{
+    if (this->state == NULL)
+    {
+        return;
+    }
+
+    this->state->sequence++;
+    atomic_signal_fence(memory_order_seq_cst);
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        this->state->angles[i] = angles[i];
+    }
+    this->state->cycle = cycle + 1;
+    this->state->time = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+
+    atomic_signal_fence(memory_order_seq_cst);
+    this->state->sequence++;
+}
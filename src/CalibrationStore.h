@@ -0,0 +1,152 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CALIBRATIONSTORE_H
+#define CALIBRATIONSTORE_H
+
+#include <stdint.h>
+#include <string>
+#include "KinematicsSolver.h"
+
+using namespace std;
+
+/** Version of the state file, increment on every layout change */
+#define CALIBRATION_STATE_VERSION 1
+
+/**
+ * Content of the calibration state file.
+ */
+struct CalibrationState
+{
+    /** Always "YBCS" */
+    char magic[4];
+
+    /** Format version (CALIBRATION_STATE_VERSION) */
+    uint32_t version;
+
+    /** Number of joints */
+    uint32_t joints;
+
+    /** 1 if the angles belong to a calibrated arm */
+    uint32_t calibrated;
+
+    /** Odd while the angles are written */
+    uint32_t sequence;
+
+    /** Unused, always 0 */
+    uint32_t reserved;
+
+    /** Number of the cycle which wrote the angles plus 1, 0 if none was written since the calibration */
+    uint64_t cycle;
+
+    /** Time of the latest update in nanoseconds since 1970 */
+    int64_t time;
+
+    /** Latest sensed angles in radian (0 is centered) */
+    double angles[ARMJOINTS];
+};
+
+/**
+ * An object of this class keeps the latest sensed angles of a calibrated
+ * arm in a small memory mapped file. The control thread writes the angles
+ * in every cycle without a system call. The kernel keeps the pages of the
+ * file if the program crashes, so the next start finds the angles the arm
+ * had when the process ended and can compare them with the encoders.
+ *
+ * The motor controllers keep their encoder values as long as they are
+ * powered. If the encoders still match the stored angles, the arm needs
+ * neither a calibration nor a drive to the home position.
+ *
+ * @author Stefan Wilkes
+ */
+class CalibrationStore
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates a store without file.
+     */
+    CalibrationStore();
+
+    /**
+     * Destructor:
+     * Closes the file.
+     */
+    ~CalibrationStore();
+
+    /**
+     * Opens the state file, it is created if it doesn't exist. A file with
+     * another format is reset to an uncalibrated state.
+     *
+     * @param fileName The state file
+     * @return true if the file could be mapped
+     */
+    bool open(const string &fileName);
+
+    /**
+     * Closes the state file, the latest angles stay in the file.
+     */
+    void close();
+
+    /**
+     * Checks if a file is open.
+     *
+     * @return true if the angles are stored
+     */
+    bool isOpen() const;
+
+    /**
+     * Reads the stored angles.
+     *
+     * @param angles Receives the angles in radian (0 is centered)
+     * @return true if the file holds complete angles of a calibrated arm
+     */
+    bool load(JointVector &angles) const;
+
+    /**
+     * Marks the stored angles as calibrated or not. Must not be called
+     * while the control thread updates the angles.
+     *
+     * @param calibrated true after a calibration, false before a calibration
+     */
+    void setCalibrated(bool calibrated);
+
+    /**
+     * Stores the sensed angles of a cycle. Must only be called by the
+     * control thread.
+     *
+     * @param cycle Number of the cycle
+     * @param angles Sensed angles in radian (0 is centered)
+     */
+    void update(uint64_t cycle, const JointVector &angles);
+
+private:
+
+    /** Descriptor of the state file */
+    int file;
+
+    /** The mapped file */
+    CalibrationState *state;
+};
+
+#endif // CALIBRATIONSTORE_H
@@ -0,0 +1,161 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "IKCache.h"
+#include <cmath>
+
+bool IKCache::Key::operator==(const Key &other) const
+{
+    bool equal = true;
+
+    for (int i = 0; i < 6 && equal; i++)
+    {
+        equal = (this->cell[i] == other.cell[i]);
+    }
+    return equal;
+}
+
+size_t IKCache::KeyHash::operator()(const Key &key) const
+{
+    /* FNV-1a over the six cells */
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (int i = 0; i < 6; i++)
+    {
+        hash ^= (uint32_t) key.cell[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+IKCache::IKCache(size_t capacity, double positionResolution, double orientationResolution) :
+    currentGeneration(0), hits(0), misses(0)
+{
+    this->capacity = (capacity > 0) ? capacity : 1;
+    this->positionScale = 1. / positionResolution;
+    this->orientationScale = 1. / orientationResolution;
+    this->index.reserve(this->capacity);
+}
+
+bool IKCache::lookup(const PoseVector &tcp, JointVector solutions[MAX_IK_SOLUTIONS], int &count)
+{
+    Key key = this->quantize(tcp);
+    unique_lock<mutex> lock(this->cacheMutex);
+
+    /* Another pose in the same cell is a miss */
+    unordered_map<Key, list<Entry>::iterator, KeyHash>::iterator found = this->index.find(key);
+    bool hit = (found != this->index.end()) && (found->second->tcp == tcp);
+
+    if (hit)
+    {
+        /* Move the entry to the front (most recently used) */
+        this->entries.splice(this->entries.begin(), this->entries, found->second);
+        const Entry &entry = *found->second;
+        count = entry.count;
+
+        for (int i = 0; i < count; i++)
+        {
+            solutions[i] = entry.solutions[i];
+        }
+        this->hits++;
+    }
+    else
+    {
+        this->misses++;
+    }
+    return hit;
+}
+
+void IKCache::insert(const PoseVector &tcp, const JointVector solutions[MAX_IK_SOLUTIONS], int count, uint64_t generation)
+{
+    Key key = this->quantize(tcp);
+    unique_lock<mutex> lock(this->cacheMutex);
+
+    /* Solutions of outdated parameters and poses solved in parallel are dropped */
+    unordered_map<Key, list<Entry>::iterator, KeyHash>::iterator found = this->index.find(key);
+    if (generation != this->currentGeneration || (found != this->index.end() && found->second->tcp == tcp))
+    {
+        return;
+    }
+
+    /* The latest pose of a cell replaces the older one, otherwise the least recently used entry is reused if the cache is full */
+    if (found != this->index.end())
+    {
+        this->entries.splice(this->entries.begin(), this->entries, found->second);
+    }
+    else if (this->entries.size() >= this->capacity)
+    {
+        this->index.erase(this->entries.back().key);
+        this->entries.splice(this->entries.begin(), this->entries, --this->entries.end());
+    }
+    else
+    {
+        this->entries.emplace_front();
+    }
+
+    Entry &entry = this->entries.front();
+    entry.key = key;
+    entry.tcp = tcp;
+    entry.count = count;
+
+    for (int i = 0; i < count; i++)
+    {
+        entry.solutions[i] = solutions[i];
+    }
+    this->index[key] = this->entries.begin();
+}
+
+void IKCache::invalidate()
+{
+    unique_lock<mutex> lock(this->cacheMutex);
+    this->entries.clear();
+    this->index.clear();
+    this->currentGeneration++;
+}
+
+uint64_t IKCache::generation() const
+{
+    return this->currentGeneration;
+}
+
+IKCacheStatistics IKCache::statistics() const
+{
+    IKCacheStatistics statistics;
+    unique_lock<mutex> lock(this->cacheMutex);
+    statistics.hits = this->hits;
+    statistics.misses = this->misses;
+    statistics.size = this->entries.size();
+    statistics.capacity = this->capacity;
+    return statistics;
+}
+
+IKCache::Key IKCache::quantize(const PoseVector &tcp) const
+{
+    Key key;
+
+    for (int i = 0; i < 6; i++)
+    {
+        double scale = (i < 3) ? this->positionScale : this->orientationScale;
+        key.cell[i] = (int32_t) floor(tcp[i] * scale + 0.5);
+    }
+    return key;
+}
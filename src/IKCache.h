@@ -0,0 +1,172 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef IKCACHE_H
+#define IKCACHE_H
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include "KinematicsSolver.h"
+
+/**
+ * Counters of an IK cache.
+ */
+struct IKCacheStatistics
+{
+    /** Number of lookups which found an entry */
+    uint64_t hits;
+
+    /** Number of lookups without an entry */
+    uint64_t misses;
+
+    /** Number of stored entries */
+    size_t size;
+
+    /** Maximum number of entries */
+    size_t capacity;
+};
+
+/**
+ * An object of this class stores the inverse kinematics solutions of
+ * recently requested poses (least recently used entries are dropped).
+ *
+ * The poses are quantized to a configurable resolution to find their entry,
+ * each cell holds the latest pose which was solved in it. A lookup only hits
+ * if the exact pose is stored, so the solutions (or an unreachable result)
+ * always belong to the requested pose. The cache is thread safe. Every entry belongs to a generation of the solver
+ * parameters, entries of older generations are never returned.
+ *
+ * @author Stefan Wilkes
+ */
+class IKCache
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an empty cache.
+     *
+     * @param capacity Maximum number of entries
+     * @param positionResolution Quantization of X, Y and Z in meter
+     * @param orientationResolution Quantization of roll, pitch and yaw in radian
+     */
+    IKCache(size_t capacity, double positionResolution, double orientationResolution);
+
+    /**
+     * Searches the solutions of a pose.
+     *
+     * @param tcp The pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @param solutions Array which receives the stored solutions
+     * @param count Receives the number of solutions (0 if the pose is unreachable)
+     * @return true if the pose was found
+     */
+    bool lookup(const PoseVector &tcp, JointVector solutions[MAX_IK_SOLUTIONS], int &count);
+
+    /**
+     * Stores the solutions of a pose, they replace another pose in the same
+     * cell. The entry is dropped if the parameters have changed since the
+     * solutions were calculated.
+     *
+     * @param tcp The pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @param solutions The solutions to store
+     * @param count Number of solutions
+     * @param generation Generation of the parameters used for solving
+     */
+    void insert(const PoseVector &tcp, const JointVector solutions[MAX_IK_SOLUTIONS], int count, uint64_t generation);
+
+    /**
+     * Removes all entries and starts a new generation.
+     */
+    void invalidate();
+
+    /**
+     * Returns the current parameter generation.
+     *
+     * @return the generation
+     */
+    uint64_t generation() const;
+
+    /**
+     * Returns the counters of the cache.
+     *
+     * @return hit and miss counters and the fill state
+     */
+    IKCacheStatistics statistics() const;
+
+private:
+
+    /** Quantized pose */
+    struct Key
+    {
+        int32_t cell[6];
+
+        bool operator==(const Key &other) const;
+    };
+
+    /** Hash function for quantized poses */
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    /** Cached solutions of one quantized pose */
+    struct Entry
+    {
+        Key key;
+        PoseVector tcp;
+        int count;
+        JointVector solutions[MAX_IK_SOLUTIONS];
+    };
+
+    /**
+     * Quantizes a pose to the cache resolution.
+     */
+    Key quantize(const PoseVector &tcp) const;
+
+    /** Entries, the most recently used entry is at the front */
+    list<Entry> entries;
+
+    /** Index of the entries */
+    unordered_map<Key, list<Entry>::iterator, KeyHash> index;
+
+    /** Maximum number of entries */
+    size_t capacity;
+
+    /** Inverse quantization steps (position, orientation) */
+    double positionScale;
+    double orientationScale;
+
+    /** Generation of the parameters */
+    atomic<uint64_t> currentGeneration;
+
+    /** Counters */
+    atomic<uint64_t> hits;
+    atomic<uint64_t> misses;
+
+    /** Protects the entries and the index */
+    mutable mutex cacheMutex;
+};
+
+#endif // IKCACHE_H
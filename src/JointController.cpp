@@ -28,6 +28,7 @@
 #include <QProgressDialog>
 #include <QApplication>
 #include <QThread>
+#include <memory>
 
 JointController::JointController(Manipulator *manipulator, QWidget *parent) :
     QMainWindow(parent),
@@ -67,6 +68,14 @@ JointController::JointController(Manipulator *manipulator, QWidget *parent) :
     this->automaticModeTimer = new QTimer(this);
     this->connect(this->automaticModeTimer, SIGNAL(timeout()), this, SLOT(automaticModeTimeout()));
     this->automaticModePoseIndex = 0;
+    this->predictedCycleTime = 0;
+    this->gripperMoved = false;
+
+    /* The next pose is sent on arrival of the previous one instead of polling */
+    this->connect(this, SIGNAL(motionCompleted()), this, SLOT(automaticModeNextPose()), Qt::QueuedConnection);
+    this->manipulator->setMotionCallback([this](unsigned long) { emit this->motionCompleted(); });
+    this->connect(this, SIGNAL(gripperCompleted()), this, SLOT(automaticModeNextPose()), Qt::QueuedConnection);
+    this->manipulator->setGripperCallback([this](unsigned long) { emit this->gripperCompleted(); });
 
     /* Refresh GUI to obtain current slider position */
     this->refreshGuiState();
@@ -74,6 +83,8 @@ JointController::JointController(Manipulator *manipulator, QWidget *parent) :
 
 JointController::~JointController()
 {
+    this->manipulator->setMotionCallback(MotionCallback());
+    this->manipulator->setGripperCallback(MotionCallback());
     delete ui;
 }
 
@@ -141,7 +152,9 @@ void JointController::on_axis5Slider_valueChanged(int value)
 
 void JointController::on_gripperSlider_valueChanged(int value)
 {
+    /* Every tick is queued, the gripper thread only sends the latest spacing */
     this->manipulator->setGripper(value);
+    this->gripperMoved = true;
 }
 
 void JointController::on_CloseGripper_clicked()
@@ -168,6 +181,8 @@ void JointController::directControlEnabled(bool enabled)
 
 void JointController::guiRefreshTimeout()
 {
+    LATENCY_SCOPE(PROBE_GUI_REFRESH);
+
     /* Refresh axis group */
     this->readOutAxisPositions();
 
@@ -197,7 +212,7 @@ void JointController::readOutAbsolutePosition()
 {
     static QLineEdit *text[] = {this->ui->editX, this->ui->editY, this->ui->editZ, this->ui->editRoll, this->ui->editPitch, this->ui->editYaw};
 
-    VectorXd tcp;
+    PoseVector tcp;
     bool validData = this->manipulator->getSensedPosition(tcp);
 
     for (int i = 0; i < 6; i++)
@@ -220,7 +235,7 @@ void JointController::readOutAxisPositions()
     static QSlider *sliders[] = {this->ui->axis1Slider, this->ui->axis2Slider, this->ui->axis3Slider, this->ui->axis4Slider, this->ui->axis5Slider};
     static QLabel *labels[] = {this->ui->labelAxis1, this->ui->labelAxis2, this->ui->labelAxis3, this->ui->labelAxis4, this->ui->labelAxis5};
 
-    VectorXi currentAnglesDeg(ARMJOINTS);
+    JointVectorDeg currentAnglesDeg;
     this->manipulator->getSensedAxis(currentAnglesDeg);
 
     for (int i = 0; i < ARMJOINTS; i++)
@@ -232,7 +247,7 @@ void JointController::readOutAxisPositions()
 
 void JointController::on_sendButton_clicked()
 {
-    VectorXd tcp(6);
+    PoseVector tcp;
     tcp << this->ui->editX->text().toDouble() / 100.,
            this->ui->editY->text().toDouble() / 100.,
            this->ui->editZ->text().toDouble() / 100.,
@@ -274,47 +289,85 @@ void JointController::on_loadButton_clicked()
                poseStream.seek(pos);
 
                /* Create progress bar */
-               QProgressDialog progress("Parsing positions...\nThis can take a while in case of transformations.",
-                            "Stop", 0, file_size, this);
+               QProgressDialog progress("Parsing positions...", "Stop", 0, file_size, this);
                progress.setWindowModality(Qt::WindowModal);
 
                /* Clear previosly stored poses */
                this->storedAnglePositions.clear();
+               this->storedGripperSpacings.clear();
+               this->predictedCycleTime = 0;
 
-               /* Get vector size (5 for angles, 6 for positions) */
+               /* Get vector size (5 for angles, 6 for positions), optionally followed by the gripper spacing */
                int vectorSize = (angleMode) ? 5 : 6;
+               bool parseError = false;
+
+               /* Positions are collected and transformed at once after parsing */
+               vector<PoseVector, aligned_allocator<PoseVector> > tcps;
+               vector<double> grippers;
 
-               while (!poseStream.atEnd() && !progress.wasCanceled())
+               while (!poseStream.atEnd() && !progress.wasCanceled() && !parseError)
                {
                    QString line = poseStream.readLine();
                    QStringList positions = line.split(" ");
                    VectorXd values(vectorSize);
 
-                   if (positions.size() == vectorSize)
+                   if (positions.size() == vectorSize || positions.size() == vectorSize + 1)
                    {
+                       double gripper = (positions.size() > vectorSize) ? positions[vectorSize].toDouble() :
+                                                                         numeric_limits<double>::quiet_NaN();
+
                        for (int i = 0; i < vectorSize; i++)
                        {
                            values[i] = positions[i].toDouble();
                        }
                        if (posMode)
                        {
-                           VectorXd angles;
-                           manipulator->prePlanMotion(values, angles);
-                           this->savePoseToInternalMemory(angles);
+                           tcps.push_back(PoseVector(values));
+                           grippers.push_back(gripper);
                        }
                        else
                        {
-                           this->savePoseToInternalMemory(values);
+                           this->savePoseToInternalMemory(values, gripper);
                        }
                        progress.setValue(poseStream.pos());
                    }
                    else
                    {
+                       int lineNumber = this->storedAnglePositions.size() + tcps.size() + 2;
                        this->storedAnglePositions.clear();
-                       QString ("Can't parse line %1 from input file").arg(this->storedAnglePositions.size() + 2);
+                       this->storedGripperSpacings.clear();
+                       this->predictedCycleTime = 0;
                        QMessageBox::warning(this, "Parsing error...", QString ("Can't parse line %1 from input file").arg(
-                                                this->storedAnglePositions.size() + 2), QMessageBox::Ok);
+                                                lineNumber), QMessageBox::Ok);
                        progress.close();
+                       parseError = true;
+                   }
+               }
+
+               if (posMode && !parseError && !progress.wasCanceled())
+               {
+                   /* Solve the kinematics of all positions in parallel */
+                   int count = tcps.size();
+                   vector<JointVector> angles(count);
+                   unique_ptr<bool[]> success(new bool[count]);
+                   manipulator->prePlanMotion(tcps.data(), count, angles.data(), success.get());
+
+                   for (int i = 0; i < count && !parseError; i++)
+                   {
+                       if (success[i])
+                       {
+                           VectorXd pose = angles[i];
+                           this->savePoseToInternalMemory(pose, grippers[i]);
+                       }
+                       else
+                       {
+                           this->storedAnglePositions.clear();
+                           this->storedGripperSpacings.clear();
+                           this->predictedCycleTime = 0;
+                           QMessageBox::warning(this, "Kinematics solver", QString ("Can't reach position in line %1 from input file").arg(
+                                                    i + 2), QMessageBox::Ok);
+                           parseError = true;
+                       }
                    }
                }
            }
@@ -336,7 +389,11 @@ void JointController::on_addPoseButton_clicked()
 {
     VectorXd axisState(5);
     this->manipulator->getSensedAxis(axisState);
-    this->savePoseToInternalMemory(axisState);
+
+    /* The pose only moves the gripper if it was moved since the previous pose */
+    double gripper = this->gripperMoved ? this->ui->gripperSlider->value() : numeric_limits<double>::quiet_NaN();
+    this->gripperMoved = false;
+    this->savePoseToInternalMemory(axisState, gripper);
 }
 
 void JointController::on_saveButton_clicked()
@@ -355,8 +412,15 @@ void JointController::on_saveButton_clicked()
             for (int i = 0; i < this->storedAnglePositions.size(); i++)
             {
                 VectorXd angle = this->storedAnglePositions[i];
-                poseStream << QString("%1 %2 %3 %4 %5\n").arg(
+                poseStream << QString("%1 %2 %3 %4 %5").arg(
                     angle[0]).arg(angle[1]).arg(angle[2]).arg(angle[3]).arg(angle[4]);
+
+                /* The gripper spacing is optional */
+                if (!std::isnan(this->storedGripperSpacings[i]))
+                {
+                    poseStream << QString(" %1").arg(this->storedGripperSpacings[i]);
+                }
+                poseStream << "\n";
             }
             poseFile.close();
         }
@@ -367,11 +431,17 @@ void JointController::on_saveButton_clicked()
     }
 }
 
-void JointController::savePoseToInternalMemory(VectorXd &angles)
+void JointController::savePoseToInternalMemory(VectorXd &angles, double gripper)
 {
+    /* The program stops at every pose, so each new pose adds one motion */
+    if (!this->storedAnglePositions.empty())
+    {
+        JointVector motion[2] = {JointVector(this->storedAnglePositions.back()), JointVector(angles)};
+        this->predictedCycleTime += this->manipulator->predictCycleTime(motion, 2);
+    }
     this->storedAnglePositions.push_back(angles);
-    this->ui->poseLabel->setText(QString("Pose: %1 / %2").arg(
-                this->automaticModePoseIndex).arg(this->storedAnglePositions.size()));
+    this->storedGripperSpacings.push_back(gripper);
+    this->refreshPoseLabel();
     this->ui->startButton->setEnabled(true);
 }
 
@@ -383,6 +453,7 @@ void JointController::on_startButton_clicked()
         this->automaticModeEnabled = true;
         this->ui->startButton->setText("Stop");
         this->directControlEnabled(false);
+        this->automaticModeNextPose();
     }
     else
     {
@@ -400,36 +471,57 @@ void JointController::on_startButton_clicked()
         {
             this->ui->startButton->setText("Start");
             this->automaticModePoseIndex = 0;
-            this->ui->poseLabel->setText(QString("Pose: %1 / %2").arg(
-                        this->automaticModePoseIndex).arg(this->storedAnglePositions.size()));
+            this->refreshPoseLabel();
         }
     }
 }
 
 void JointController::automaticModeTimeout()
 {
+    LATENCY_SCOPE(PROBE_GUI_REFRESH);
+
     /* Refresh GUI position states */
     this->readOutAbsolutePosition();
     this->readOutAxisPositions();
+}
 
-    /* Wait til robot reaches the latest pose */
-    if (this->manipulator->positionReached())
+void JointController::automaticModeNextPose()
+{
+    /* Wait til robot reaches the latest pose and the gripper is done */
+    if (!this->automaticModeEnabled || !this->manipulator->motionComplete(this->manipulator->lastMotion()) ||
+        !this->manipulator->gripperComplete(this->manipulator->lastGripper()))
     {
-        /* Set next pose or stop automatic mode if finished */
-        if (this->automaticModePoseIndex < this->storedAnglePositions.size())
-        {
-            this->manipulator->setAxis(this->storedAnglePositions[this->automaticModePoseIndex]);
-            this->automaticModePoseIndex++;
-        }
-        else
+        return;
+    }
+
+    /* Set next pose (invalid poses are skipped) or stop automatic mode if finished */
+    bool poseSent = false;
+    while (!poseSent && this->automaticModePoseIndex < this->storedAnglePositions.size())
+    {
+        int index = this->automaticModePoseIndex++;
+        poseSent = this->manipulator->setAxisSynchronized(this->storedAnglePositions[index]);
+
+        /* The gripper moves during the final approach instead of after the arrival */
+        if (poseSent && !std::isnan(this->storedGripperSpacings[index]))
         {
-            this->automaticModeTimer->stop();
-            this->ui->startButton->setText("Start");
-            this->automaticModeEnabled = false;
-            this->directControlEnabled(true);
-            this->automaticModePoseIndex = 0;
+            this->manipulator->setGripperBeforeArrival(qRound(this->storedGripperSpacings[index]), GRIPPER_LEAD_TIME);
         }
-        this->ui->poseLabel->setText(QString("Pose: %1 / %2").arg(
-                    this->automaticModePoseIndex).arg(this->storedAnglePositions.size()));
     }
+
+    if (!poseSent)
+    {
+        this->automaticModeTimer->stop();
+        this->ui->startButton->setText("Start");
+        this->automaticModeEnabled = false;
+        this->directControlEnabled(true);
+        this->automaticModePoseIndex = 0;
+    }
+    this->refreshPoseLabel();
+}
+
+void JointController::refreshPoseLabel()
+{
+    this->ui->poseLabel->setText(QString("Pose: %1 / %2 (%3 s)").arg(
+                this->automaticModePoseIndex).arg(this->storedAnglePositions.size()).arg(
+                this->predictedCycleTime, 0, 'f', 2));
 }
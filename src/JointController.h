@@ -157,9 +157,30 @@ private slots:
 
     /**
      * Timer callback function for automatic control mode.
+     * Refreshes the GUI while the poses are driven.
      */
     void automaticModeTimeout();
 
+    /**
+     * Sends the next pose of the automatic control mode as soon as the
+     * previous motion and gripper command are complete.
+     */
+    void automaticModeNextPose();
+
+signals:
+
+    /**
+     * Emitted by the control thread of the manipulator when a motion
+     * is complete (queued to the GUI thread).
+     */
+    void motionCompleted();
+
+    /**
+     * Emitted by the gripper thread of the manipulator when a gripper
+     * command is complete (queued to the GUI thread).
+     */
+    void gripperCompleted();
+
 private:
 
     /** Member object for the GUI of the controller */
@@ -173,6 +194,12 @@ private:
 
     vector<VectorXd> storedAnglePositions;
 
+    /** Gripper spacing of each stored pose in mm (NaN keeps the gripper) */
+    vector<double> storedGripperSpacings;
+
+    /** true if the gripper was moved since the last added pose */
+    bool gripperMoved;
+
     /** Memmber for automatic controlling. Index for the next pose */
     int automaticModePoseIndex;
 
@@ -182,6 +209,15 @@ private:
     /** Timer for automatic control mode */
     QTimer *automaticModeTimer;
 
+    /** Predicted time of the stored poses in seconds */
+    double predictedCycleTime;
+
+    /**
+     * Shows the index of the next pose, the number of stored poses and
+     * their predicted cycle time.
+     */
+    void refreshPoseLabel();
+
     /**
      * Refreshes the GUI.
      * A timer is started which refreshs the GUI till the robot reaches its
@@ -211,8 +247,9 @@ private:
      * automatic controlling.
      *
      * @param angles The angle set which should be stored.
+     * @param gripper Gripper spacing in mm, which is set during the final approach (NaN keeps the gripper)
      */
-    void savePoseToInternalMemory(VectorXd &angles);
+    void savePoseToInternalMemory(VectorXd &angles, double gripper = numeric_limits<double>::quiet_NaN());
 };
 
 #endif // JOINTCONTROLLER_H
@@ -0,0 +1,92 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "JointSimulation.h"
+#include <cmath>
+
+JointSimulation::JointSimulation()
+{
+    this->reset(JointVector::Zero());
+}
+
+void JointSimulation::reset(const JointVector &position)
+{
+    this->position = position;
+    this->velocity.setZero();
+    this->target = position;
+    this->previousTarget = position;
+    this->integralTerm.setZero();
+}
+
+void JointSimulation::setState(const JointVector &position, const JointVector &velocity)
+{
+    this->position = position;
+    this->velocity = velocity;
+    this->integralTerm.setZero();
+}
+
+void JointSimulation::setTarget(const JointVector &target, const bool changed[ARMJOINTS])
+{
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        this->target[i] = changed[i] ? target[i] : this->target[i];
+    }
+}
+
+void JointSimulation::step(const SimulationParameters &parameters, double timeStep)
+{
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        /* PID controller of the driver: position error to velocity, without feed forward */
+        double error = this->target[i] - this->position[i];
+        double targetVelocity = (this->target[i] - this->previousTarget[i]) / timeStep;
+        double integral = min(max(this->integralTerm[i] + parameters.i[i] * error * timeStep, parameters.iMin[i]),
+                              parameters.iMax[i]);
+        double command = parameters.p[i] * error + integral + parameters.d[i] * (targetVelocity - this->velocity[i]);
+
+        /* The motor follows within its limits and slows down in time to stop at the setpoint */
+        double maxChange = parameters.limits.acceleration[i] * timeStep;
+        double maxVelocity = min(parameters.limits.velocity[i],
+                                 sqrt(2 * parameters.limits.acceleration[i] * fabs(error)) + maxChange);
+
+        /* The integral only grows while the output isn't limited (no wind up during long moves) */
+        if (fabs(command) <= maxVelocity)
+        {
+            this->integralTerm[i] = integral;
+        }
+        command = min(max(command, -maxVelocity), maxVelocity);
+
+        this->velocity[i] += min(max(command - this->velocity[i], -maxChange), maxChange);
+        this->position[i] += this->velocity[i] * timeStep;
+        this->previousTarget[i] = this->target[i];
+    }
+}
+
+const JointVector &JointSimulation::getPosition() const
+{
+    return this->position;
+}
+
+const JointVector &JointSimulation::getVelocity() const
+{
+    return this->velocity;
+}
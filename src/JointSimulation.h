@@ -0,0 +1,140 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef JOINTSIMULATION_H
+#define JOINTSIMULATION_H
+
+#include "KinematicsSolver.h"
+#include "MotionProfile.h"
+
+/**
+ * Parameters of the simulated joints.
+ */
+struct SimulationParameters
+{
+    /** Gains of the position controller of each joint (trajectory_controller_P/I/D) */
+    JointVector p;
+    JointVector i;
+    JointVector d;
+
+    /** Limits of the integral term in radian per second (trajectory_controller_I_max/I_min) */
+    JointVector iMax;
+    JointVector iMin;
+
+    /** Maximum velocity and acceleration of each joint (the jerk isn't simulated) */
+    MotionLimits limits;
+
+    /**
+     * Constructor:
+     * Creates the parameters of the default config file (see ybparams.h).
+     */
+    SimulationParameters()
+    {
+        this->p.setConstant(SIMULATION_P);
+        this->i.setConstant(SIMULATION_I);
+        this->d.setConstant(SIMULATION_D);
+        this->iMax.setConstant(SIMULATION_I_LIMIT);
+        this->iMin.setConstant(-SIMULATION_I_LIMIT);
+    }
+};
+
+/**
+ * An object of this class simulates the joints of the arm with a fixed
+ * time step. Each joint follows its latest setpoint like the trajectory
+ * controller of the driver: a PID controller turns the distance to the
+ * setpoint into a velocity, which is limited in velocity and acceleration.
+ * All angles are kuka angles in radian.
+ *
+ * @author Stefan Wilkes
+ */
+class JointSimulation
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates joints which rest at 0.
+     */
+    JointSimulation();
+
+    /**
+     * Puts the joints to a position. The joints rest there and hold it.
+     *
+     * @param position The kuka angles
+     */
+    void reset(const JointVector &position);
+
+    /**
+     * Sets the state of the joints, e.g. a recorded one. The setpoints are kept.
+     *
+     * @param position The kuka angles
+     * @param velocity The velocities in radian per second
+     */
+    void setState(const JointVector &position, const JointVector &velocity);
+
+    /**
+     * Sets new setpoints.
+     *
+     * @param target Kuka angles of all joints
+     * @param changed Flag for each joint if its setpoint changed
+     */
+    void setTarget(const JointVector &target, const bool changed[ARMJOINTS]);
+
+    /**
+     * Advances the joints by a time step.
+     *
+     * @param parameters Gains and limits of the joints
+     * @param timeStep The time step in seconds
+     */
+    void step(const SimulationParameters &parameters, double timeStep);
+
+    /**
+     * Returns the simulated position.
+     *
+     * @return the kuka angles
+     */
+    const JointVector &getPosition() const;
+
+    /**
+     * Returns the simulated velocity.
+     *
+     * @return the velocities in radian per second
+     */
+    const JointVector &getVelocity() const;
+
+private:
+
+    /** Simulated axis values */
+    JointVector position;
+
+    /** Simulated velocities */
+    JointVector velocity;
+
+    /** Latest setpoint and the one of the previous step */
+    JointVector target;
+    JointVector previousTarget;
+
+    /** Integral terms of the joint controllers */
+    JointVector integralTerm;
+};
+
+#endif // JOINTSIMULATION_H
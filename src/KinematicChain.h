@@ -0,0 +1,218 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef KINEMATICCHAIN_H
+#define KINEMATICCHAIN_H
+
+#include <eigen3/Eigen/Dense>
+
+using namespace Eigen;
+
+/**
+ * Compile time helpers for the kinematic chain.
+ */
+namespace chain
+{
+
+/**
+ * Sine of a constant (Taylor series, evaluated by the compiler).
+ * Values within 1e-15 of 0 or +-1 are snapped to exactly these
+ * values, so products with them can be eliminated.
+ */
+constexpr double snap(double value)
+{
+    return (value > -1e-15 && value < 1e-15) ? 0. :
+           (value > 1. - 1e-15) ? 1. :
+           (value < -1. + 1e-15) ? -1. : value;
+}
+
+constexpr double sinSeries(double x2, double term, int n, double sum)
+{
+    return (n > 40) ? sum : sinSeries(x2, -term * x2 / ((n + 1) * (n + 2)), n + 2, sum + term);
+}
+
+constexpr double reduce(double x)
+{
+    return (x > M_PI) ? reduce(x - 2. * M_PI) : (x < -M_PI) ? reduce(x + 2. * M_PI) : x;
+}
+
+constexpr double sin(double x)
+{
+    return snap(sinSeries(reduce(x) * reduce(x), reduce(x), 1, 0.));
+}
+
+constexpr double cos(double x)
+{
+    return sin(x + M_PI_2);
+}
+
+/**
+ * Multiplies a value with a constant factor. After inlining the branches
+ * on the constant are resolved, so factors 0, 1 and -1 cost nothing.
+ */
+inline double mul(double value, double factor)
+{
+    return (factor == 0.) ? 0. : (factor == 1.) ? value : (factor == -1.) ? -value : value * factor;
+}
+
+/**
+ * Affine transformation as 3 x 4 array (the last row is always 0 0 0 1).
+ */
+struct Frame
+{
+    double m[3][4];
+};
+
+/**
+ * One link of the chain. Appends the DH transformation of joint I to the
+ * frame and recurses to the next joint, so the loop is fully unrolled.
+ */
+template <int I, int N, class Params>
+struct Link
+{
+    static inline void append(const double *angles, Frame &frame)
+    {
+        constexpr double ct0 = chain::cos(Params::theta(I));
+        constexpr double st0 = chain::sin(Params::theta(I));
+        constexpr double ca = chain::cos(Params::alpha(I));
+        constexpr double sa = chain::sin(Params::alpha(I));
+        constexpr double r = Params::r(I);
+        constexpr double d = Params::d(I);
+
+        /* cos and sin of angle + constant offset */
+        double cq = std::cos(angles[I]);
+        double sq = std::sin(angles[I]);
+        double ct = mul(cq, ct0) - mul(sq, st0);
+        double st = mul(sq, ct0) + mul(cq, st0);
+
+        for (int row = 0; row < 3; row++)
+        {
+            double *m = frame.m[row];
+            double m0 = m[0];
+            double m1 = m[1];
+            double m2 = m[2];
+
+            m[0] = m0 * ct + m1 * st;
+            m[1] = mul(m1 * ct - m0 * st, ca) + mul(m2, sa);
+            m[2] = mul(m0 * st - m1 * ct, sa) + mul(m2, ca);
+            m[3] = mul(m0 * ct + m1 * st, r) + mul(m2, d) + m[3];
+        }
+        Link<I + 1, N, Params>::append(angles, frame);
+    }
+};
+
+/** End of the recursion */
+template <int N, class Params>
+struct Link<N, N, Params>
+{
+    static inline void append(const double *, Frame &)
+    {
+    }
+};
+
+} // namespace chain
+
+/**
+ * This template describes a serial kinematic chain with DH parameters
+ * known at compile time.
+ *
+ * The parameter class provides the DH table as constexpr functions
+ * theta(i), d(i), r(i) and alpha(i), see YouBotDH in ybparams.h. The
+ * forward transformation is unrolled for all N links, sine and cosine of
+ * the constant offsets and twists are calculated by the compiler and all
+ * products with constant 0, 1 or -1 are eliminated.
+ *
+ * Variants of the arm are described by their own parameter class, e.g. a
+ * longer gripper:
+ *
+ * @code
+ * struct LongGripperDH : public YouBotDH
+ * {
+ *     static constexpr double d(int joint) { return (joint == 4) ? 0.2425 : YouBotDH::d(joint); }
+ * };
+ * typedef KinematicChain<5, LongGripperDH> LongGripperChain;
+ * @endcode
+ *
+ * @author Stefan Wilkes
+ */
+template <int N, class Params>
+class KinematicChain
+{
+public:
+
+    /** Axis values of the chain in radian */
+    typedef Matrix<double, N, 1> Angles;
+
+    /**
+     * Calculates the transformation from the base to the end of the chain.
+     *
+     * @param angles The axis values in radian
+     * @param transformation Matrix which receives the transformation
+     */
+    static inline void forward(const Angles &angles, Matrix4d &transformation)
+    {
+        const double *q = angles.data();
+
+        /* The first link is the initial frame, no product with the identity */
+        constexpr double ct0 = chain::cos(Params::theta(0));
+        constexpr double st0 = chain::sin(Params::theta(0));
+        constexpr double ca = chain::cos(Params::alpha(0));
+        constexpr double sa = chain::sin(Params::alpha(0));
+        double cq = std::cos(q[0]);
+        double sq = std::sin(q[0]);
+        double ct = chain::mul(cq, ct0) - chain::mul(sq, st0);
+        double st = chain::mul(sq, ct0) + chain::mul(cq, st0);
+
+        chain::Frame frame = {{{ct, chain::mul(-st, ca), chain::mul(st, sa), chain::mul(ct, Params::r(0))},
+                               {st, chain::mul(ct, ca), chain::mul(-ct, sa), chain::mul(st, Params::r(0))},
+                               {0., sa, ca, Params::d(0)}}};
+        chain::Link<1, N, Params>::append(q, frame);
+
+        for (int row = 0; row < 3; row++)
+        {
+            for (int col = 0; col < 4; col++)
+            {
+                transformation(row, col) = frame.m[row][col];
+            }
+        }
+        transformation.row(3) << 0, 0, 0, 1;
+    }
+
+    /**
+     * Checks if a runtime DH table equals the compile time parameters.
+     *
+     * @return true if all values are equal
+     */
+    static bool matches(const double theta[N], const double d[N], const double r[N], const double alpha[N])
+    {
+        bool equal = true;
+
+        for (int i = 0; i < N && equal; i++)
+        {
+            equal = (theta[i] == Params::theta(i)) && (d[i] == Params::d(i)) &&
+                    (r[i] == Params::r(i)) && (alpha[i] == Params::alpha(i));
+        }
+        return equal;
+    }
+};
+
+#endif // KINEMATICCHAIN_H
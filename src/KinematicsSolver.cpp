@@ -21,19 +21,678 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "KinematicsSolver.h"
+#include "IKCache.h"
 #include "ybparams.h"
+#include "SimdMath.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <cmath>
+
+/** Maximum position error of a verified IK solution in meter */
+static const double POSITION_TOLERANCE = 1e-6;
+
+/** Maximum orientation error of a verified IK solution (rotation matrix norm) */
+static const double ORIENTATION_TOLERANCE = 1e-4;
+
+/** Number of poses a thread solves at once in a batch */
+static const int BATCH_GRAIN_SIZE = 256;
+
+/** Weight of the summed joint travel, which breaks ties between branches of the same travel time */
+static const double TRAVEL_SUM_WEIGHT = 1e-3;
+
+/**
+ * Normalizes an angle to the range [-PI, PI].
+ *
+ * @param angle The angle in radian
+ * @return the normalized angle
+ */
+static inline double normalizeAngle(double angle)
+{
+    return atan2(sin(angle), cos(angle));
+}
 
 KinematicsSolver::KinematicsSolver()
 {
+    DHParameters parameters;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        parameters.theta[i] = DH_THETA[i];
+        parameters.d[i] = DH_D[i];
+        parameters.r[i] = DH_R[i];
+        parameters.alpha[i] = DH_ALPHA[i];
+    }
+
+    this->cache = NULL;
+    this->setDHParameters(parameters);
+    this->setJointVelocities(JointVector(MAX_VELOCITY_SD));
+}
+
+KinematicsSolver::~KinematicsSolver()
+{
+    delete this->cache;
+}
+
+void KinematicsSolver::setDHParameters(const DHParameters &parameters)
+{
+    this->parameters = parameters;
+    this->compiledChain = YouBotChain::matches(parameters.theta, parameters.d, parameters.r, parameters.alpha);
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        this->cosAlpha[i] = cos(parameters.alpha[i]);
+        this->sinAlpha[i] = sin(parameters.alpha[i]);
+    }
+
+    /* FNV-1a over the bytes of the parameters and the limits of the datasheet */
+    const double *values[] = {parameters.theta, parameters.d, parameters.r, parameters.alpha, BOTTOM_LIMIT_SD, TOP_LIMIT_SD};
+    this->parameterHash = 14695981039346656037ULL;
+
+    for (int v = 0; v < 6; v++)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(values[v]);
+
+        for (size_t i = 0; i < ARMJOINTS * sizeof(double); i++)
+        {
+            this->parameterHash ^= bytes[i];
+            this->parameterHash *= 1099511628211ULL;
+        }
+    }
+
+    /* Cached solutions belong to the old chain */
+    if (this->cache != NULL)
+    {
+        this->cache->invalidate();
+    }
+}
+
+const DHParameters &KinematicsSolver::getDHParameters() const
+{
+    return this->parameters;
+}
+
+uint64_t KinematicsSolver::getParameterHash() const
+{
+    return this->parameterHash;
+}
+
+void KinematicsSolver::setJointVelocities(const JointVector &velocities)
+{
+    this->travelWeights = velocities.cwiseInverse();
+}
+
+double KinematicsSolver::travelTime(const JointVector &from, const JointVector &to) const
+{
+    return (to - from).cwiseAbs().cwiseProduct(this->travelWeights).maxCoeff();
+}
+
+double KinematicsSolver::travelCost(const JointVector &from, const JointVector &to) const
+{
+    JointVector times = (to - from).cwiseAbs().cwiseProduct(this->travelWeights);
+
+    return times.maxCoeff() + TRAVEL_SUM_WEIGHT * times.sum();
+}
+
+void KinematicsSolver::enableCache(size_t capacity, double positionResolution, double orientationResolution)
+{
+    delete this->cache;
+    this->cache = new IKCache(capacity, positionResolution, orientationResolution);
+}
+
+void KinematicsSolver::disableCache()
+{
+    delete this->cache;
+    this->cache = NULL;
+}
 
+bool KinematicsSolver::getCacheStatistics(IKCacheStatistics &statistics) const
+{
+    if (this->cache != NULL)
+    {
+        statistics = this->cache->statistics();
+    }
+    return this->cache != NULL;
 }
 
 bool KinematicsSolver::forwardTransformation(VectorXd &angles, VectorXd &tcp)
 {
-    return false;
+    bool success = (angles.size() == ARMJOINTS);
+
+    if (success)
+    {
+        PoseVector pose;
+        success = this->forwardTransformation(JointVector(angles), pose);
+        tcp = pose;
+    }
+    return success;
 }
 
 bool KinematicsSolver::inverseTransformation(VectorXd &tcp, VectorXd &angles)
 {
-    return false;
-}
\ No newline at end of file
+    bool success = (tcp.size() == 6);
+
+    if (success)
+    {
+        JointVector jointAngles;
+        success = this->inverseTransformation(PoseVector(tcp), jointAngles);
+
+        if (success)
+        {
+            angles = jointAngles;
+        }
+    }
+    return success;
+}
+
+bool KinematicsSolver::forwardTransformation(const JointVector &angles, PoseVector &tcp) const
+{
+    Matrix4d transformation;
+    bool success = this->forwardTransformation(angles, transformation);
+
+    if (success)
+    {
+        transformationToPose(transformation, tcp);
+    }
+    return success;
+}
+
+bool KinematicsSolver::forwardTransformation(const JointVector &angles, Matrix4d &transformation) const
+{
+    if (this->compiledChain)
+    {
+        YouBotChain::forward(angles, transformation);
+        return true;
+    }
+
+    transformation.setIdentity();
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        Matrix4d dh;
+        this->dhTransformation(i, angles[i], dh);
+        transformation = transformation * dh;
+    }
+    return true;
+}
+
+void KinematicsSolver::dhTransformation(int joint, double angle, Matrix4d &dh) const
+{
+    /* DH matrix: Rot(z, theta) * Trans(z, d) * Trans(x, r) * Rot(x, alpha) */
+    double theta = angle + this->parameters.theta[joint];
+    double ct = cos(theta);
+    double st = sin(theta);
+    double ca = this->cosAlpha[joint];
+    double sa = this->sinAlpha[joint];
+    double r = this->parameters.r[joint];
+
+    dh << ct, -st * ca,  st * sa, r * ct,
+          st,  ct * ca, -ct * sa, r * st,
+           0,       sa,       ca, this->parameters.d[joint],
+           0,        0,        0, 1;
+}
+
+bool KinematicsSolver::inverseTransformation(const PoseVector &tcp, JointVector &angles) const
+{
+    bool success = false;
+
+    if (this->cache != NULL)
+    {
+        JointVector solutions[MAX_IK_SOLUTIONS];
+        success = (this->solveAllBranches(tcp, solutions) > 0);
+        angles = success ? solutions[0] : angles;
+    }
+    else
+    {
+        Matrix4d transformation;
+        poseToTransformation(tcp, transformation);
+
+        /* Try all branches, starting with the most common elbow up configuration */
+        for (int branch = 0; branch < 4 && !success; branch++)
+        {
+            success = this->solveBranch(transformation, branch >= 2, (branch % 2) == 0, angles);
+        }
+    }
+    return success;
+}
+
+int KinematicsSolver::inverseTransformationAll(const PoseVector &tcp, JointVector solutions[MAX_IK_SOLUTIONS]) const
+{
+    return this->solveAllBranches(tcp, solutions);
+}
+
+bool KinematicsSolver::inverseTransformationMinTravel(const PoseVector &tcp, const JointVector &current, JointVector &angles,
+                                                      double *time) const
+{
+    JointVector solutions[MAX_IK_SOLUTIONS];
+    int count = this->solveAllBranches(tcp, solutions);
+    double bestCost = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        double cost = this->travelCost(current, solutions[i]);
+
+        if (i == 0 || cost < bestCost)
+        {
+            angles = solutions[i];
+            bestCost = cost;
+        }
+    }
+
+    if (time != NULL && count > 0)
+    {
+        *time = this->travelTime(current, angles);
+    }
+    return count > 0;
+}
+
+int KinematicsSolver::inverseTransformationSequence(const PoseVector *tcps, int count, const JointVector &start, JointVector *angles,
+                                                    bool *success, double *totalTime) const
+{
+    /* All branches of all poses, solved in parallel */
+    vector<JointVector> solutions(count * MAX_IK_SOLUTIONS);
+    vector<int> solutionCount(count);
+
+    WorkerPool::instance().parallelFor(count, BATCH_GRAIN_SIZE, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            solutionCount[i] = this->solveAllBranches(tcps[i], &solutions[i * MAX_IK_SOLUTIONS]);
+        }
+    });
+
+    /* Shortest path through the branches: cost to reach each branch and the branch it was reached from */
+    vector<double> pathCost(count * MAX_IK_SOLUTIONS);
+    vector<int> predecessor(count * MAX_IK_SOLUTIONS);
+    int previous = -1;
+    int solved = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        success[i] = (solutionCount[i] > 0);
+
+        for (int b = 0; b < solutionCount[i]; b++)
+        {
+            int index = i * MAX_IK_SOLUTIONS + b;
+
+            if (previous < 0)
+            {
+                pathCost[index] = this->travelCost(start, solutions[index]);
+                predecessor[index] = -1;
+                continue;
+            }
+
+            for (int p = 0; p < solutionCount[previous]; p++)
+            {
+                int from = previous * MAX_IK_SOLUTIONS + p;
+                double cost = pathCost[from] + this->travelCost(solutions[from], solutions[index]);
+
+                if (p == 0 || cost < pathCost[index])
+                {
+                    pathCost[index] = cost;
+                    predecessor[index] = from;
+                }
+            }
+        }
+
+        if (success[i])
+        {
+            previous = i;
+            solved++;
+        }
+    }
+
+    /* Follow the fastest path back from the last reachable pose */
+    int index = -1;
+    for (int b = 0; previous >= 0 && b < solutionCount[previous]; b++)
+    {
+        int candidate = previous * MAX_IK_SOLUTIONS + b;
+        index = (index < 0 || pathCost[candidate] < pathCost[index]) ? candidate : index;
+    }
+
+    double time = 0;
+    while (index >= 0)
+    {
+        int from = predecessor[index];
+        time += this->travelTime((from >= 0) ? solutions[from] : start, solutions[index]);
+        angles[index / MAX_IK_SOLUTIONS] = solutions[index];
+        index = from;
+    }
+
+    if (totalTime != NULL)
+    {
+        *totalTime = time;
+    }
+    return solved;
+}
+
+int KinematicsSolver::solveAllBranches(const PoseVector &tcp, JointVector solutions[MAX_IK_SOLUTIONS]) const
+{
+    int count = 0;
+
+    if (this->cache != NULL && this->cache->lookup(tcp, solutions, count))
+    {
+        return count;
+    }
+
+    /* Read the generation first, solutions of a changed chain are dropped by the cache */
+    uint64_t generation = (this->cache != NULL) ? this->cache->generation() : 0;
+    Matrix4d transformation;
+    poseToTransformation(tcp, transformation);
+
+    for (int branch = 0; branch < 4; branch++)
+    {
+        if (this->solveBranch(transformation, branch >= 2, (branch % 2) == 0, solutions[count]))
+        {
+            count++;
+        }
+    }
+
+    if (this->cache != NULL)
+    {
+        this->cache->insert(tcp, solutions, count, generation);
+    }
+    return count;
+}
+
+bool KinematicsSolver::inverseTransformationIterative(const PoseVector &tcp, const JointVector &start, JointVector &angles,
+                                                      const IterativeIKParameters &settings, IterativeIKResult *result) const
+{
+    Matrix4d target;
+    poseToTransformation(tcp, target);
+
+    JointVector q = start;
+    JacobianMatrix jacobian;
+    Matrix4d reached;
+    Matrix<double, 6, 1> error;
+    double positionError = 0;
+    double orientationError = 0;
+    bool converged = false;
+    int iteration = 0;
+
+    while (true)
+    {
+        this->jacobian(q, jacobian, reached);
+
+        /* Position error and orientation error as rotation vector */
+        error.head<3>() = target.block<3, 1>(0, 3) - reached.block<3, 1>(0, 3);
+        AngleAxisd rotation(Matrix3d(target.block<3, 3>(0, 0) * reached.block<3, 3>(0, 0).transpose()));
+        error.tail<3>() = rotation.angle() * rotation.axis();
+
+        positionError = error.head<3>().norm();
+        orientationError = fabs(rotation.angle());
+        converged = (positionError <= settings.positionTolerance) && (orientationError <= settings.orientationTolerance);
+
+        if (converged || iteration >= settings.maxIterations)
+        {
+            break;
+        }
+
+        /* Damped least squares step: (J^T W J + lambda^2 I) dq = J^T W e, W weights the orientation */
+        double weight = settings.orientationWeight * settings.orientationWeight;
+        Matrix<double, 5, 5> normal = jacobian.topRows<3>().transpose() * jacobian.topRows<3>() +
+                                      weight * jacobian.bottomRows<3>().transpose() * jacobian.bottomRows<3>();
+        normal.diagonal().array() += settings.damping * settings.damping;
+        error.tail<3>() *= weight;
+        q += normal.ldlt().solve(jacobian.transpose() * error);
+
+        /* Stay inside the joint limits */
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            q[i] = max(BOTTOM_LIMIT_SD[i], min(TOP_LIMIT_SD[i], q[i]));
+        }
+        iteration++;
+    }
+
+    if (result != NULL)
+    {
+        result->iterations = iteration;
+        result->positionError = positionError;
+        result->orientationError = orientationError;
+    }
+
+    if (converged)
+    {
+        angles = q;
+    }
+    return converged;
+}
+
+void KinematicsSolver::jacobian(const JointVector &angles, JacobianMatrix &jacobian, Matrix4d &transformation) const
+{
+    /* Joint axes and origins of the frames 0 - 4 */
+    Matrix<double, 3, ARMJOINTS> axes;
+    Matrix<double, 3, ARMJOINTS> origins;
+    transformation.setIdentity();
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        axes.col(i) = transformation.block<3, 1>(0, 2);
+        origins.col(i) = transformation.block<3, 1>(0, 3);
+
+        Matrix4d dh;
+        this->dhTransformation(i, angles[i], dh);
+        transformation = transformation * dh;
+    }
+
+    /* Revolute joints: v = z x (p - o), w = z */
+    Vector3d tcp = transformation.block<3, 1>(0, 3);
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        Vector3d axis = axes.col(i);
+        jacobian.block<3, 1>(0, i) = axis.cross(tcp - origins.col(i));
+        jacobian.block<3, 1>(3, i) = axis;
+    }
+}
+
+/**
+ * Closed form forward kinematics of the youBot chain for WIDTH
+ * configurations at once. The arm plane is turned by joint 1, joints 2 - 4
+ * rotate around parallel axes and joint 5 around the approach vector.
+ * Only valid for the parameters of YouBotChain, the link lengths are read
+ * from the parameters.
+ *
+ * @param dh The DH parameters (link lengths) of the chain
+ * @param angles Five arrays with the axis values
+ * @param tcp Six arrays for the resulting poses
+ * @param index Index of the first configuration to process
+ */
+template <class Ops>
+static inline void forwardTransformationKernel(const DHParameters &dh, const double *const angles[ARMJOINTS], double *const tcp[6], int index)
+{
+    typedef typename Ops::Type V;
+
+    V q2 = Ops::load(angles[1] + index);
+    V q23 = Ops::add(q2, Ops::load(angles[2] + index));
+    V q234 = Ops::add(q23, Ops::load(angles[3] + index));
+
+    V s1, c1, s2, c2, s23, c23, s234, c234, s5, c5;
+    simd::sincos<Ops>(Ops::load(angles[0] + index), s1, c1);
+    simd::sincos<Ops>(q2, s2, c2);
+    simd::sincos<Ops>(q23, s23, c23);
+    simd::sincos<Ops>(q234, s234, c234);
+    simd::sincos<Ops>(Ops::load(angles[4] + index), s5, c5);
+
+    /* Position inside the arm plane (radial distance and height) */
+    V r = Ops::madd(Ops::set(dh.r[1]), s2, Ops::set(dh.r[0]));
+    r = Ops::madd(Ops::set(dh.r[2]), s23, r);
+    r = Ops::madd(Ops::set(dh.d[4]), s234, r);
+    V z = Ops::madd(Ops::set(dh.r[1]), c2, Ops::set(dh.d[0]));
+    z = Ops::madd(Ops::set(dh.r[2]), c23, z);
+    z = Ops::madd(Ops::set(dh.d[4]), c234, z);
+
+    /* Needed elements of R = Rz(q1) * Ry(q2 + q3 + q4) * Rz(q5) */
+    V c234c5 = Ops::mul(c234, c5);
+    V r00 = Ops::sub(Ops::mul(c1, c234c5), Ops::mul(s1, s5));
+    V r10 = Ops::madd(s1, c234c5, Ops::mul(c1, s5));
+    V negR20 = Ops::mul(s234, c5);
+    V r21 = Ops::mul(s234, s5);
+    V r22 = c234;
+
+    Ops::store(tcp[0] + index, Ops::mul(c1, r));
+    Ops::store(tcp[1] + index, Ops::mul(s1, r));
+    Ops::store(tcp[2] + index, z);
+    Ops::store(tcp[3] + index, simd::atan2<Ops>(r21, r22));
+    Ops::store(tcp[4] + index, simd::atan2<Ops>(negR20, Ops::sqrt(Ops::madd(r21, r21, Ops::mul(r22, r22)))));
+    Ops::store(tcp[5] + index, simd::atan2<Ops>(r10, r00));
+}
+
+void KinematicsSolver::forwardTransformation(const double *const angles[ARMJOINTS], int count, double *const tcp[6]) const
+{
+    int i = 0;
+
+    /* The kernel only knows the geometry of the youBot chain, other parameters use the DH matrices */
+    if (!this->compiledChain)
+    {
+        for (; i < count; i++)
+        {
+            JointVector configuration;
+            Matrix4d transformation;
+            PoseVector pose;
+
+            for (int j = 0; j < ARMJOINTS; j++)
+            {
+                configuration[j] = angles[j][i];
+            }
+            this->forwardTransformation(configuration, transformation);
+            transformationToPose(transformation, pose);
+
+            for (int k = 0; k < 6; k++)
+            {
+                tcp[k][i] = pose[k];
+            }
+        }
+        return;
+    }
+
+    for (; i + simd::SimdOps::WIDTH <= count; i += simd::SimdOps::WIDTH)
+    {
+        forwardTransformationKernel<simd::SimdOps>(this->parameters, angles, tcp, i);
+    }
+    for (; i < count; i++)
+    {
+        forwardTransformationKernel<simd::ScalarOps>(this->parameters, angles, tcp, i);
+    }
+}
+
+int KinematicsSolver::inverseTransformationBatch(const PoseVector *tcps, int count, JointVector *angles, bool *success) const
+{
+    atomic<int> solved(0);
+
+    WorkerPool::instance().parallelFor(count, BATCH_GRAIN_SIZE, [&](int begin, int end)
+    {
+        int solvedChunk = 0;
+
+        for (int i = begin; i < end; i++)
+        {
+            success[i] = this->inverseTransformation(tcps[i], angles[i]);
+            solvedChunk += success[i] ? 1 : 0;
+        }
+        solved += solvedChunk;
+    });
+
+    return solved;
+}
+
+bool KinematicsSolver::solveBranch(const Matrix4d &transformation, bool backwards, bool elbowUp, JointVector &angles) const
+{
+    Vector3d position = transformation.block<3, 1>(0, 3);
+    Vector3d approach = transformation.block<3, 1>(0, 2);
+
+    /* Wrist center: go back from the TCP along the approach vector */
+    Vector3d wrist = position - this->parameters.d[4] * approach;
+
+    /* Joint 1 turns the arm plane towards the wrist center */
+    double q1;
+    if (wrist.head<2>().norm() > POSITION_TOLERANCE)
+    {
+        q1 = atan2(wrist[1], wrist[0]);
+    }
+    else
+    {
+        q1 = (approach.head<2>().norm() > POSITION_TOLERANCE) ? atan2(approach[1], approach[0]) : 0.;
+    }
+    q1 = backwards ? normalizeAngle(q1 + M_PI) : q1;
+
+    double c1 = cos(q1);
+    double s1 = sin(q1);
+
+    /* Wrist center in the arm plane relative to joint 2 */
+    double r = c1 * wrist[0] + s1 * wrist[1] - this->parameters.r[0];
+    double z = wrist[2] - this->parameters.d[0];
+
+    /* Planar two link chain (joint 2 and 3), angles relative to the z axis */
+    double a2 = this->parameters.r[1];
+    double a3 = this->parameters.r[2];
+    double c3 = (r * r + z * z - a2 * a2 - a3 * a3) / (2. * a2 * a3);
+
+    if (c3 < -1. || c3 > 1.)
+    {
+        return false;
+    }
+
+    double q3 = elbowUp ? acos(c3) : -acos(c3);
+    double q2 = atan2(r, z) - atan2(a3 * sin(q3), a2 + a3 * c3);
+
+    /* Pitch of the gripper inside the arm plane gives joint 4 */
+    double pitch = atan2(c1 * approach[0] + s1 * approach[1], approach[2]);
+    double q4 = pitch - q2 - q3;
+
+    /* Remaining rotation around the approach vector is joint 5 */
+    Matrix3d planeRotation = (AngleAxisd(q1, Vector3d::UnitZ()) * AngleAxisd(pitch, Vector3d::UnitY())).toRotationMatrix();
+    Matrix3d wristRotation = planeRotation.transpose() * transformation.block<3, 3>(0, 0);
+    double q5 = atan2(wristRotation(1, 0), wristRotation(0, 0));
+
+    angles << q1, normalizeAngle(q2), normalizeAngle(q3), normalizeAngle(q4), q5;
+
+    if (!withinJointLimits(angles))
+    {
+        return false;
+    }
+
+    /* Verify the solution, poses with an unreachable orientation are rejected */
+    Matrix4d reached;
+    this->forwardTransformation(angles, reached);
+
+    return ((reached.block<3, 1>(0, 3) - position).norm() < POSITION_TOLERANCE) &&
+           ((reached.block<3, 3>(0, 0) - transformation.block<3, 3>(0, 0)).norm() < ORIENTATION_TOLERANCE);
+}
+
+void KinematicsSolver::poseToTransformation(const PoseVector &tcp, Matrix4d &transformation)
+{
+    double cr = cos(tcp[3]);
+    double sr = sin(tcp[3]);
+    double cp = cos(tcp[4]);
+    double sp = sin(tcp[4]);
+    double cy = cos(tcp[5]);
+    double sy = sin(tcp[5]);
+
+    /* R = Rz(yaw) * Ry(pitch) * Rx(roll) */
+    transformation << cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr, tcp[0],
+                      sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr, tcp[1],
+                          -sp,                cp * sr,                cp * cr, tcp[2],
+                            0,                      0,                      0, 1;
+}
+
+void KinematicsSolver::transformationToPose(const Matrix4d &transformation, PoseVector &tcp)
+{
+    const Matrix4d &t = transformation;
+
+    tcp[0] = t(0, 3);
+    tcp[1] = t(1, 3);
+    tcp[2] = t(2, 3);
+    tcp[3] = atan2(t(2, 1), t(2, 2));
+    tcp[4] = atan2(-t(2, 0), sqrt(t(2, 1) * t(2, 1) + t(2, 2) * t(2, 2)));
+    tcp[5] = atan2(t(1, 0), t(0, 0));
+}
+
+bool KinematicsSolver::withinJointLimits(const JointVector &angles)
+{
+    bool valid = true;
+
+    for (int i = 0; i < ARMJOINTS && valid; i++)
+    {
+        valid = (angles[i] >= BOTTOM_LIMIT_SD[i]) && (angles[i] <= TOP_LIMIT_SD[i]);
+    }
+    return valid;
+}
@@ -24,15 +24,112 @@
 #define KINEMATICSSOLVER_H
 
 #include <eigen3/Eigen/Dense>
+#include <stdint.h>
 #include <vector>
+#include "KinematicChain.h"
+#include "ybparams.h"
 
 using namespace std;
 using namespace Eigen;
 
+/** Fixed size vector for the five axis angles of the arm in radian */
+typedef Matrix<double, 5, 1> JointVector;
+
+/** Fixed size vector for a TCP pose (X, Y, Z, Roll, Pitch, Yaw) */
+typedef Matrix<double, 6, 1> PoseVector;
+
+/** The youBot arm with the DH parameters of ybparams.h as compile time chain */
+typedef KinematicChain<ARMJOINTS, YouBotDH> YouBotChain;
+
+/** Maximum number of inverse kinematics solutions of one pose */
+#define MAX_IK_SOLUTIONS 4
+
+class IKCache;
+struct IKCacheStatistics;
+
+/**
+ * DH parameters of the kinematic chain (lengths in meter, angles in radian).
+ */
+struct DHParameters
+{
+    double theta[ARMJOINTS];
+    double d[ARMJOINTS];
+    double r[ARMJOINTS];
+    double alpha[ARMJOINTS];
+};
+
+/** Geometric Jacobian of the arm (linear velocity above angular velocity) */
+typedef Matrix<double, 6, 5> JacobianMatrix;
+
+/**
+ * Settings of the iterative (damped least squares) inverse kinematics.
+ */
+struct IterativeIKParameters
+{
+    /** Accepted position error in meter */
+    double positionTolerance;
+
+    /** Accepted orientation error in radian */
+    double orientationTolerance;
+
+    /** Maximum number of iterations */
+    int maxIterations;
+
+    /** Damping factor of the least squares step */
+    double damping;
+
+    /** Weight of the orientation error compared to the position error (meter per radian) */
+    double orientationWeight;
+
+    /**
+     * Constructor:
+     * Sets default values for control rate corrections.
+     */
+    IterativeIKParameters() :
+        positionTolerance(1e-4), orientationTolerance(1e-3), maxIterations(20), damping(0.01), orientationWeight(0.2)
+    {
+    }
+};
+
+/**
+ * Result of an iterative inverse kinematics run.
+ */
+struct IterativeIKResult
+{
+    /** Number of iterations which were needed */
+    int iterations;
+
+    /** Remaining position error in meter */
+    double positionError;
+
+    /** Remaining orientation error in radian */
+    double orientationError;
+};
+
 /**
  * An object of this class implements the kinematics solver
  * for the youBot manipulator.
  *
+ * The forward transformation chains the DH matrices defined in ybparams.h.
+ * As long as these default parameters are used, the unrolled compile time
+ * chain YouBotChain is evaluated, other parameters use the generic loop.
+ * The inverse transformation is solved in closed form: joint 1 turns the
+ * arm plane towards the wrist, joints 2 - 4 form a planar chain inside this
+ * plane and joint 5 rotates around the approach vector of the gripper.
+ * All calculations use fixed size types and don't allocate any memory.
+ * The closed form solution relies on the axis layout of the youBot, modified
+ * link lengths (e.g. another gripper) can be set with setDHParameters().
+ *
+ * A pose is reached by up to four branches (arm in front of or over its
+ * base, elbow up or down). Of the branches within the joint limits the one
+ * with the shortest travel time from the current configuration can be
+ * selected, which avoids long swings of joint 1 and 5 between poses.
+ *
+ * The orientation of the TCP is given as roll, pitch and yaw angles
+ * (R = Rz(yaw) * Ry(pitch) * Rx(roll)). Because the arm only has five axes,
+ * the approach vector of a reachable pose always lies in the plane spanned
+ * by the z axis and the arm.
+ *
  * @author Stefan Wilkes
  */
 class KinematicsSolver
@@ -41,10 +138,64 @@ public:
 
     /**
      * Constructor:
-     * Creates a new kinematics solver.
+     * Creates a new kinematics solver with the DH parameters of ybparams.h.
      */
     KinematicsSolver();
 
+    /**
+     * Destructor.
+     */
+    ~KinematicsSolver();
+
+    /**
+     * Sets new DH parameters. The IK cache is invalidated.
+     * Must not be called while other threads use the solver.
+     *
+     * @param parameters The new parameters
+     */
+    void setDHParameters(const DHParameters &parameters);
+
+    /**
+     * Returns the current DH parameters.
+     *
+     * @return the parameters
+     */
+    const DHParameters &getDHParameters() const;
+
+    /**
+     * Returns a hash (FNV-1a) of the DH parameters and the joint limits,
+     * which identifies data derived from them, e.g. a reachability map.
+     *
+     * @return the hash of the current parameters
+     */
+    uint64_t getParameterHash() const;
+
+    /**
+     * Enables a cache for the inverse kinematics of recently requested
+     * poses. Only exactly repeated poses are taken from the cache, the
+     * resolution sets the cells in which a newer pose replaces an older one.
+     * Must not be called while other threads use the solver.
+     *
+     * @param capacity Maximum number of cached poses
+     * @param positionResolution Quantization of X, Y and Z in meter
+     * @param orientationResolution Quantization of roll, pitch and yaw in radian
+     */
+    void enableCache(size_t capacity, double positionResolution = 1e-4, double orientationResolution = 1e-4);
+
+    /**
+     * Disables and clears the IK cache.
+     * Must not be called while other threads use the solver.
+     */
+    void disableCache();
+
+    /**
+     * Returns the hit and miss counters of the IK cache.
+     *
+     * @param statistics Receives the counters
+     * @return true if the cache is enabled
+     */
+    bool getCacheStatistics(IKCacheStatistics &statistics) const;
+
     /**
      * Calculates the TCP Matrix for a given robot state.
      * Forward kinematics.
@@ -53,7 +204,6 @@ public:
      * @param tcp Vector which gives information about the posititon and
      *            orientation of the TCP (X, Y, Z, Roll, Pitch, Yaw)
      * @return true if the tcp state estimated successfully
-     * @todo You've to implementd the functionality in the corresponding C++ File
      */
     bool forwardTransformation(VectorXd &angles, VectorXd &tcp);
 
@@ -65,9 +215,240 @@ public:
      *            (X, Y, Z, Roll, Pitch, Yaw)
      * @param angles A vector for storing the calculated angles
      * @return true if a possible state was calculated
-     * @todo You've to implementd the functionality in the corresponding C++ File
      */
     bool inverseTransformation(VectorXd &tcp, VectorXd &angles);
+
+    /**
+     * Forward kinematics for fixed size vectors.
+     *
+     * @param angles The axis values of the robot in radian
+     * @param tcp Vector for the resulting pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @return true if the tcp state estimated successfully
+     */
+    bool forwardTransformation(const JointVector &angles, PoseVector &tcp) const;
+
+    /**
+     * Forward kinematics which returns the homogeneous transformation
+     * from the arm base to the TCP.
+     *
+     * @param angles The axis values of the robot in radian
+     * @param transformation Matrix for the resulting transformation
+     * @return true if the tcp state estimated successfully
+     */
+    bool forwardTransformation(const JointVector &angles, Matrix4d &transformation) const;
+
+    /**
+     * Forward kinematics for many configurations at once (structure of arrays).
+     * The poses are calculated with SIMD instructions (AVX: 4, SSE2: 2
+     * configurations per instruction) and a scalar loop for the remainder.
+     * Other DH parameters than the ones of the youBot are calculated one
+     * configuration after the other. The arrays may not overlap.
+     *
+     * @param angles Five arrays with count angles each (one array per axis)
+     * @param count Number of configurations
+     * @param tcp Six arrays with count values each (X, Y, Z, Roll, Pitch, Yaw)
+     */
+    void forwardTransformation(const double *const angles[ARMJOINTS], int count, double *const tcp[6]) const;
+
+    /**
+     * Inverse kinematics for fixed size vectors.
+     * The first solution within the joint limits is returned. Elbow up
+     * solutions in front of the arm are preferred.
+     *
+     * @param tcp The desired pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @param angles Vector for storing the calculated angles in radian
+     * @return true if a possible state was calculated
+     */
+    bool inverseTransformation(const PoseVector &tcp, JointVector &angles) const;
+
+    /**
+     * Inverse kinematics which returns all branches within the joint limits.
+     *
+     * @param tcp The desired pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @param solutions Array for storing the solutions in radian
+     * @return the number of solutions (0 if the pose can't be reached)
+     */
+    int inverseTransformationAll(const PoseVector &tcp, JointVector solutions[MAX_IK_SOLUTIONS]) const;
+
+    /**
+     * Inverse kinematics which selects the branch with the shortest
+     * travel time from the given configuration (see travelTime()).
+     *
+     * @param tcp The desired pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @param current Axis values the arm starts from in radian
+     * @param angles Vector for storing the calculated angles in radian
+     * @param time Optional pointer which receives the travel time in seconds
+     * @return true if a possible state was calculated
+     */
+    bool inverseTransformationMinTravel(const PoseVector &tcp, const JointVector &current, JointVector &angles,
+                                        double *time = NULL) const;
+
+    /**
+     * Solves the inverse kinematics of a pose program which is driven in the
+     * given order. The branches of all poses are solved in parallel, then the
+     * branch sequence with the shortest total travel time is selected.
+     * Unreachable poses are skipped, the next pose starts from the previous
+     * reachable one.
+     *
+     * @param tcps Contiguous array of desired poses
+     * @param count Number of poses
+     * @param start Axis values the arm starts from in radian
+     * @param angles Array for storing the calculated angles (count elements)
+     * @param success Array for storing the result flag of each pose (count elements)
+     * @param totalTime Optional pointer which receives the travel time of the program in seconds
+     * @return the number of successfully solved poses
+     */
+    int inverseTransformationSequence(const PoseVector *tcps, int count, const JointVector &start, JointVector *angles,
+                                      bool *success, double *totalTime = NULL) const;
+
+    /**
+     * Sets the joint velocities which weight the travel time of each axis.
+     * The defaults are the datasheet values of ybparams.h.
+     *
+     * @param velocities Angular velocity of each joint in radian per second
+     */
+    void setJointVelocities(const JointVector &velocities);
+
+    /**
+     * Estimates the time of a synchronized point to point motion, which is
+     * the time the slowest joint needs at its velocity.
+     *
+     * @param from Axis values at the start in radian
+     * @param to Axis values at the end in radian
+     * @return the travel time in seconds
+     */
+    double travelTime(const JointVector &from, const JointVector &to) const;
+
+    /**
+     * Iterative inverse kinematics for small corrections, e.g. visual servoing.
+     * Starting at the given configuration, damped least squares steps with
+     * the analytic Jacobian are applied until the pose is reached within the
+     * tolerances or the iteration budget is used up. The cost per call is
+     * bounded by the maximum number of iterations.
+     *
+     * @param tcp The desired pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @param start Axis values to start from, e.g. the sensed axis values
+     *              or the previous solution
+     * @param angles Vector for storing the calculated angles in radian
+     * @param settings Tolerances, iteration budget and damping
+     * @param result Optional pointer which receives iterations and remaining errors
+     * @return true if the tolerances were reached within the joint limits
+     */
+    bool inverseTransformationIterative(const PoseVector &tcp, const JointVector &start, JointVector &angles,
+                                        const IterativeIKParameters &settings = IterativeIKParameters(),
+                                        IterativeIKResult *result = NULL) const;
+
+    /**
+     * Calculates the geometric Jacobian of the TCP from the DH frames.
+     *
+     * @param angles The axis values in radian
+     * @param jacobian Matrix which receives the Jacobian (6 x 5)
+     * @param transformation Matrix which receives the TCP transformation
+     */
+    void jacobian(const JointVector &angles, JacobianMatrix &jacobian, Matrix4d &transformation) const;
+
+    /**
+     * Solves the inverse kinematics for a whole list of poses, e.g. a pose
+     * program. The poses are distributed over all cores.
+     *
+     * @param tcps Contiguous array of desired poses
+     * @param count Number of poses
+     * @param angles Array for storing the calculated angles (count elements)
+     * @param success Array for storing the result flag of each pose (count elements)
+     * @return the number of successfully solved poses
+     */
+    int inverseTransformationBatch(const PoseVector *tcps, int count, JointVector *angles, bool *success) const;
+
+    /**
+     * Converts a pose vector (X, Y, Z, Roll, Pitch, Yaw) into a
+     * homogeneous transformation.
+     *
+     * @param tcp The pose to convert
+     * @param transformation Matrix for the result
+     */
+    static void poseToTransformation(const PoseVector &tcp, Matrix4d &transformation);
+
+    /**
+     * Converts a homogeneous transformation into a pose vector
+     * (X, Y, Z, Roll, Pitch, Yaw).
+     *
+     * @param transformation The transformation to convert
+     * @param tcp Vector for the result
+     */
+    static void transformationToPose(const Matrix4d &transformation, PoseVector &tcp);
+
+    /**
+     * Checks if all angles are inside the limits of the datasheet.
+     *
+     * @param angles Axis values in radian
+     * @return true if all angles are valid
+     */
+    static bool withinJointLimits(const JointVector &angles);
+
+private:
+
+    KinematicsSolver(const KinematicsSolver &);
+    KinematicsSolver &operator=(const KinematicsSolver &);
+
+    /**
+     * Calculates the DH matrix of one joint.
+     *
+     * @param joint Index of the joint (0 - 4)
+     * @param angle Axis value of the joint in radian
+     * @param dh Matrix which receives the transformation
+     */
+    void dhTransformation(int joint, double angle, Matrix4d &dh) const;
+
+    /**
+     * Solves all branches of the inverse kinematics, the results are taken
+     * from the IK cache if it is enabled.
+     *
+     * @param tcp The desired pose
+     * @param solutions Array for the solutions within the joint limits
+     * @return the number of solutions
+     */
+    int solveAllBranches(const PoseVector &tcp, JointVector solutions[MAX_IK_SOLUTIONS]) const;
+
+    /**
+     * Travel time which is minimized by the branch selection. The summed
+     * travel of all joints is added with a small weight, so of two branches
+     * with the same time the one with less motion is selected.
+     *
+     * @param from Axis values at the start in radian
+     * @param to Axis values at the end in radian
+     * @return the weighted travel time
+     */
+    double travelCost(const JointVector &from, const JointVector &to) const;
+
+    /**
+     * Solves the inverse kinematics for one configuration branch.
+     *
+     * @param transformation The desired TCP transformation
+     * @param backwards true if the arm should reach over its base
+     * @param elbowUp true for the elbow up solution of the planar chain
+     * @param angles Vector for storing the calculated angles
+     * @return true if the branch reaches the pose within the joint limits
+     */
+    bool solveBranch(const Matrix4d &transformation, bool backwards, bool elbowUp, JointVector &angles) const;
+
+    /** DH parameters of the chain */
+    DHParameters parameters;
+
+    /** Hash of the DH parameters and the joint limits */
+    uint64_t parameterHash;
+
+    /** Precalculated cosine and sine of the alpha parameters */
+    double cosAlpha[ARMJOINTS];
+    double sinAlpha[ARMJOINTS];
+
+    /** Reciprocal joint velocities in seconds per radian */
+    JointVector travelWeights;
+
+    /** true if the parameters equal YouBotChain, so the compile time chain is used */
+    bool compiledChain;
+
+    /** Cache for IK solutions (NULL if disabled) */
+    IKCache *cache;
 };
 
 #endif // KINEMATICSSOLVER_H
@@ -0,0 +1,258 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "LatencyProbes.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+/**
+ * Histograms of one thread.
+ */
+struct ThreadProbes
+{
+    /** Name of the thread in the reports */
+    string name;
+
+    /** One histogram per probe */
+    LatencyHistogram histograms[PROBE_COUNT];
+};
+
+/** Guards the list of threads (only used to add a thread and for the reports) */
+static mutex threadsMutex;
+
+/** Histograms of all threads which recorded a value, kept after the threads ended */
+static vector<ThreadProbes *> threads;
+
+/** Histograms of the calling thread */
+static thread_local ThreadProbes *localProbes = NULL;
+
+/**
+ * Returns the histograms of the calling thread and creates them on the first call.
+ *
+ * @return the histograms
+ */
+static ThreadProbes *threadProbes()
+{
+    if (localProbes == NULL)
+    {
+        localProbes = new ThreadProbes();
+
+        lock_guard<mutex> lock(threadsMutex);
+        localProbes->name = "thread " + to_string(threads.size());
+        threads.push_back(localProbes);
+    }
+    return localProbes;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        this->counts[i].store(0, memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other)
+{
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        this->counts[i].store(this->counts[i].load(memory_order_relaxed) + other.bucketCount(i), memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    uint64_t total = 0;
+
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        total += this->bucketCount(i);
+    }
+    return total;
+}
+
+double LatencyHistogram::percentile(double percentile) const
+{
+    uint64_t total = this->count();
+    uint64_t rank = (uint64_t) ceil(percentile / 100. * total);
+    uint64_t sum = 0;
+
+    rank = max<uint64_t>(rank, 1);
+    for (int i = 0; i < BUCKETS && total > 0; i++)
+    {
+        sum += this->bucketCount(i);
+
+        if (sum >= rank)
+        {
+            return (bucketLow(i) + bucketHigh(i)) / 2.;
+        }
+    }
+    return 0;
+}
+
+double LatencyHistogram::mean() const
+{
+    double sum = 0;
+    uint64_t total = 0;
+
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        uint64_t count = this->bucketCount(i);
+        sum += count * (bucketLow(i) + bucketHigh(i)) / 2.;
+        total += count;
+    }
+    return (total > 0) ? sum / total : 0;
+}
+
+int LatencyHistogram::buckets()
+{
+    return BUCKETS;
+}
+
+uint64_t LatencyHistogram::bucketCount(int bucket) const
+{
+    return this->counts[bucket].load(memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::bucketLow(int bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    int exponent = 7 + (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS;
+    int64_t sub = SUB_BUCKETS + (bucket - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+    return sub << (exponent - 6);
+}
+
+int64_t LatencyHistogram::bucketHigh(int bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    int exponent = 7 + (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS;
+    return bucketLow(bucket) + (((int64_t) 1) << (exponent - 6)) - 1;
+}
+
+void LatencyProbes::record(LATENCY_PROBE probe, int64_t nanoseconds)
+{
+    threadProbes()->histograms[probe].record(nanoseconds);
+}
+
+void LatencyProbes::setThreadName(const string &name)
+{
+    ThreadProbes *probes = threadProbes();
+
+    lock_guard<mutex> lock(threadsMutex);
+    probes->name = name;
+}
+
+const char *LatencyProbes::probeName(LATENCY_PROBE probe)
+{
+    static const char *names[PROBE_COUNT] = {"sendAxisCommand",
+                                             "readJointState",
+                                             "getSensedPosition",
+                                             "guiRefresh",
+                                             "controlCycle",
+                                             "motionStart"};
+    return names[probe];
+}
+
+void LatencyProbes::merge(LATENCY_PROBE probe, LatencyHistogram &histogram)
+{
+    lock_guard<mutex> lock(threadsMutex);
+
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        histogram.add(threads[t]->histograms[probe]);
+    }
+}
+
+void LatencyProbes::printReport(FILE *file)
+{
+    lock_guard<mutex> lock(threadsMutex);
+
+#ifndef LATENCY_PROBES
+    fprintf(file, "Latency probes are disabled (compile with LATENCY_PROBES)\n");
+#endif
+    fprintf(file, "%-18s %-12s %10s %10s %10s %10s %10s %10s\n", "Probe [us]", "Thread", "Count", "Mean", "50%",
+            "99%", "99.9%", "Max.");
+
+    for (int p = 0; p < PROBE_COUNT; p++)
+    {
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            const LatencyHistogram &histogram = threads[t]->histograms[p];
+            uint64_t count = histogram.count();
+
+            if (count > 0)
+            {
+                fprintf(file, "%-18s %-12s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", probeName((LATENCY_PROBE) p),
+                        threads[t]->name.c_str(), (unsigned long long) count, histogram.mean() / 1000.,
+                        histogram.percentile(50) / 1000., histogram.percentile(99) / 1000.,
+                        histogram.percentile(99.9) / 1000., histogram.percentile(100) / 1000.);
+            }
+        }
+    }
+}
+
+bool LatencyProbes::writeFile(const string &fileName)
+{
+    FILE *file = fopen(fileName.c_str(), "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    lock_guard<mutex> lock(threadsMutex);
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        fprintf(file, "# thread %zu: %s\n", t, threads[t]->name.c_str());
+    }
+    fprintf(file, "# probe thread bucket_low_ns bucket_high_ns count\n");
+
+    for (int p = 0; p < PROBE_COUNT; p++)
+    {
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            const LatencyHistogram &histogram = threads[t]->histograms[p];
+
+            for (int i = 0; i < LatencyHistogram::buckets(); i++)
+            {
+                uint64_t count = histogram.bucketCount(i);
+
+                if (count > 0)
+                {
+                    fprintf(file, "%s %zu %lld %lld %llu\n", probeName((LATENCY_PROBE) p), t,
+                            (long long) LatencyHistogram::bucketLow(i), (long long) LatencyHistogram::bucketHigh(i),
+                            (unsigned long long) count);
+                }
+            }
+        }
+    }
+    return fclose(file) == 0;
+}
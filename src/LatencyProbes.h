@@ -0,0 +1,292 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LATENCYPROBES_H
+#define LATENCYPROBES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+/**
+ * Enumerator definition for the measured code paths
+ */
+typedef enum
+{
+    PROBE_SEND_AXIS_COMMAND,
+    PROBE_READ_JOINT_STATE,
+    PROBE_GET_SENSED_POSITION,
+    PROBE_GUI_REFRESH,
+    PROBE_CONTROL_CYCLE,
+    PROBE_MOTION_START,
+    PROBE_COUNT
+} LATENCY_PROBE;
+
+/**
+ * An object of this class counts latencies in logarithmic buckets with
+ * 64 linear sub buckets each (HDR histogram), so every value from 1 ns to
+ * about 68 s is kept with an error below 1.6 %.
+ *
+ * Recording is a single increment without locking. The histogram must be
+ * written by one thread only, other threads may read it meanwhile.
+ *
+ * @author Stefan Wilkes
+ */
+class LatencyHistogram
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an empty histogram.
+     */
+    LatencyHistogram();
+
+    /**
+     * Counts a value.
+     *
+     * @param nanoseconds The latency
+     */
+    void record(int64_t nanoseconds)
+    {
+        int index = bucketIndex(nanoseconds);
+        this->counts[index].store(this->counts[index].load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    /**
+     * Adds the counts of another histogram.
+     *
+     * @param other The histogram to add
+     */
+    void add(const LatencyHistogram &other);
+
+    /**
+     * Returns the number of values.
+     *
+     * @return the number of recorded values
+     */
+    uint64_t count() const;
+
+    /**
+     * Returns the value below which the given part of all values lies.
+     *
+     * @param percentile The percentile (0 - 100)
+     * @return the latency in nanoseconds (0 if the histogram is empty)
+     */
+    double percentile(double percentile) const;
+
+    /**
+     * Returns the mean of all values.
+     *
+     * @return the mean latency in nanoseconds
+     */
+    double mean() const;
+
+    /**
+     * Returns the number of buckets.
+     *
+     * @return the number of buckets
+     */
+    static int buckets();
+
+    /**
+     * Returns the count of a bucket.
+     *
+     * @param bucket Index of the bucket
+     * @return the number of values in the bucket
+     */
+    uint64_t bucketCount(int bucket) const;
+
+    /**
+     * Returns the smallest value of a bucket.
+     *
+     * @param bucket Index of the bucket
+     * @return the lower bound in nanoseconds
+     */
+    static int64_t bucketLow(int bucket);
+
+    /**
+     * Returns the largest value of a bucket.
+     *
+     * @param bucket Index of the bucket
+     * @return the upper bound in nanoseconds
+     */
+    static int64_t bucketHigh(int bucket);
+
+private:
+
+    /** Number of linear sub buckets per power of two */
+    static const int SUB_BUCKETS = 64;
+
+    /** Largest power of two of the range */
+    static const int MAX_EXPONENT = 35;
+
+    /** Number of buckets (linear range and the logarithmic ranges) */
+    static const int BUCKETS = 2 * SUB_BUCKETS + (MAX_EXPONENT - 6) * SUB_BUCKETS;
+
+    /**
+     * Returns the bucket of a value.
+     *
+     * @param nanoseconds The value
+     * @return the index of the bucket
+     */
+    static int bucketIndex(int64_t nanoseconds)
+    {
+        if (nanoseconds < 2 * SUB_BUCKETS)
+        {
+            return (nanoseconds > 0) ? (int) nanoseconds : 0;
+        }
+
+        int exponent = 63 - __builtin_clzll((uint64_t) nanoseconds);
+        if (exponent > MAX_EXPONENT)
+        {
+            return BUCKETS - 1;
+        }
+        return 2 * SUB_BUCKETS + (exponent - 7) * SUB_BUCKETS + (int) (nanoseconds >> (exponent - 6)) - SUB_BUCKETS;
+    }
+
+    /** Number of values per bucket */
+    atomic<uint64_t> counts[BUCKETS];
+};
+
+/**
+ * Collection of the latency histograms of all threads.
+ *
+ * Each thread records into its own histograms, which are created on the
+ * first record of the thread. The probes are compiled only if
+ * LATENCY_PROBES is defined, otherwise the macros LATENCY_SCOPE and
+ * LATENCY_RECORD are empty and the report contains no values.
+ *
+ * @author Stefan Wilkes
+ */
+class LatencyProbes
+{
+public:
+
+    /**
+     * Counts a latency in the histogram of the calling thread.
+     *
+     * @param probe The measured code path
+     * @param nanoseconds The latency
+     */
+    static void record(LATENCY_PROBE probe, int64_t nanoseconds);
+
+    /**
+     * Counts the time since a given start in the histogram of the calling thread.
+     *
+     * @param probe The measured code path
+     * @param start Start of the measurement
+     */
+    static void recordSince(LATENCY_PROBE probe, const chrono::steady_clock::time_point &start)
+    {
+        record(probe, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+
+    /**
+     * Names the calling thread in the reports.
+     *
+     * @param name Name of the thread
+     */
+    static void setThreadName(const string &name);
+
+    /**
+     * Returns the name of a probe.
+     *
+     * @param probe The probe
+     * @return the name
+     */
+    static const char *probeName(LATENCY_PROBE probe);
+
+    /**
+     * Merges the histograms of all threads for one probe.
+     *
+     * @param probe The probe
+     * @param histogram Receives the counts (must be empty)
+     */
+    static void merge(LATENCY_PROBE probe, LatencyHistogram &histogram);
+
+    /**
+     * Prints the percentiles of all probes per thread.
+     *
+     * @param file The output, e.g. stdout
+     */
+    static void printReport(FILE *file);
+
+    /**
+     * Writes all non-empty buckets of all threads and probes into a text
+     * file. Each line holds: probe thread bucket_low_ns bucket_high_ns count,
+     * the names of the threads are listed in comment lines (#) first.
+     *
+     * @param fileName Name of the file
+     * @return true if the file was written
+     */
+    static bool writeFile(const string &fileName);
+};
+
+/**
+ * Measures the time from its construction to the end of the scope.
+ */
+class LatencyScope
+{
+public:
+
+    /**
+     * Constructor:
+     * Starts the measurement.
+     *
+     * @param probe The measured code path
+     */
+    explicit LatencyScope(LATENCY_PROBE probe) : probe(probe), start(chrono::steady_clock::now())
+    {
+    }
+
+    /**
+     * Destructor:
+     * Records the time.
+     */
+    ~LatencyScope()
+    {
+        LatencyProbes::recordSince(this->probe, this->start);
+    }
+
+private:
+
+    /** The measured code path */
+    LATENCY_PROBE probe;
+
+    /** Start of the measurement */
+    chrono::steady_clock::time_point start;
+};
+
+#ifdef LATENCY_PROBES
+#define LATENCY_SCOPE(probe) LatencyScope latencyScope(probe)
+#define LATENCY_RECORD(probe, start) LatencyProbes::recordSince(probe, start)
+#else
+#define LATENCY_SCOPE(probe)
+#define LATENCY_RECORD(probe, start)
+#endif
+
+#endif // LATENCYPROBES_H
@@ -21,34 +21,213 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <cmath>
+#include <chrono>
+#include <limits>
+#include <pthread.h>
+#include <sstream>
 #include "Manipulator.h"
 #include "ybparams.h"
 
+/**
+ * Converts an angle to a kuka angle (0 is left).
+ *
+ * @param joint Index of the joint (0 - 4)
+ * @param angle Angle in radian (0 is centered)
+ * @return the kuka angle in radian
+ */
+static inline double toKukaAngle(int joint, double angle)
+{
+    return angle - KUKA_ANGLE_OFFSET[joint];
+}
+
+/**
+ * Checks a kuka angle against the limits of the motor controllers.
+ *
+ * @param joint Index of the joint (0 - 4)
+ * @param angle Kuka angle in radian
+ * @return true if the angle is valid
+ */
+static inline bool validKukaAngle(int joint, double angle)
+{
+    return (angle > BOTTOM_LIMIT_YB[joint]) && (angle < TOP_LIMIT_YB[joint]);
+}
+
+/**
+ * Returns the microseconds since a given time.
+ *
+ * @param start The start time
+ * @return the elapsed time in microseconds
+ */
+static inline double elapsedUs(const chrono::steady_clock::time_point &start)
+{
+    return chrono::duration<double, std::micro>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Returns the seconds since a given time and restarts it.
+ *
+ * @param start The start time, set to now
+ * @return the elapsed time in seconds
+ */
+static inline double lapSeconds(chrono::steady_clock::time_point &start)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double time = chrono::duration<double>(now - start).count();
+    start = now;
+
+    return time;
+}
+
 Manipulator::Manipulator()
 {
+    this->initialiseControl();
+}
+
+Manipulator::Manipulator(const string &name, const string &path, const string &calibrationFile, bool forceCalibration)
+{
+    /* The connection to the arm is part of the start time */
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ArmBackend *backend = new YouBotBackend(name, path);
 
+    this->initialiseArm(backend, name, path, calibrationFile, forceCalibration, start);
 }
 
-Manipulator::Manipulator(const string &name, const string &path)
+Manipulator::Manipulator(ArmBackend *backend, const string &name, const string &path, const string &calibrationFile,
+                         bool forceCalibration)
 {
-    this->kukaArm = new YouBotManipulator(name, path);
+    this->initialiseArm(backend, name, path, calibrationFile, forceCalibration, chrono::steady_clock::now());
+}
+
+Manipulator::~Manipulator()
+{
+    /* The control thread uses the solver, so it's deleted after the thread */
+    this->stopCycle();
+    delete this->backend;
+    delete this->solver;
+}
+
+void Manipulator::initialiseArm(ArmBackend *backend, const string &name, const string &path,
+                                const string &calibrationFile, bool forceCalibration,
+                                const chrono::steady_clock::time_point &start)
+{
+    chrono::steady_clock::time_point step = start;
+
+    this->initialiseControl();
+    this->backend = backend;
+    StartupTiming &timing = this->startupTiming;
+    timing.driver = lapSeconds(step);
+
+    /* Enable control and initialise the arm, the driver skips commutated joints */
+    this->backend->doJointCommutation();
+    timing.commutation = lapSeconds(step);
 
-    /* Enable control and initialise the arm */
-    this->kukaArm->doJointCommutation();
-    this->kukaArm->calibrateManipulator();
+    /* Skip the calibration only if the stored angles still match the encoders */
+    JointVector sensed;
+    bool stored = !calibrationFile.empty() && this->calibration.open(calibrationFile);
+    timing.warmStart = stored && !forceCalibration && this->verifyCalibration(sensed);
+    timing.verification = lapSeconds(step);
 
-    /* The arm has 5 angles and no desired position */
-    this->latestDesiredPosition = VectorXd(ARMJOINTS);
+    /* A crash during the calibration leaves an invalid state */
+    bool calibrate = forceCalibration || (stored && !timing.warmStart);
+    if (calibrate)
+    {
+        this->calibration.setCalibrated(false);
+    }
+    this->backend->calibrateManipulator(calibrate);
+    this->calibration.setCalibrated(true);
+    timing.calibration = lapSeconds(step);
 
-    /* Drive arm to home position, to get definied value */
-    this->setPose(HOME_POSITION);
+    /* The arm has no desired position until the first command */
+    this->latestDesiredPosition.setConstant(numeric_limits<double>::quiet_NaN());
+
+    /* A warm arm holds its pose, otherwise drive arm to home position, to get definied value */
+    if (!timing.warmStart || !this->setAxis(sensed))
+    {
+        this->setPose(HOME_POSITION);
+    }
 
     /* Create a new kinematics solver */
     this->solver = new KinematicsSolver();
 
     JointVelocitySetpoint data;
     data.angularVelocity = 0.001 * radian_per_second;
-    this->kukaArm->getArmJoint(1).setData(data);
+    this->backend->setJointData(1, data);
+
+    /* Optional limits of the joints for the synchronized motions */
+    MotionLimits limits;
+    readJointLimits(name, path, limits);
+    this->setJointLimits(limits);
+
+    /* Read the arm state with the rate of the EtherCAT communication */
+    int cycleTime = DEFAULT_CYCLE_TIME_US;
+    try
+    {
+        ConfigFile configFile("youbot-ethercat.cfg", path);
+        configFile.readInto(cycleTime, "EtherCAT", "EtherCATUpdateRate_[usec]");
+    }
+    catch (std::exception &e)
+    {
+        cycleTime = DEFAULT_CYCLE_TIME_US;
+    }
+    this->startCycle(cycleTime);
+
+    timing.configuration = lapSeconds(step);
+    timing.total = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void Manipulator::initialiseControl()
+{
+    this->backend = NULL;
+    this->solver = NULL;
+    this->commandStatistics = CommandStatistics();
+    this->cycleRunning = false;
+    this->cycleTime = DEFAULT_CYCLE_TIME_US;
+    this->controlCore = -1;
+    this->cycleCount = 0;
+
+    /* The driver resizes the buffers to the number of joints, which they already have */
+    this->sensedAngleData.resize(ARMJOINTS);
+    this->sensedVelocityData.resize(ARMJOINTS);
+    this->sensedCurrentData.resize(ARMJOINTS);
+    this->sensedTorqueData.resize(ARMJOINTS);
+    this->setpointData.resize(ARMJOINTS);
+
+    /* The trajectory buffer is allocated once, the control thread never allocates it */
+    this->trajectoryBuffer.resize(MAX_TRAJECTORY_SETPOINTS);
+    this->streaming = false;
+    this->streamIndex = 0;
+    this->streamCount = 0;
+    this->lastSetpoint.setConstant(numeric_limits<double>::quiet_NaN());
+    this->motionTarget = this->lastSetpoint;
+    this->executedCommand = 0;
+    this->commandCounter = 0;
+    this->desiredResync = false;
+    this->publishSetpoint();
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        this->resyncJoints[i] = false;
+    }
+
+    /* The control thread plans the synchronized motions, the profile keeps the memory of two poses */
+    JointVector rest[2] = {JointVector::Zero(), JointVector::Zero()};
+    this->synchronizedProfile.set(rest, 2);
+    this->motionLimits.store(this->jointLimits);
+    this->streamingProfile = false;
+
+    this->motionCounter = 0;
+    this->pendingMotion = 0;
+    this->settledCycles = 0;
+    this->completedMotion = 0;
+    this->rejectedMotion = 0;
+    this->arrivalCriteria.store(ArrivalCriteria());
+    this->motionStartPending = false;
+    this->sensedAngles.setZero();
+
+    this->gripperCounter = 0;
+    this->gripperScheduled = false;
+    this->requestedGripper = 0;
+    this->completedGripper = 0;
 }
 
 bool Manipulator::setPose(STORED_POSES pose)
@@ -57,23 +236,26 @@ bool Manipulator::setPose(STORED_POSES pose)
 
     if (pose == HOME_POSITION)
     {
-        VectorXi axis(ARMJOINTS);
+        JointVectorDeg axis;
         axis << -168, -64, 145, -101, -161;
         poseSet = this->setAxis(axis);
     }
     else if (pose == CANDLE_POSITION)
     {
-        VectorXd axisRad(ARMJOINTS);
-        axisRad << 0, 0, 0, 0, 0;
-        poseSet = this->setAxis(axisRad);
+        poseSet = this->setAxis(JointVector::Zero().eval());
     }
     return poseSet;
 }
 
 bool Manipulator::setPose(VectorXd &tcp)
 {
-    VectorXd angles;
-    bool success = this->solver->inverseTransformation(tcp, angles);
+    return (tcp.size() == 6) && this->setPose(PoseVector(tcp));
+}
+
+bool Manipulator::setPose(const PoseVector &tcp)
+{
+    JointVector angles;
+    bool success = this->solveInverseKinematics(tcp, angles);
 
     if (success)
     {
@@ -82,36 +264,208 @@ bool Manipulator::setPose(VectorXd &tcp)
     return success;
 }
 
+bool Manipulator::setPoseIncremental(VectorXd &tcp, bool warmStartFromSensed, IterativeIKResult *result)
+{
+    return (tcp.size() == 6) && this->setPoseIncremental(PoseVector(tcp), warmStartFromSensed, result);
+}
+
+bool Manipulator::setPoseIncremental(const PoseVector &tcp, bool warmStartFromSensed, IterativeIKResult *result)
+{
+    JointVector current;
+
+    if (warmStartFromSensed)
+    {
+        this->getSensedAxis(current);
+    }
+    else
+    {
+        this->getLatestDesiredAxis(current);
+    }
+
+    JointVector angles;
+    bool success = this->solver->inverseTransformationIterative(tcp, current, angles, IterativeIKParameters(), result);
+
+    return success && this->setAxis(angles);
+}
+
 bool Manipulator::setAxis(VectorXd &targetAnglesRad)
+{
+    return (targetAnglesRad.size() == ARMJOINTS) && this->setAxis(JointVector(targetAnglesRad));
+}
+
+bool Manipulator::setAxis(const JointVector &targetAnglesRad)
 {
     bool validVector = true;
+    ArmCommand command;
+    command.type = ArmCommand::AXIS;
 
-    for (int i = 1; i <= ARMJOINTS && validVector; i++)
+    /* Check all angles before anything is sent, so the arm never gets a partial command */
+    for (int i = 0; i < ARMJOINTS && validVector; i++)
     {
-        validVector = this->setAxis(i, targetAnglesRad[i - 1]);
+        command.angles[i] = toKukaAngle(i, targetAnglesRad[i]);
+        command.changed[i] = true;
+        validVector = validKukaAngle(i, command.angles[i]);
     }
 
-    return validVector;
+    if (validVector && this->queueCommand(command))
+    {
+        this->latestDesiredPosition = command.angles;
+        this->desiredResync = false;
+        return true;
+    }
+    return false;
 }
 
-bool Manipulator::setAxis(VectorXi &targetAnglesDeg)
+bool Manipulator::streamTrajectory(const Trajectory &trajectory)
+{
+    if (this->streaming || !(trajectory.duration() > 0))
+    {
+        return false;
+    }
+
+    /* The trajectory has to start where the arm was commanded to, after a cut trajectory the control thread checks it */
+    bool valid = true;
+    if (!this->desiredResync)
+    {
+        JointVector start;
+        JointVector first;
+        this->getLatestDesiredAxis(start);
+        trajectory.sample(0, first);
+        valid = !((first - start).cwiseAbs().maxCoeff() > TRAJECTORY_START_TOLERANCE);
+    }
+
+    /* Sample all setpoints in advance, so an invalid setpoint rejects the whole trajectory */
+    double step = this->cycleTime * 1e-6;
+    int count = (int) ceil(trajectory.duration() / step) + 1;
+    valid = valid && (count <= (int) this->trajectoryBuffer.size());
+
+    JointVector position;
+    for (int n = 0; n < count && valid; n++)
+    {
+        trajectory.sample(n * step, position);
+
+        for (int i = 0; i < ARMJOINTS && valid; i++)
+        {
+            this->trajectoryBuffer[n][i] = toKukaAngle(i, position[i]);
+            valid = validKukaAngle(i, this->trajectoryBuffer[n][i]);
+        }
+    }
+
+    ArmCommand command;
+    command.type = ArmCommand::TRAJECTORY_START;
+    command.setpoints = count;
+
+    /* The buffer belongs to the control thread until the trajectory is finished */
+    this->streaming = valid;
+    if (valid && !this->queueCommand(command))
+    {
+        this->streaming = false;
+        valid = false;
+    }
+
+    /* The end is the desired position unless the control thread rejects the start */
+    if (valid)
+    {
+        this->latestDesiredPosition = this->trajectoryBuffer[count - 1];
+    }
+    return valid;
+}
+
+void Manipulator::stopTrajectory()
+{
+    ArmCommand command;
+    command.type = ArmCommand::TRAJECTORY_STOP;
+
+    /* The arm stops wherever the trajectory is when the control thread gets the command */
+    bool cut = this->streaming;
+    if (this->queueCommand(command) && cut)
+    {
+        this->startResync();
+    }
+}
+
+bool Manipulator::trajectoryActive()
+{
+    return this->streaming;
+}
+
+bool Manipulator::setAxisSynchronized(VectorXd &targetAnglesRad)
+{
+    return (targetAnglesRad.size() == ARMJOINTS) && this->setAxisSynchronized(JointVector(targetAnglesRad));
+}
+
+bool Manipulator::setAxisSynchronized(const JointVector &targetAnglesRad)
 {
+    if (this->streaming)
+    {
+        return false;
+    }
+
     bool validVector = true;
+    ArmCommand command;
+    command.type = ArmCommand::AXIS_SYNCHRONIZED;
+
+    for (int i = 0; i < ARMJOINTS && validVector; i++)
+    {
+        command.angles[i] = toKukaAngle(i, targetAnglesRad[i]);
+        command.changed[i] = true;
+        validVector = validKukaAngle(i, command.angles[i]);
+    }
 
-   for (int i = 1; i <= ARMJOINTS && validVector; i++)
+    /* The control thread plans the motion from its latest setpoint and owns the stream until the target is sent */
+    this->streaming = validVector;
+    if (validVector && !this->queueCommand(command))
     {
-        validVector = this->setAxis(i, targetAnglesDeg[i - 1]);
+        this->streaming = false;
+        validVector = false;
+    }
+
+    if (validVector)
+    {
+        this->latestDesiredPosition = command.angles;
+        this->desiredResync = false;
     }
     return validVector;
 }
 
+bool Manipulator::setAxis(VectorXi &targetAnglesDeg)
+{
+    return (targetAnglesDeg.size() == ARMJOINTS) && this->setAxis(JointVectorDeg(targetAnglesDeg));
+}
+
+bool Manipulator::setAxis(const JointVectorDeg &targetAnglesDeg)
+{
+    /* Convert angles to radian */
+    return this->setAxis(JointVector((M_PI / 180.) * targetAnglesDeg.cast<double>()));
+}
+
 bool Manipulator::setAxis(int jointIndex, double targetAngleRad)
 {
-    /* Convert angle to kuka angle (0 is left) */
-    JointAngleSetpoint angle;
-    angle.angle = ((jointIndex == 3) ? targetAngleRad - TOP_LIMIT_SD[jointIndex - 1] : targetAngleRad - BOTTOM_LIMIT_SD[jointIndex - 1]) * radian;
+    /* Check if joint index is valid */
+    if (jointIndex < 1 || jointIndex > ARMJOINTS)
+    {
+        return false;
+    }
+
+    /* Convert angle to kuka angle (0 is left), all other joints keep the setpoint of the control thread */
+    ArmCommand command;
+    command.type = ArmCommand::AXIS;
+    command.angles[jointIndex - 1] = toKukaAngle(jointIndex - 1, targetAngleRad);
+    command.changed[jointIndex - 1] = true;
 
-    return this->sendAxisCommandToManipulator(jointIndex, angle);
+    /* A cut trajectory leaves the other joints where the control thread stopped it */
+    bool cut = this->streaming;
+    if (validKukaAngle(jointIndex - 1, command.angles[jointIndex - 1]) && this->queueCommand(command))
+    {
+        if (cut)
+        {
+            this->startResync();
+        }
+        this->latestDesiredPosition[jointIndex - 1] = command.angles[jointIndex - 1];
+        this->resyncJoints[jointIndex - 1] = true;
+        return true;
+    }
+    return false;
 }
 
 bool Manipulator::setAxis(int jointIndex, int targetAngleDeg)
@@ -124,21 +478,32 @@ bool Manipulator::setAxis(int jointIndex, int targetAngleDeg)
 
 void Manipulator::getSensedAxis(VectorXd &axisAnglesRad)
 {
-    vector<JointSensedAngle> data;
-    this->kukaArm->getJointData(data);
+    JointVector angles;
+    this->getSensedAxis(angles);
+    axisAnglesRad = angles;
+}
+
+void Manipulator::getSensedAxis(JointVector &axisAnglesRad)
+{
+    JointStateSnapshot state;
+    this->jointState.load(state);
+    axisAnglesRad = state.angles;
+}
+
+void Manipulator::getSensedAxis(VectorXi &axisAnglesDeg)
+{
+    JointVectorDeg angles;
+    this->getSensedAxis(angles);
 
     for (int i = 0; i < ARMJOINTS; i++)
     {
-        /* Convert kuka angle to angle (0 is centered) */
-        axisAnglesRad[i] = quantity_cast<double>(data[i].angle);
-        axisAnglesRad[i] += (i == 2) ? TOP_LIMIT_SD[i] : BOTTOM_LIMIT_SD[i];
+        axisAnglesDeg[i] = angles[i];
     }
 }
 
-void Manipulator::getSensedAxis(VectorXi &axisAnglesDeg)
+void Manipulator::getSensedAxis(JointVectorDeg &axisAnglesDeg)
 {
-    /* Get current angles in radians */
-    VectorXd axisAnglesRad(ARMJOINTS);
+    JointVector axisAnglesRad;
     this->getSensedAxis(axisAnglesRad);
 
     /* Convert to degrees */
@@ -150,80 +515,978 @@ void Manipulator::getSensedAxis(VectorXi &axisAnglesDeg)
 
 bool Manipulator::getSensedPosition(VectorXd &tcp)
 {
-    /* Get current axis state */
-    VectorXd angles(ARMJOINTS);
-    this->getSensedAxis(angles);
+    PoseVector pose;
+    bool valid = this->getSensedPosition(pose);
+    tcp = pose;
 
-    /* Do forward transformation */
-    return this->solver->forwardTransformation(angles, tcp);
+    return valid;
 }
 
-bool Manipulator::sendAxisCommandToManipulator(int jointIndex, JointAngleSetpoint &targetAngle)
+bool Manipulator::getSensedPosition(PoseVector &tcp)
 {
-    /* Check if target angle is valid */
-    bool validAngle = (targetAngle.angle > (BOTTOM_LIMIT_YB[jointIndex - 1] * radian)) && (targetAngle.angle < (TOP_LIMIT_YB[jointIndex - 1] * radian));
+    LATENCY_SCOPE(PROBE_GET_SENSED_POSITION);
 
-    /* Check if joint index is valid */
-    bool validIndex = (jointIndex >= 1) && (jointIndex <= ARMJOINTS);
+    /* The forward transformation was done when the state was read */
+    JointStateSnapshot state;
+    this->jointState.load(state);
+    tcp = state.tcp;
+
+    return state.tcpValid;
+}
+
+bool Manipulator::setControlCore(int core)
+{
+    this->controlCore = core;
+
+    if (!this->cycleThread.joinable())
+    {
+        return true;
+    }
+
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    for (int i = 0; i < CPU_SETSIZE; i++)
+    {
+        if (core < 0 || i == core)
+        {
+            CPU_SET(i, &cores);
+        }
+    }
+    return pthread_setaffinity_np(this->cycleThread.native_handle(), sizeof(cores), &cores) == 0;
+}
+
+void Manipulator::getStartupTiming(StartupTiming &timing)
+{
+    timing = this->startupTiming;
+}
+
+void Manipulator::getSensedState(JointStateSnapshot &state)
+{
+    this->jointState.load(state);
+}
+
+int Manipulator::getSensedHistory(JointStateSnapshot *states, int maximum)
+{
+    return (maximum > 0) ? (int) this->telemetry.read(states, maximum) : 0;
+}
+
+int Manipulator::getSensedHistoryCapacity()
+{
+    return this->telemetry.capacity();
+}
+
+bool Manipulator::startRecording(const string &fileName)
+{
+    return this->recorder.open(fileName, this->cycleTime);
+}
+
+void Manipulator::stopRecording()
+{
+    this->recorder.close();
+}
+
+void Manipulator::getRecorderStatistics(RecorderStatistics &statistics)
+{
+    this->recorder.getStatistics(statistics);
+}
+
+double Manipulator::getJointStateAge()
+{
+    JointStateSnapshot state;
+    this->jointState.load(state);
+
+    return chrono::duration<double>(chrono::steady_clock::now() - state.timestamp).count();
+}
+
+bool Manipulator::readJointState(JointStateSnapshot &state)
+{
+    LATENCY_SCOPE(PROBE_READ_JOINT_STATE);
+    bool stateRead = true;
+    vector<JointSensedAngle> &angles = this->sensedAngleData;
+    vector<JointSensedVelocity> &velocities = this->sensedVelocityData;
+    vector<JointSensedCurrent> &currents = this->sensedCurrentData;
+    vector<JointSensedTorque> &torques = this->sensedTorqueData;
+
+    try
+    {
+        this->backend->getJointData(angles);
+        this->backend->getJointData(velocities);
+        this->backend->getJointData(currents);
+        this->backend->getJointData(torques);
+
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            /* Convert kuka angle to angle (0 is centered), the units are SI already */
+            state.angles[i] = angles[i].angle.value() + KUKA_ANGLE_OFFSET[i];
+            state.velocities[i] = velocities[i].angularVelocity.value();
+            state.currents[i] = currents[i].current.value();
+            state.torques[i] = torques[i].torque.value();
+        }
+    }
+    catch (std::exception &e)
+    {
+        stateRead = false;
+    }
+    return stateRead;
+}
+
+bool Manipulator::verifyCalibration(JointVector &angles)
+{
+    JointVector stored;
+    if (!this->calibration.load(stored))
+    {
+        return false;
+    }
+
+    /* The driver keeps its calibration flag in a user variable of each motor controller */
+    YouBotSlaveMailboxMsg flag;
+    flag.stctOutput.moduleAddress = DRIVE;
+    flag.stctOutput.commandNumber = GGP;
+    flag.stctOutput.typeNumber = CALIBRATION_FLAG_VARIABLE;
+    flag.stctOutput.motorNumber = USER_VARIABLE_BANK;
+    flag.stctOutput.value = 0;
 
-    if (validAngle && validIndex)
+    bool valid = true;
+    try
     {
-        try
+        for (int i = 0; i < ARMJOINTS && valid; i++)
         {
-            this->kukaArm->getArmJoint(jointIndex).setData(targetAngle);
-            this->latestDesiredPosition[jointIndex - 1] = quantity_cast<double>(targetAngle.angle);
+            flag.stctInput.value = 0;
+            this->backend->getConfigurationParameter(i + 1, flag);
+            valid = (flag.stctInput.value == 1);
         }
-        catch (std::exception e)
+
+        if (valid)
         {
-            validAngle = false;
+            this->backend->getJointData(this->sensedAngleData);
         }
     }
-    return validAngle && validIndex;
+    catch (std::exception &e)
+    {
+        valid = false;
+    }
+
+    for (int i = 0; i < ARMJOINTS && valid; i++)
+    {
+        angles[i] = this->sensedAngleData[i].angle.value() + KUKA_ANGLE_OFFSET[i];
+        valid = (fabs(angles[i] - stored[i]) <= CALIBRATION_POSITION_TOLERANCE);
+    }
+    return valid;
 }
 
-bool Manipulator::prePlanMotion(VectorXd &tcp, VectorXd &angles)
+bool Manipulator::publishJointState(JointStateSnapshot &state)
 {
-    return this->solver->inverseTransformation(tcp, angles);
+    if (!this->readJointState(state))
+    {
+        return false;
+    }
+
+    state.tcpValid = this->solver->forwardTransformation(state.angles, state.tcp);
+    state.cycle = this->cycleCount++;
+    state.timestamp = chrono::steady_clock::now();
+    this->jointState.store(state);
+    this->telemetry.push(state);
+    this->recorder.recordState(state.cycle, state.timestamp, state.angles, state.velocities, state.currents,
+                               state.torques);
+    this->calibration.update(state.cycle, state.angles);
+
+    return true;
 }
 
-void Manipulator::openGripper()
+void Manipulator::detectArrival(const JointStateSnapshot &state)
 {
-    this->kukaArm->getArmGripper().open();
+    /* A trajectory arrives after its last setpoint was sent */
+    if (this->pendingMotion == 0 || this->streamIndex < this->streamCount)
+    {
+        return;
+    }
+
+    ArrivalCriteria criteria;
+    this->arrivalCriteria.load(criteria);
+    bool settled = true;
+
+    /* Joints without a setpoint have no target */
+    for (int i = 0; i < ARMJOINTS && settled; i++)
+    {
+        settled = std::isnan(this->motionTarget[i]) ||
+                  ((abs(toKukaAngle(i, state.angles[i]) - this->motionTarget[i]) <= criteria.positionTolerance[i]) &&
+                   (abs(state.velocities[i]) <= criteria.velocityTolerance[i]));
+    }
+    this->settledCycles = settled ? this->settledCycles + 1 : 0;
+
+    if (this->settledCycles * this->cycleTime * 1e-6 < criteria.settleTime)
+    {
+        return;
+    }
+
+    unsigned long motion = this->pendingMotion;
+    this->pendingMotion = 0;
+
+    /* The lock is only taken once per motion, waiting threads hold it shortly */
+    lock_guard<mutex> lock(this->arrivalMutex);
+    this->completedMotion.store(motion, memory_order_release);
+    this->arrivalCondition.notify_all();
+
+    if (this->motionCallback)
+    {
+        this->motionCallback(motion);
+    }
 }
 
-void Manipulator::closeGripper()
+void Manipulator::detectMotionStart(const JointStateSnapshot &state)
 {
-    this->kukaArm->getArmGripper().close();
+    bool started = false;
+
+    for (int i = 0; i < ARMJOINTS && this->motionStartPending && !started; i++)
+    {
+        started = (abs(state.velocities[i]) > ARRIVAL_VELOCITY_TOLERANCE) ||
+                  (abs(state.angles[i] - this->sensedAngles[i]) > MOTION_START_THRESHOLD);
+    }
+
+    if (started)
+    {
+        LATENCY_RECORD(PROBE_MOTION_START, this->motionCommandTime);
+        this->motionStartPending = false;
+    }
+
+    /* The angles at the start of a motion are kept until the motion started */
+    if (!this->motionStartPending)
+    {
+        this->sensedAngles = state.angles;
+    }
 }
 
-bool Manipulator::setGripper(int distance)
+bool Manipulator::queueCommand(ArmCommand &command)
 {
-    bool spacingSet = true;
-    GripperBarSpacingSetPoint barSpacing;
-    barSpacing.barSpacing = (distance / 1000.) * meter;
+    bool motion = (command.type == ArmCommand::AXIS || command.type == ArmCommand::AXIS_SYNCHRONIZED ||
+                   command.type == ArmCommand::TRAJECTORY_START);
+    command.motion = motion ? this->motionCounter + 1 : 0;
+    command.sequence = this->commandCounter + 1;
+    command.timestamp = chrono::steady_clock::now();
 
-    try
+    bool queued = this->commandQueue.push(command);
+    if (queued && motion)
     {
-        this->kukaArm->getArmGripper().setData(barSpacing);
+        this->motionCounter++;
     }
-    catch (exception e)
+    if (queued)
     {
-        spacingSet = false;
+        this->commandCounter++;
     }
-    return spacingSet;
+    return queued;
 }
 
-bool Manipulator::positionReached()
+void Manipulator::startCycle(int cycleTime)
+{
+    this->cycleTime = cycleTime;
+    this->telemetry.allocate((size_t) (TELEMETRY_HISTORY_SECONDS * 1e6 / cycleTime));
+    this->cycleRunning = true;
+    this->cycleThread = thread(&Manipulator::cycleLoop, this);
+
+    /* Real time priority needs root permissions, otherwise the thread runs with normal priority */
+    sched_param parameter;
+    parameter.sched_priority = CONTROL_THREAD_PRIORITY;
+    pthread_setschedparam(this->cycleThread.native_handle(), SCHED_FIFO, &parameter);
+    this->setControlCore(this->controlCore);
+
+    /* The gripper waits for mailbox replies, so it runs with normal priority */
+    this->gripperThread = thread(&Manipulator::gripperLoop, this);
+}
+
+void Manipulator::stopCycle()
 {
-    bool positionReached = true;
+    this->cycleRunning = false;
 
-    /* Get current axis states and compare to latest desired values (Epsilon of 1°) */
-    vector<JointSensedAngle> data;
-    this->kukaArm->getJointData(data);
+    if (this->cycleThread.joinable())
+    {
+        this->cycleThread.join();
+    }
 
-    for (int i = 0; (i < ARMJOINTS) && positionReached; i++)
+    if (this->gripperThread.joinable())
     {
-        positionReached = abs(quantity_cast<double>(data[i].angle) - this->latestDesiredPosition[i]) < 0.01745;
+        this->gripperWakeup.notify_all();
+        this->gripperThread.join();
     }
-    return positionReached;
+}
+
+void Manipulator::cycleLoop()
+{
+    LatencyProbes::setThreadName("control");
+    CycleStatistics statistics = CycleStatistics();
+    chrono::steady_clock::time_point nextCycle = chrono::steady_clock::now();
+    chrono::microseconds period(this->cycleTime);
+
+    while (this->cycleRunning)
+    {
+        chrono::steady_clock::time_point cycleStart = chrono::steady_clock::now();
+
+        /* Execute all commands of the last cycle, then read the state they caused */
+        ArmCommand command;
+        while (this->commandQueue.pop(command))
+        {
+            this->executeCommand(command);
+        }
+        this->streamSetpoint(cycleStart);
+        this->releaseScheduledGripper();
+
+        /* Callers take the setpoint after a cut trajectory */
+        this->publishSetpoint();
+
+        JointStateSnapshot state;
+        if (this->publishJointState(state))
+        {
+            this->detectArrival(state);
+            this->detectMotionStart(state);
+        }
+        LATENCY_RECORD(PROBE_CONTROL_CYCLE, cycleStart);
+
+        statistics.lastJitter = chrono::duration<double, std::micro>(cycleStart - nextCycle).count();
+        statistics.maxJitter = max(statistics.maxJitter, statistics.lastJitter);
+        statistics.meanJitter += (statistics.lastJitter - statistics.meanJitter) / (statistics.cycles + 1);
+        statistics.maxExecutionTime = max(statistics.maxExecutionTime, elapsedUs(cycleStart));
+        statistics.cycles++;
+
+        /* Skip missed cycles instead of catching up */
+        nextCycle += period;
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        while (nextCycle <= now)
+        {
+            nextCycle += period;
+            statistics.overruns++;
+        }
+        this->cycleTiming.store(statistics);
+        this_thread::sleep_until(nextCycle);
+    }
+}
+
+void Manipulator::executeCommand(const ArmCommand &command)
+{
+    CommandStatistics &statistics = this->commandStatistics;
+    bool commandSent = true;
+    this->executedCommand = command.sequence;
+
+    if (command.type == ArmCommand::GRIPPER_OPEN || command.type == ArmCommand::GRIPPER_CLOSE ||
+        command.type == ArmCommand::GRIPPER_SPACING)
+    {
+        /* A delayed command waits for the end of the trajectory, any newer command replaces it */
+        this->scheduledGripper = command;
+        this->gripperScheduled = (command.leadTime > 0);
+
+        if (!this->gripperScheduled)
+        {
+            this->releaseGripper(command);
+        }
+        return;
+    }
+
+    if (command.type == ArmCommand::TRAJECTORY_START)
+    {
+        this->startTrajectory(command);
+        return;
+    }
+
+    if (command.type == ArmCommand::AXIS_SYNCHRONIZED && this->startSynchronizedMotion(command))
+    {
+        return;
+    }
+
+    /* A new target or a stop ends a running trajectory and releases the buffer */
+    this->streamCount = 0;
+    this->streaming = false;
+
+    if (command.type == ArmCommand::AXIS || command.type == ArmCommand::AXIS_SYNCHRONIZED)
+    {
+        int changedJoints = 0;
+        bool changed[ARMJOINTS];
+        JointVector setpoint;
+
+        /* Only the joints which differ from the latest setpoint are sent, also after a cut trajectory */
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            setpoint[i] = command.changed[i] ? command.angles[i] : this->lastSetpoint[i];
+            changed[i] = command.changed[i] && (setpoint[i] != this->lastSetpoint[i]);
+            changedJoints += changed[i] ? 1 : 0;
+        }
+        this->lastSetpoint = setpoint;
+
+        statistics.lastSkew = 0;
+        if (changedJoints > 0)
+        {
+            this->recorder.recordCommand(this->cycleCount, setpoint, changed);
+            commandSent = this->sendAxisCommandsToManipulator(setpoint, changed);
+        }
+        statistics.skippedJoints += ARMJOINTS - changedJoints;
+
+        this->pendingMotion = command.motion;
+        this->motionTarget = this->lastSetpoint;
+        this->settledCycles = 0;
+        this->motionStartPending = (changedJoints > 0);
+        this->motionCommandTime = command.timestamp;
+    }
+    else if (command.type == ArmCommand::TRAJECTORY_STOP)
+    {
+        /* A stopped trajectory arrives at its current setpoint */
+        this->motionTarget = this->lastSetpoint;
+        this->settledCycles = 0;
+        return;
+    }
+
+    this->countCommand(commandSent, command.timestamp);
+}
+
+void Manipulator::countCommand(bool commandSent, const chrono::steady_clock::time_point &start)
+{
+    CommandStatistics &statistics = this->commandStatistics;
+
+    if (commandSent)
+    {
+        statistics.lastLatency = elapsedUs(start);
+        statistics.maxLatency = max(statistics.maxLatency, statistics.lastLatency);
+        statistics.meanLatency += (statistics.lastLatency - statistics.meanLatency) / (statistics.commands + 1);
+        statistics.maxSkew = max(statistics.maxSkew, statistics.lastSkew);
+        statistics.commands++;
+    }
+    else
+    {
+        statistics.failedCommands++;
+    }
+    this->commandTiming.store(statistics);
+}
+
+void Manipulator::startTrajectory(const ArmCommand &command)
+{
+    const JointVector &first = this->trajectoryBuffer[0];
+    bool valid = true;
+
+    /* The caller couldn't check the start after a cut trajectory (Epsilon of 1°) */
+    for (int i = 0; i < ARMJOINTS && valid; i++)
+    {
+        valid = std::isnan(this->lastSetpoint[i]) || !(abs(first[i] - this->lastSetpoint[i]) > TRAJECTORY_START_TOLERANCE);
+    }
+
+    this->pendingMotion = command.motion;
+    this->settledCycles = 0;
+    this->motionCommandTime = command.timestamp;
+
+    if (!valid)
+    {
+        /* The arm holds its setpoint, so the motion is complete when the arm stands still */
+        this->streamCount = 0;
+        this->streaming = false;
+        this->motionTarget = this->lastSetpoint;
+        this->motionStartPending = false;
+        this->rejectedMotion.store(command.motion, memory_order_release);
+        this->commandStatistics.failedCommands++;
+        this->commandTiming.store(this->commandStatistics);
+        return;
+    }
+
+    this->streamIndex = 0;
+    this->streamCount = command.setpoints;
+    this->streamingProfile = false;
+    this->motionTarget = this->trajectoryBuffer[command.setpoints - 1];
+    this->motionStartPending = true;
+}
+
+bool Manipulator::startSynchronizedMotion(const ArmCommand &command)
+{
+    JointVector poses[2] = {this->lastSetpoint, command.angles};
+    MotionLimits limits;
+    this->motionLimits.load(limits);
+
+    /* Without a setpoint or distance there is nothing to interpolate, the target is set like an axis command */
+    MotionProfile &profile = this->synchronizedProfile;
+    if (poses[0].hasNaN() || !profile.set(poses, 2, limits) || !(profile.duration() > 0))
+    {
+        return false;
+    }
+
+    this->streamIndex = 0;
+    this->streamCount = (int) ceil(profile.duration() / (this->cycleTime * 1e-6)) + 1;
+    this->streamingProfile = true;
+    this->pendingMotion = command.motion;
+    this->motionTarget = command.angles;
+    this->settledCycles = 0;
+    this->motionStartPending = true;
+    this->motionCommandTime = command.timestamp;
+    return true;
+}
+
+void Manipulator::publishSetpoint()
+{
+    SetpointSnapshot setpoint;
+    setpoint.angles = this->lastSetpoint;
+    setpoint.target = this->motionTarget;
+    setpoint.command = this->executedCommand;
+    this->setpointState.store(setpoint);
+}
+
+void Manipulator::streamSetpoint(const chrono::steady_clock::time_point &cycleStart)
+{
+    if (this->streamIndex >= this->streamCount)
+    {
+        return;
+    }
+
+    /* A synchronized motion is sampled in the cycle, its last setpoint is exactly the target */
+    JointVector setpoint;
+    if (!this->streamingProfile)
+    {
+        setpoint = this->trajectoryBuffer[this->streamIndex];
+    }
+    else if (this->streamIndex + 1 < this->streamCount)
+    {
+        this->synchronizedProfile.sample(this->streamIndex * this->cycleTime * 1e-6, setpoint);
+    }
+    else
+    {
+        setpoint = this->motionTarget;
+    }
+
+    /* The first setpoint is due since the command, the others since the start of their cycle */
+    chrono::steady_clock::time_point due = (this->streamIndex == 0) ? this->motionCommandTime : cycleStart;
+    this->streamIndex++;
+
+    /* Only the joints which move are written */
+    bool changed[ARMJOINTS];
+    int changedJoints = 0;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        changed[i] = (setpoint[i] != this->lastSetpoint[i]);
+        changedJoints += changed[i] ? 1 : 0;
+    }
+    this->commandStatistics.skippedJoints += ARMJOINTS - changedJoints;
+
+    if (changedJoints > 0)
+    {
+        this->recorder.recordCommand(this->cycleCount, setpoint, changed);
+        this->countCommand(this->sendAxisCommandsToManipulator(setpoint, changed), due);
+    }
+    this->lastSetpoint = setpoint;
+
+    if (this->streamIndex == this->streamCount)
+    {
+        this->streamCount = 0;
+        this->streaming = false;
+    }
+}
+
+void Manipulator::releaseScheduledGripper()
+{
+    if (!this->gripperScheduled)
+    {
+        return;
+    }
+
+    double remainingTime = (this->streamCount - this->streamIndex) * this->cycleTime * 1e-6;
+
+    if (this->streamIndex >= this->streamCount || remainingTime <= this->scheduledGripper.leadTime)
+    {
+        this->releaseGripper(this->scheduledGripper);
+        this->gripperScheduled = false;
+    }
+}
+
+void Manipulator::releaseGripper(const ArmCommand &command)
+{
+    this->gripperRequest.store(command);
+    this->requestedGripper.store(command.gripper, memory_order_release);
+
+    /* No lock, a missed wake up only delays the gripper thread by its poll interval */
+    this->gripperWakeup.notify_one();
+}
+
+void Manipulator::gripperLoop()
+{
+    /* The spacing is unknown at the start, so the first command takes the full travel time */
+    double spacing = numeric_limits<double>::quiet_NaN();
+    unsigned long handled = this->requestedGripper.load(memory_order_acquire);
+
+    while (this->cycleRunning)
+    {
+        unique_lock<mutex> lock(this->gripperMutex);
+        auto newRequest = [this, &handled] { return this->requestedGripper.load(memory_order_acquire) != handled ||
+                                                    !this->cycleRunning; };
+
+        if (!this->gripperWakeup.wait_for(lock, chrono::milliseconds(2), newRequest) || !this->cycleRunning)
+        {
+            continue;
+        }
+        lock.unlock();
+
+        /* The slot holds the latest command, older commands which weren't sent are replaced */
+        ArmCommand command;
+        this->gripperRequest.load(command);
+        handled = command.gripper;
+        this->sendGripperCommandToManipulator(command);
+
+        double target = (command.type == ArmCommand::GRIPPER_OPEN) ? GRIPPER_LIMIT[1] :
+                        (command.type == ArmCommand::GRIPPER_CLOSE) ? GRIPPER_LIMIT[0] : command.spacing;
+        double distance = std::isnan(spacing) ? GRIPPER_LIMIT[1] - GRIPPER_LIMIT[0] : abs(target - spacing);
+        chrono::duration<double> travelTime(distance / GRIPPER_VELOCITY);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        /* The gripper has no position feedback, the command is complete after the travel time */
+        lock.lock();
+        bool replaced = this->gripperWakeup.wait_for(lock, travelTime, newRequest);
+        lock.unlock();
+
+        if (replaced)
+        {
+            /* The bars stop somewhere on the way, the next command starts there */
+            double part = min(1., chrono::duration<double>(chrono::steady_clock::now() - start) / travelTime);
+            spacing = std::isnan(spacing) ? numeric_limits<double>::quiet_NaN() : spacing + part * (target - spacing);
+        }
+        else
+        {
+            spacing = target;
+            this->completeGripper(handled);
+        }
+    }
+}
+
+void Manipulator::completeGripper(unsigned long gripper)
+{
+    lock_guard<mutex> lock(this->gripperMutex);
+    this->completedGripper.store(gripper, memory_order_release);
+    this->gripperCompletion.notify_all();
+
+    if (this->gripperCallback)
+    {
+        this->gripperCallback(gripper);
+    }
+}
+
+bool Manipulator::sendAxisCommandsToManipulator(const JointVector &targetAngles, const bool changed[ARMJOINTS])
+{
+    LATENCY_SCOPE(PROBE_SEND_AXIS_COMMAND);
+    bool commandSent = true;
+    vector<JointAngleSetpoint> &setpoints = this->setpointData;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        setpoints[i].angle = targetAngles[i] * radian;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    try
+    {
+        /* The backend releases all changed joints to the same cycle */
+        this->backend->setJointData(setpoints, changed);
+        this->commandStatistics.lastSkew = elapsedUs(start);
+    }
+    catch (std::exception &e)
+    {
+        commandSent = false;
+    }
+    return commandSent;
+}
+
+bool Manipulator::sendGripperCommandToManipulator(const ArmCommand &command)
+{
+    bool commandSent = true;
+
+    try
+    {
+        if (command.type == ArmCommand::GRIPPER_OPEN)
+        {
+            this->backend->openGripper();
+        }
+        else if (command.type == ArmCommand::GRIPPER_CLOSE)
+        {
+            this->backend->closeGripper();
+        }
+        else
+        {
+            GripperBarSpacingSetPoint barSpacing;
+            barSpacing.barSpacing = command.spacing * meter;
+            this->backend->setGripperData(barSpacing);
+        }
+    }
+    catch (std::exception &e)
+    {
+        commandSent = false;
+    }
+    return commandSent;
+}
+
+unsigned long Manipulator::lastMotion()
+{
+    return this->motionCounter;
+}
+
+bool Manipulator::motionComplete(unsigned long motion)
+{
+    return this->completedMotion.load(memory_order_acquire) >= motion;
+}
+
+bool Manipulator::motionRejected(unsigned long motion)
+{
+    return motion != 0 && this->rejectedMotion.load(memory_order_acquire) == motion;
+}
+
+bool Manipulator::waitForMotion(unsigned long motion, double timeout)
+{
+    unique_lock<mutex> lock(this->arrivalMutex);
+
+    return this->arrivalCondition.wait_for(lock, chrono::duration<double>(timeout),
+                                           [this, motion] { return this->motionComplete(motion); });
+}
+
+void Manipulator::setMotionCallback(const MotionCallback &callback)
+{
+    lock_guard<mutex> lock(this->arrivalMutex);
+    this->motionCallback = callback;
+}
+
+void Manipulator::setArrivalCriteria(const ArrivalCriteria &criteria)
+{
+    this->arrivalCriteria.store(criteria);
+}
+
+void Manipulator::getCommandStatistics(CommandStatistics &statistics)
+{
+    this->commandTiming.load(statistics);
+}
+
+void Manipulator::getCycleStatistics(CycleStatistics &statistics)
+{
+    this->cycleTiming.load(statistics);
+}
+
+bool Manipulator::prePlanMotion(VectorXd &tcp, VectorXd &angles)
+{
+    JointVector solution;
+    bool success = (tcp.size() == 6) && this->solveInverseKinematics(PoseVector(tcp), solution);
+
+    if (success)
+    {
+        angles = solution;
+    }
+    return success;
+}
+
+bool Manipulator::prePlanMotion(const PoseVector &tcp, JointVector &angles)
+{
+    return this->solveInverseKinematics(tcp, angles);
+}
+
+int Manipulator::prePlanMotion(const PoseVector *tcps, int count, JointVector *angles, bool *success, double *travelTime)
+{
+    JointVector start;
+    this->getLatestDesiredAxis(start);
+
+    return this->solver->inverseTransformationSequence(tcps, count, start, angles, success, travelTime);
+}
+
+double Manipulator::predictCycleTime(const JointVector *poses, int count, double *segmentTimes)
+{
+    MotionProfile profile;
+    if (!profile.set(poses, count, this->jointLimits))
+    {
+        return 0;
+    }
+
+    for (int s = 0; s < profile.segments() && segmentTimes != NULL; s++)
+    {
+        segmentTimes[s] = profile.segmentDuration(s);
+    }
+    return profile.duration();
+}
+
+bool Manipulator::readJointLimits(const string &name, const string &path, MotionLimits &limits)
+{
+    try
+    {
+        ConfigFile configFile(name + ".cfg", path);
+
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            stringstream section;
+            section << "Joint_" << (i + 1);
+
+            if (configFile.keyExists(section.str(), "MaxVelocity_[radian_per_second]"))
+            {
+                configFile.readInto(limits.velocity[i], section.str(), "MaxVelocity_[radian_per_second]");
+            }
+            if (configFile.keyExists(section.str(), "MaxAcceleration_[radian_per_second_squared]"))
+            {
+                configFile.readInto(limits.acceleration[i], section.str(), "MaxAcceleration_[radian_per_second_squared]");
+            }
+            if (configFile.keyExists(section.str(), "MaxJerk_[radian_per_second_cubed]"))
+            {
+                configFile.readInto(limits.jerk[i], section.str(), "MaxJerk_[radian_per_second_cubed]");
+            }
+        }
+    }
+    catch (std::exception &e)
+    {
+        limits = MotionLimits();
+        return false;
+    }
+    return true;
+}
+
+void Manipulator::setJointLimits(const MotionLimits &limits)
+{
+    this->jointLimits = limits;
+    this->motionLimits.store(limits);
+    this->solver->setJointVelocities(limits.velocity);
+}
+
+const MotionLimits &Manipulator::getJointLimits()
+{
+    return this->jointLimits;
+}
+
+bool Manipulator::loadReachabilityMap(const string &fileName)
+{
+    return this->reachability.open(fileName, *this->solver);
+}
+
+KinematicsSolver *Manipulator::getKinematicsSolver()
+{
+    return this->solver;
+}
+
+void Manipulator::startResync()
+{
+    this->desiredResync = true;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        this->resyncJoints[i] = false;
+    }
+}
+
+void Manipulator::getLatestDesiredAxis(JointVector &angles)
+{
+    JointVector desired = this->latestDesiredPosition;
+
+    if (this->desiredResync)
+    {
+        SetpointSnapshot setpoint;
+        this->setpointState.load(setpoint);
+
+        if (setpoint.command >= this->commandCounter)
+        {
+            /* All commands are executed, so the target of the control thread is the desired position */
+            this->latestDesiredPosition = setpoint.target;
+            this->desiredResync = false;
+            desired = setpoint.target;
+        }
+        else
+        {
+            /* Until then the arm is near the latest setpoint, except for the joints which were set again */
+            for (int i = 0; i < ARMJOINTS; i++)
+            {
+                desired[i] = this->resyncJoints[i] ? this->latestDesiredPosition[i] : setpoint.angles[i];
+            }
+        }
+    }
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        /* Convert kuka angle to angle (0 is centered) */
+        angles[i] = desired[i] + KUKA_ANGLE_OFFSET[i];
+    }
+}
+
+void Manipulator::setInitialSetpoint(const JointVector &setpoint)
+{
+    this->latestDesiredPosition = setpoint;
+    this->lastSetpoint = setpoint;
+    this->motionTarget = setpoint;
+    this->publishSetpoint();
+}
+
+bool Manipulator::solveInverseKinematics(const PoseVector &tcp, JointVector &angles)
+{
+    /* Reject impossible targets in O(1), otherwise take the branch with the shortest way */
+    JointVector current;
+    JointVector solution;
+    this->getLatestDesiredAxis(current);
+
+    bool success = (!this->reachability.matches(*this->solver) || this->reachability.isReachable(tcp)) &&
+                   this->solver->inverseTransformationMinTravel(tcp, current, solution);
+
+    if (success)
+    {
+        angles = solution;
+    }
+    return success;
+}
+
+unsigned long Manipulator::openGripper()
+{
+    ArmCommand command;
+    command.type = ArmCommand::GRIPPER_OPEN;
+
+    return this->queueGripperCommand(command);
+}
+
+unsigned long Manipulator::closeGripper()
+{
+    ArmCommand command;
+    command.type = ArmCommand::GRIPPER_CLOSE;
+
+    return this->queueGripperCommand(command);
+}
+
+unsigned long Manipulator::setGripper(int distance)
+{
+    return this->setGripperBeforeArrival(distance, 0);
+}
+
+unsigned long Manipulator::setGripperBeforeArrival(int distance, double leadTime)
+{
+    ArmCommand command;
+    command.type = ArmCommand::GRIPPER_SPACING;
+    command.spacing = min(max(distance / 1000., GRIPPER_LIMIT[0]), GRIPPER_LIMIT[1]);
+    command.leadTime = leadTime;
+
+    return this->queueGripperCommand(command);
+}
+
+unsigned long Manipulator::queueGripperCommand(ArmCommand &command)
+{
+    command.gripper = this->gripperCounter + 1;
+
+    if (!this->queueCommand(command))
+    {
+        return 0;
+    }
+    return ++this->gripperCounter;
+}
+
+unsigned long Manipulator::lastGripper()
+{
+    return this->gripperCounter;
+}
+
+bool Manipulator::gripperComplete(unsigned long gripper)
+{
+    return this->completedGripper.load(memory_order_acquire) >= gripper;
+}
+
+bool Manipulator::waitForGripper(unsigned long gripper, double timeout)
+{
+    unique_lock<mutex> lock(this->gripperMutex);
+
+    return this->gripperCompletion.wait_for(lock, chrono::duration<double>(timeout),
+                                            [this, gripper] { return this->gripperComplete(gripper); });
+}
+
+void Manipulator::setGripperCallback(const MotionCallback &callback)
+{
+    lock_guard<mutex> lock(this->gripperMutex);
+    this->gripperCallback = callback;
+}
+
+bool Manipulator::positionReached()
+{
+    /* The control thread checks the arrival, so no communication is needed */
+    return this->motionComplete(this->motionCounter);
 }
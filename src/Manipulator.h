@@ -23,13 +23,31 @@
 #ifndef MANIPULATOR_H
 #define MANIPULATOR_H
 
-#include <youbot/YouBotManipulator.hpp>
 #include <eigen3/Eigen/Dense>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "ArmBackend.h"
+#include "SplineTrajectory.h"
+#include "MotionProfile.h"
 #include "KinematicsSolver.h"
+#include "CalibrationStore.h"
+#include "LatencyProbes.h"
+#include "ReachabilityMap.h"
+#include "RingBuffer.h"
+#include "SeqLock.h"
+#include "SpscQueue.h"
+#include "TelemetryRecorder.h"
 
 using namespace youbot;
 using namespace Eigen;
 
+/** Axis values of all joints in degree */
+typedef Matrix<int, ARMJOINTS, 1> JointVectorDeg;
+
 /**
  * Enumerator definition for stored positions
  */
@@ -39,6 +57,229 @@ typedef enum
     CANDLE_POSITION
 } STORED_POSES;
 
+/**
+ * State of the arm which was read in one EtherCAT cycle.
+ */
+struct JointStateSnapshot
+{
+    /** Axis values in radian (0 is centered) */
+    JointVector angles;
+
+    /** Axis velocities in radian per second */
+    JointVector velocities;
+
+    /** Motor currents in ampere */
+    JointVector currents;
+
+    /** Motor torques in newton meter */
+    JointVector torques;
+
+    /** Pose of the TCP (X, Y, Z, Roll, Pitch, Yaw) */
+    PoseVector tcp;
+
+    /** true if the pose of the TCP could be calculated */
+    bool tcpValid;
+
+    /** Number of the cycle which read the state */
+    uint64_t cycle;
+
+    /** Time the state was read */
+    chrono::steady_clock::time_point timestamp;
+};
+
+/**
+ * Latest setpoint and target of the control thread.
+ */
+struct SetpointSnapshot
+{
+    /** Kuka angles of the latest setpoint in radian (NaN before the first command) */
+    JointVector angles;
+
+    /** Kuka angles the latest motion ends at in radian */
+    JointVector target;
+
+    /** Number of the latest command which was executed */
+    unsigned long command;
+};
+
+/**
+ * Timing of the axis commands, all times in microseconds.
+ */
+struct CommandStatistics
+{
+    /** Number of axis commands which were sent, each setpoint of a trajectory or synchronized motion counts */
+    unsigned long commands;
+
+    /** Number of joints which were skipped because their setpoint didn't change */
+    unsigned long skippedJoints;
+
+    /** Number of commands which were rejected by the driver */
+    unsigned long failedCommands;
+
+    /**
+     * Time from the call until the setpoints were handed over to the driver,
+     * for the following setpoints of a motion from the start of their cycle
+     */
+    double lastLatency;
+    double maxLatency;
+    double meanLatency;
+
+    /**
+     * Upper bound of the time between the first and the last joint setpoint
+     * reaching the EtherCAT buffers (duration of the backend call)
+     */
+    double lastSkew;
+    double maxSkew;
+};
+
+/**
+ * Timing of the control thread, all times in microseconds.
+ */
+struct CycleStatistics
+{
+    /** Number of cycles so far */
+    unsigned long cycles;
+
+    /** Number of cycles which were skipped because a cycle took too long */
+    unsigned long overruns;
+
+    /** Delay of the cycle start against its schedule */
+    double lastJitter;
+    double maxJitter;
+    double meanJitter;
+
+    /** Time needed for the commands and the state of one cycle */
+    double maxExecutionTime;
+};
+
+/**
+ * Time needed by the start of the arm, all times in seconds.
+ */
+struct StartupTiming
+{
+    /** Flag if the stored calibration was valid, so the arm was neither calibrated nor driven home */
+    bool warmStart;
+
+    /** Connection to the arm (EtherCAT and the joints of the driver) */
+    double driver;
+
+    /** Commutation of the joints, the driver skips it while the controllers are powered */
+    double commutation;
+
+    /** Comparison of the stored calibration with the encoders */
+    double verification;
+
+    /** Calibration of the joints and their limits */
+    double calibration;
+
+    /** Configuration and the start of the control thread */
+    double configuration;
+
+    /** Time from the start until the arm accepts commands */
+    double total;
+
+    /**
+     * Constructor:
+     * Creates an empty timing.
+     */
+    StartupTiming() : warmStart(false), driver(0), commutation(0), verification(0), calibration(0),
+        configuration(0), total(0)
+    {
+    }
+};
+
+/**
+ * Conditions under which the control thread considers a motion complete.
+ */
+struct ArrivalCriteria
+{
+    /** Maximum distance of each joint to its target in radian */
+    JointVector positionTolerance;
+
+    /** Maximum velocity of each joint in radian per second */
+    JointVector velocityTolerance;
+
+    /** Time all joints have to stay within the tolerances in seconds */
+    double settleTime;
+
+    /**
+     * Constructor:
+     * Creates the default criteria (see ybparams.h).
+     */
+    ArrivalCriteria() : settleTime(ARRIVAL_SETTLE_TIME)
+    {
+        this->positionTolerance.setConstant(ARRIVAL_POSITION_TOLERANCE);
+        this->velocityTolerance.setConstant(ARRIVAL_VELOCITY_TOLERANCE);
+    }
+};
+
+/**
+ * Function which is called by the control thread when a motion is complete
+ * or by the gripper thread when a gripper command is complete. The parameter
+ * is the number of the motion or gripper command (see Manipulator::lastMotion
+ * and Manipulator::lastGripper).
+ */
+typedef function<void(unsigned long)> MotionCallback;
+
+/**
+ * Command which is passed to the control thread.
+ */
+struct ArmCommand
+{
+    /** Kind of the command */
+    enum
+    {
+        AXIS,
+        GRIPPER_OPEN,
+        GRIPPER_CLOSE,
+        GRIPPER_SPACING,
+        TRAJECTORY_START,
+        TRAJECTORY_STOP,
+        AXIS_SYNCHRONIZED
+    } type;
+
+    /** Kuka angles of all joints in radian (AXIS and AXIS_SYNCHRONIZED) */
+    JointVector angles;
+
+    /** Flag for each joint if the command sets it, the other joints keep their setpoint (AXIS) */
+    bool changed[ARMJOINTS];
+
+    /** Spacing of the gripper in meter (GRIPPER_SPACING) */
+    double spacing;
+
+    /** Number of the gripper command (GRIPPER_*) */
+    unsigned long gripper;
+
+    /** Time before the end of the running trajectory the gripper starts in seconds (GRIPPER_*, 0 is at once) */
+    double leadTime;
+
+    /** Number of buffered setpoints (TRAJECTORY_START) */
+    int setpoints;
+
+    /** Number of the motion (AXIS, AXIS_SYNCHRONIZED and TRAJECTORY_START) */
+    unsigned long motion;
+
+    /** Number of the command, counts all kinds */
+    unsigned long sequence;
+
+    /** Time the command was given */
+    chrono::steady_clock::time_point timestamp;
+
+    /**
+     * Constructor:
+     * Creates an axis command which doesn't change any joint.
+     */
+    ArmCommand() : type(AXIS), spacing(0), gripper(0), leadTime(0), setpoints(0), motion(0), sequence(0)
+    {
+        this->angles.setZero();
+
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            this->changed[i] = false;
+        }
+    }
+};
+
 /**
  * An object of this class wraps the youBot API to a simple interface
  * for controlling the manipulator only. Axis values can be receivend and
@@ -47,6 +288,43 @@ typedef enum
  * Also carthesian coordinates can be set directly by using an
  * external kinematics solver.
  *
+ * All communication with the arm is done by a control thread, which runs
+ * with the EtherCAT update rate. Commands are passed to this thread through
+ * a lock free queue, so all set functions return immediately and a blocked
+ * GUI doesn't stall the arm. Commands must be given by one thread only.
+ * The state of the arm is read once per cycle and stored in a
+ * JointStateSnapshot. All sensed values are taken from this snapshot
+ * without locking and without communication.
+ *
+ * Every axis command and trajectory is a numbered motion. The control thread
+ * checks the arrival of the latest motion in every cycle and reports it
+ * through a callback, waitForMotion() and motionComplete(), so no one has to
+ * poll the arm.
+ *
+ * The gripper is driven by its own thread, because each gripper command
+ * waits for the mailbox replies of the controller. Gripper commands are
+ * numbered like motions and return immediately. The gripper thread always
+ * sends the latest command, so fast updates (e.g. a slider) replace the
+ * commands which weren't sent yet. A gripper command can also be delayed
+ * until the running trajectory is close to its end, so the gripper closes
+ * during the final approach.
+ *
+ * The overloads with fixed size vectors (JointVector, JointVectorDeg and
+ * PoseVector) never allocate memory, neither does the control thread. The
+ * overloads with VectorXd and VectorXi are kept for existing callers.
+ *
+ * All sent setpoints and sensed states can be recorded into a binary log
+ * (see TelemetryRecorder), which the OfflineManipulator replays.
+ *
+ * The control thread keeps the sensed angles of a calibrated arm in a state
+ * file (see CalibrationStore). If the encoders still match this file at the
+ * next start, e.g. after a crash or a new deployment, the calibration and
+ * the drive to the home position are skipped and the arm holds its pose.
+ *
+ * The joints and the gripper are driven through an ArmBackend. The name
+ * constructor uses the youBot driver, a StandInBackend runs the same code
+ * without an arm, e.g. for benchmarks of the whole command path.
+ *
  * @author Stefan Wilkes
  */
 class Manipulator
@@ -56,12 +334,36 @@ public:
 
     /**
      * Constructor:
-     * Creates a new manipulator.
+     * Creates a new manipulator. Without a valid calibration state the arm
+     * is calibrated and driven to the home position.
      *
      * @param name The name of the config file to load and pass to youBot api (without ".cfg")
      * @param path The path to the config file
+     * @param calibrationFile The calibration state file (empty for none)
+     * @param forceCalibration Flag if the arm is calibrated in any case
+     */
+    Manipulator(const string &name, const string &path, const string &calibrationFile = "",
+                bool forceCalibration = false);
+
+    /**
+     * Constructor:
+     * Creates a new manipulator on another arm backend, e.g. a
+     * StandInBackend for benchmarks without an arm.
+     *
+     * @param backend The arm, which is deleted by the manipulator
+     * @param name The name of the config file with the joint limits (without ".cfg")
+     * @param path The path to the config files
+     * @param calibrationFile The calibration state file (empty for none)
+     * @param forceCalibration Flag if the arm is calibrated in any case
+     */
+    Manipulator(ArmBackend *backend, const string &name, const string &path, const string &calibrationFile = "",
+                bool forceCalibration = false);
+
+    /**
+     * Destructor:
+     * Stops reading the arm state and deletes the backend and the kinematics solver.
      */
-    Manipulator(const string &name, const string &path);
+    virtual ~Manipulator();
 
     /**
      * Sets a stored pose to the robot.
@@ -75,7 +377,8 @@ public:
      * Sets a given pose to the robot.
      * The coordinates defines the position of the tcp in world
      * system. An external kinematics solver is used to calculate
-     * the angles for a given pose.
+     * the angles for a given pose. Of all possible configurations
+     * the one with the shortest travel time is selected.
      *
      * @param tcp The TCP Vector for the desired world position
      *            (X, Y, Z, Roll, Pitch, Yaw)
@@ -83,16 +386,115 @@ public:
      */
     bool setPose(VectorXd &tcp);
 
+    /**
+     * Sets a given pose to the robot (see above) without allocating memory.
+     *
+     * @param tcp The TCP Vector for the desired world position
+     *            (X, Y, Z, Roll, Pitch, Yaw)
+     * @return true if pose set successfully
+     */
+    bool setPose(const PoseVector &tcp);
+
+    /**
+     * Sets a pose close to the current one, e.g. small corrections of a
+     * visual servoing loop or TCP nudges. The iterative kinematics solver
+     * starts at the sensed axis values or at the previous command, so the
+     * cost per call is small and bounded.
+     *
+     * @param tcp The TCP Vector for the desired world position
+     *            (X, Y, Z, Roll, Pitch, Yaw)
+     * @param warmStartFromSensed true to start at the sensed axis values,
+     *                            false to start at the latest desired position
+     * @param result Optional pointer which receives the iterations and remaining errors
+     * @return true if pose set successfully
+     */
+    bool setPoseIncremental(VectorXd &tcp, bool warmStartFromSensed = true, IterativeIKResult *result = NULL);
+
+    /**
+     * Sets a pose close to the current one (see above) without allocating memory.
+     *
+     * @param tcp The TCP Vector for the desired world position
+     *            (X, Y, Z, Roll, Pitch, Yaw)
+     * @param warmStartFromSensed true to start at the sensed axis values,
+     *                            false to start at the latest desired position
+     * @param result Optional pointer which receives the iterations and remaining errors
+     * @return true if pose set successfully
+     */
+    bool setPoseIncremental(const PoseVector &tcp, bool warmStartFromSensed = true, IterativeIKResult *result = NULL);
+
     /**
      * Sets the given target angles (radian) to the robot.
      * The vector must have defined all 5 axis values.
      * To set a single axis use overloaded function.
      *
+     * All angles are checked first, so an invalid angle rejects the whole
+     * command. The changed setpoints are written within one EtherCAT cycle,
+     * unchanged joints are skipped.
+     *
      * @param targetAnglesRad Vector of 5 axis angles
-     * @return true if angles set successfully
+     * @return true if the angles were valid and the command was queued
      */
     bool setAxis(VectorXd &targetAnglesRad);
 
+    /**
+     * Sets the given target angles (radian) to the robot (see above)
+     * without allocating memory.
+     *
+     * @param targetAnglesRad The 5 axis angles
+     * @return true if the angles were valid and the command was queued
+     */
+    bool setAxis(const JointVector &targetAnglesRad);
+
+    /**
+     * Streams a joint space trajectory to the robot. The trajectory is
+     * sampled with the cycle time into a preallocated buffer and the control
+     * thread sends one setpoint per cycle. The trajectory must start at the
+     * latest desired position. Any other axis command stops the trajectory.
+     *
+     * After a cut trajectory the caller doesn't know where the arm stopped,
+     * so the control thread checks the start and rejects a trajectory which
+     * doesn't start at its latest setpoint (see motionRejected()).
+     *
+     * @param trajectory The trajectory (at most MAX_TRAJECTORY_SETPOINTS cycles long)
+     * @return true if all setpoints are valid and the trajectory was queued
+     */
+    bool streamTrajectory(const Trajectory &trajectory);
+
+    /**
+     * Stops a running trajectory at its current setpoint. The next desired
+     * position is taken from the control thread as soon as it executed the
+     * stop.
+     */
+    void stopTrajectory();
+
+    /**
+     * Checks if a trajectory is streamed.
+     *
+     * @return true until the last setpoint of the trajectory was sent
+     */
+    bool trajectoryActive();
+
+    /**
+     * Moves the robot to the given target angles (radian) in minimum time.
+     * All joints start and arrive together without exceeding the joint
+     * limits (see MotionProfile). The motion is streamed like a trajectory.
+     *
+     * @param targetAnglesRad Vector of 5 axis angles
+     * @return true if the angles were valid and the motion was started
+     */
+    bool setAxisSynchronized(VectorXd &targetAnglesRad);
+
+    /**
+     * Moves the robot to the given target angles (radian) in minimum time
+     * (see above). The control thread plans the motion from its latest
+     * setpoint, so the motion also starts where a cut trajectory stopped.
+     * No memory is allocated.
+     *
+     * @param targetAnglesRad The 5 axis angles
+     * @return true if the angles were valid and the motion was started
+     */
+    bool setAxisSynchronized(const JointVector &targetAnglesRad);
+
     /**
      * Sets the given target angles (degree) to the robot.
      * The vector must have defined all 5 axis values.
@@ -103,6 +505,14 @@ public:
      */
     bool setAxis(VectorXi &targetAnglesDeg);
 
+    /**
+     * Sets the given target angles (degree) to the robot without allocating memory.
+     *
+     * @param targetAnglesDeg The 5 axis angles
+     * @return true if angles set successfully
+     */
+    bool setAxis(const JointVectorDeg &targetAnglesDeg);
+
     /**
      * Sets a single target angle (radian) to the robot.
      *
@@ -121,6 +531,143 @@ public:
      */
     bool setAxis(int jointIndex, int targetAngleDeg);
 
+    /**
+     * Returns the number of the latest queued motion. Each axis command and
+     * each trajectory is one motion, a new motion replaces the previous one.
+     *
+     * @return the number of the motion (0 if no motion was queued)
+     */
+    unsigned long lastMotion();
+
+    /**
+     * Checks if a motion is complete. A motion is complete when all joints
+     * stayed within the arrival tolerances, or when a later motion is complete.
+     *
+     * @param motion Number of the motion
+     * @return true if the motion is complete
+     */
+    bool motionComplete(unsigned long motion);
+
+    /**
+     * Checks if the control thread rejected a trajectory because it didn't
+     * start at the latest setpoint. The arm then holds its setpoint and the
+     * motion is complete when the arm stands still.
+     *
+     * @param motion Number of the motion
+     * @return true if the motion was rejected
+     */
+    bool motionRejected(unsigned long motion);
+
+    /**
+     * Waits until a motion is complete.
+     *
+     * @param motion Number of the motion
+     * @param timeout Maximum time to wait in seconds
+     * @return true if the motion is complete, false on timeout
+     */
+    bool waitForMotion(unsigned long motion, double timeout);
+
+    /**
+     * Sets a function which is called by the control thread when a motion
+     * is complete. The function must return quickly, e.g. emit a queued Qt
+     * signal, and must not give commands to the manipulator.
+     *
+     * @param callback The function (an empty function removes the callback)
+     */
+    void setMotionCallback(const MotionCallback &callback);
+
+    /**
+     * Sets the conditions under which a motion is complete.
+     *
+     * @param criteria The tolerances and the settle time
+     */
+    void setArrivalCriteria(const ArrivalCriteria &criteria);
+
+    /**
+     * Returns the latency and skew of the axis commands.
+     *
+     * @param statistics Receives the timing
+     */
+    void getCommandStatistics(CommandStatistics &statistics);
+
+    /**
+     * Returns the jitter of the control thread.
+     *
+     * @param statistics Receives the timing
+     */
+    void getCycleStatistics(CycleStatistics &statistics);
+
+    /**
+     * Binds the control thread to a processor core, so the control threads
+     * of several arms don't disturb each other.
+     *
+     * @param core Number of the core (-1 for all cores)
+     * @return true if the thread was bound
+     */
+    bool setControlCore(int core);
+
+    /**
+     * Returns the time the start of the arm needed.
+     *
+     * @param timing Receives the timing (all 0 without arm)
+     */
+    void getStartupTiming(StartupTiming &timing);
+
+    /**
+     * Returns the latest sensed state of the arm: angles, velocities,
+     * currents and torques of all joints and the pose of the TCP. All values
+     * were read in the same cycle.
+     *
+     * @param state Receives the state
+     */
+    void getSensedState(JointStateSnapshot &state);
+
+    /**
+     * Returns the states of the latest cycles (at most TELEMETRY_HISTORY_SECONDS).
+     * The history is kept by the control thread without allocations, so
+     * monitoring tools can read it at any rate without accessing the arm.
+     *
+     * @param states Array which receives the states, the oldest first
+     * @param maximum Maximum number of states to copy
+     * @return the number of copied states
+     */
+    int getSensedHistory(JointStateSnapshot *states, int maximum);
+
+    /**
+     * Returns the number of states the history can keep.
+     *
+     * @return the capacity of the history
+     */
+    int getSensedHistoryCapacity();
+
+    /**
+     * Starts recording every axis command and sensed state of the control
+     * thread into a binary log file.
+     *
+     * @param fileName The file to write (an existing file is replaced)
+     * @return true if the file was created, false if it failed or a recording runs
+     */
+    bool startRecording(const string &fileName);
+
+    /**
+     * Stops the recording and closes the log file.
+     */
+    void stopRecording();
+
+    /**
+     * Returns the counters of the current or last recording.
+     *
+     * @param statistics Receives the counters
+     */
+    void getRecorderStatistics(RecorderStatistics &statistics);
+
+    /**
+     * Returns the age of the latest state of the arm.
+     *
+     * @return the time since the state was read in seconds
+     */
+    double getJointStateAge();
+
     /**
      * Reads out the actual axis positions of the robot in degree.
      *
@@ -135,6 +682,22 @@ public:
      */
     virtual void getSensedAxis(VectorXd &axisAnglesRad);
 
+    /**
+     * Reads out the actual axis positions of the robot in degree without
+     * allocating memory.
+     *
+     * @param axisAnglesDeg Vector which receives the readed values
+     */
+    void getSensedAxis(JointVectorDeg &axisAnglesDeg);
+
+    /**
+     * Reads out the actual axis positions of the robot in radian without
+     * allocating memory.
+     *
+     * @param axisAnglesRad Vector which receives the readed values
+     */
+    void getSensedAxis(JointVector &axisAnglesRad);
+
     /**
      * Reads out the actual pose of the TCP calculated by an external
      * kinematics solver.
@@ -144,6 +707,14 @@ public:
      */
     bool getSensedPosition(VectorXd &tcp);
 
+    /**
+     * Reads out the actual pose of the TCP without allocating memory.
+     *
+     * @param tcp Vector for storing the calculated pose
+     * @return true if the position was calculated successfully
+     */
+    bool getSensedPosition(PoseVector &tcp);
+
     /**
      * Pre plans the motion for a given TCP.
      *
@@ -160,27 +731,160 @@ public:
      */
     bool prePlanMotion(VectorXd &tcp, VectorXd &angles);
 
+    /**
+     * Pre plans the motion for a given TCP (see above) without allocating memory.
+     *
+     * @param tcp The TCP Vector for the desired world position
+     *            (X, Y, Z, Roll, Pitch, Yaw)
+     * @param angles The calculated angles which would be sent to the robot.
+     * @return true if pose set successfully
+     */
+    bool prePlanMotion(const PoseVector &tcp, JointVector &angles);
+
+    /**
+     * Pre plans the motion for a list of TCPs, e.g. a whole pose program.
+     * The kinematics are solved in parallel on all cores. Starting at the
+     * latest desired position, the configurations with the shortest total
+     * travel time are selected for the poses in the given order.
+     *
+     * No command is send to the robot.
+     *
+     * @param tcps Contiguous array of desired poses (X, Y, Z, Roll, Pitch, Yaw)
+     * @param count Number of poses
+     * @param angles Array for the calculated angles (count elements)
+     * @param success Array for the result flag of each pose (count elements)
+     * @param travelTime Optional pointer which receives the estimated travel time in seconds
+     * @return the number of poses which could be solved
+     */
+    int prePlanMotion(const PoseVector *tcps, int count, JointVector *angles, bool *success, double *travelTime = NULL);
+
+    /**
+     * Predicts the time of a pose program, which stops at every pose and
+     * moves with synchronized minimum time motions between the poses.
+     *
+     * No command is send to the robot.
+     *
+     * @param poses Axis values of the poses in radian (0 is centered)
+     * @param count Number of poses
+     * @param segmentTimes Optional array which receives the time of each motion (count - 1 elements)
+     * @return the predicted cycle time in seconds (0 if less than 2 poses are given)
+     */
+    double predictCycleTime(const JointVector *poses, int count, double *segmentTimes = NULL);
+
+    /**
+     * Sets the velocity, acceleration and jerk limits of the joints for the
+     * synchronized motions and the travel times of the kinematics solver.
+     *
+     * @param limits The limits (all values must be positive)
+     */
+    void setJointLimits(const MotionLimits &limits);
+
+    /**
+     * Returns the limits of the joints.
+     *
+     * @return the limits
+     */
+    const MotionLimits &getJointLimits();
+
+    /**
+     * Reads the optional limits of the joints from a config file
+     * (MaxVelocity_, MaxAcceleration_ and MaxJerk_ of each joint section).
+     *
+     * @param name The name of the config file (without ".cfg")
+     * @param path The path to the config file
+     * @param limits Receives the limits, missing values keep their value
+     * @return true if the file was read, otherwise the limits of the datasheet are returned
+     */
+    static bool readJointLimits(const string &name, const string &path, MotionLimits &limits);
+
+    /**
+     * Loads a precomputed reachability map. Afterwards unreachable TCPs are
+     * rejected without solving the kinematics. The map is ignored while the
+     * DH parameters of the solver differ from the ones of the map.
+     *
+     * @param fileName The map file (see ReachabilityMap)
+     * @return true if the map is valid for this arm
+     */
+    bool loadReachabilityMap(const string &fileName);
+
+    /**
+     * Returns the kinematics solver of the manipulator, e.g. to enable
+     * the IK cache or to change the DH parameters.
+     *
+     * @return the solver
+     */
+    KinematicsSolver *getKinematicsSolver();
+
     /**
      * Opens the gripper of the robot.
+     *
+     * @return the number of the gripper command (0 if the queue is full)
      */
-    virtual void openGripper();
+    unsigned long openGripper();
 
     /**
      * Closes the gripper of the robot.
+     *
+     * @return the number of the gripper command (0 if the queue is full)
      */
-    virtual void closeGripper();
+    unsigned long closeGripper();
 
     /**
      * Sets the spacing of the gripper manually.
      *
-     * @param distance Open space of the gripper in mm
-     * @return true if the gripper spacing set successfully
+     * @param distance Open space of the gripper in mm (limited to GRIPPER_LIMIT)
+     * @return the number of the gripper command (0 if the queue is full)
+     */
+    unsigned long setGripper(int distance);
+
+    /**
+     * Sets the spacing of the gripper shortly before the running trajectory
+     * ends, e.g. to close the gripper during the final approach of a pick
+     * motion. Without a running trajectory the spacing is set at once.
+     *
+     * @param distance Open space of the gripper in mm (limited to GRIPPER_LIMIT)
+     * @param leadTime Time before the last setpoint of the trajectory in seconds (0 sets the spacing at once)
+     * @return the number of the gripper command (0 if the queue is full)
      */
-    virtual bool setGripper(int distance);
+    unsigned long setGripperBeforeArrival(int distance, double leadTime);
 
     /**
-     * Checks if the robot has reached the latest given position.
-     * The target space has a threshold of one degree.
+     * Returns the number of the latest gripper command.
+     *
+     * @return the number of the command (0 if no command was given)
+     */
+    unsigned long lastGripper();
+
+    /**
+     * Checks if a gripper command is complete. A command is complete when
+     * the gripper had the time to travel to the spacing, or when a later
+     * command is complete.
+     *
+     * @param gripper Number of the gripper command
+     * @return true if the command is complete
+     */
+    bool gripperComplete(unsigned long gripper);
+
+    /**
+     * Waits until a gripper command is complete.
+     *
+     * @param gripper Number of the gripper command
+     * @param timeout Maximum time to wait in seconds
+     * @return true if the command is complete, false on timeout
+     */
+    bool waitForGripper(unsigned long gripper, double timeout);
+
+    /**
+     * Sets a function which is called by the gripper thread when a gripper
+     * command is complete (see setMotionCallback()).
+     *
+     * @param callback The function (an empty function removes the callback)
+     */
+    void setGripperCallback(const MotionCallback &callback);
+
+    /**
+     * Checks if the robot has reached the latest given position
+     * (see motionComplete()).
      *
      * @return true if the robot has reached the position
      */
@@ -196,24 +900,403 @@ protected:
     Manipulator();
 
     /**
-     * Finally sends a processed target angle to the robot.
+     * Finally sends a validated axis command to the robot. All changed
+     * setpoints are written in the same EtherCAT cycle.
+     * Called by the control thread.
+     *
+     * @param targetAngles Kuka angles of all joints in radian
+     * @param changed Flag for each joint if its setpoint changed
+     * @return true if the command was sent
+     */
+    virtual bool sendAxisCommandsToManipulator(const JointVector &targetAngles, const bool changed[ARMJOINTS]);
+
+    /**
+     * Finally sends a gripper command to the robot.
+     * Called by the gripper thread.
+     *
+     * @param command The gripper command
+     * @return true if the command was sent
+     */
+    virtual bool sendGripperCommandToManipulator(const ArmCommand &command);
+
+    /**
+     * Reads the current state of the arm from the hardware.
+     * Called by the control thread.
      *
-     * @param jointIndex
-     * @param targetAngle
-     * @return
+     * @param state Receives the angles, velocities, currents and torques
+     * @return true if the state was read
      */
-    virtual bool sendAxisCommandToManipulator(int jointIndex, JointAngleSetpoint &targetAngle);
+    virtual bool readJointState(JointStateSnapshot &state);
 
-    /** Vector for latest desired position */
-    VectorXd latestDesiredPosition;
+    /**
+     * Passes a command to the control thread.
+     *
+     * @param command The command
+     * @return false if the queue is full
+     */
+    bool queueCommand(ArmCommand &command);
+
+    /**
+     * Starts the control thread and the gripper thread.
+     *
+     * @param cycleTime Cycle time in microseconds
+     */
+    void startCycle(int cycleTime);
+
+    /**
+     * Stops the control thread and the gripper thread. Derived classes which
+     * override the communication functions must call it in their destructor.
+     */
+    void stopCycle();
+
+    /** Timing of the axis commands (written by the control thread) */
+    CommandStatistics commandStatistics;
+
+    /** Timing of the start (written by the constructor) */
+    StartupTiming startupTiming;
+
+    /** Cycle time of the control thread in microseconds */
+    int cycleTime;
+
+    /** Vector for latest desired position (kuka angles of the latest queued command) */
+    JointVector latestDesiredPosition;
+
+    /** true if a cut trajectory left the setpoints where the control thread stopped it */
+    bool desiredResync;
+
+    /** Joints the caller set since the trajectory was cut */
+    bool resyncJoints[ARMJOINTS];
+
+    /** Number of queued commands (caller thread) */
+    unsigned long commandCounter;
 
     /** Member object for the kinematics solver */
     KinematicsSolver *solver;
 
+    /** Limits of the joints for synchronized motions */
+    MotionLimits jointLimits;
+
+    /** Precomputed workspace of the arm (empty if no map is loaded) */
+    ReachabilityMap reachability;
+
+    /**
+     * Returns the latest desired position without waiting. After a cut
+     * trajectory the position is taken from the control thread: its target
+     * once it executed all queued commands, before that its latest setpoint.
+     *
+     * @param angles Vector which receives the axis values in radian (0 is centered)
+     */
+    void getLatestDesiredAxis(JointVector &angles);
+
+    /**
+     * Sets the setpoint the arm holds before the first command. Must be
+     * called before the control thread starts.
+     *
+     * @param setpoint Kuka angles in radian
+     */
+    void setInitialSetpoint(const JointVector &setpoint);
+
+    /**
+     * Solves the inverse kinematics for a TCP. The reachability map is
+     * used to reject impossible poses if it belongs to the DH parameters of
+     * the solver. Of all solutions the
+     * one closest in travel time to the latest desired position is returned.
+     *
+     * @param tcp The desired pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @param angles Vector for storing the calculated angles
+     * @return true if a solution was found
+     */
+    bool solveInverseKinematics(const PoseVector &tcp, JointVector &angles);
+
 private:
 
-    /** Member Object for the youBot API for arm communication */
-    YouBotManipulator *kukaArm;
+    /**
+     * Initialises the members of the control thread.
+     */
+    void initialiseControl();
+
+    /**
+     * Main function of the control thread.
+     */
+    void cycleLoop();
+
+    /**
+     * Executes one command in the control thread.
+     *
+     * @param command The command
+     */
+    void executeCommand(const ArmCommand &command);
+
+    /**
+     * Starts streaming the trajectory buffer if the trajectory starts at the
+     * latest setpoint, otherwise the trajectory is rejected.
+     *
+     * @param command The command (TRAJECTORY_START)
+     */
+    void startTrajectory(const ArmCommand &command);
+
+    /**
+     * Plans a synchronized motion from the latest setpoint to the target of
+     * the command and starts streaming it.
+     *
+     * @param command The command (AXIS_SYNCHRONIZED)
+     * @return false if there is nothing to interpolate, the command is then executed like an axis command
+     */
+    bool startSynchronizedMotion(const ArmCommand &command);
+
+    /**
+     * Sends the next setpoint of a running trajectory.
+     *
+     * @param cycleStart Start of the current control cycle
+     */
+    void streamSetpoint(const chrono::steady_clock::time_point &cycleStart);
+
+    /**
+     * Updates the command statistics after an axis command or a streamed
+     * setpoint and publishes them.
+     *
+     * @param commandSent Flag if the backend accepted the setpoints
+     * @param start Time from which the latency is measured
+     */
+    void countCommand(bool commandSent, const chrono::steady_clock::time_point &start);
+
+    /**
+     * Publishes the latest setpoint and target for the callers.
+     */
+    void publishSetpoint();
+
+    /**
+     * Takes the desired position from the control thread until it executed
+     * the queued commands (caller thread).
+     */
+    void startResync();
+
+    /**
+     * Reads the state of the arm, calculates the pose of the TCP and
+     * publishes the snapshot.
+     *
+     * @param state Receives the published state
+     * @return true if the state was read
+     */
+    bool publishJointState(JointStateSnapshot &state);
+
+    /**
+     * Passes a gripper command to the control thread.
+     *
+     * @param command The command
+     * @return the number of the gripper command (0 if the queue is full)
+     */
+    unsigned long queueGripperCommand(ArmCommand &command);
+
+    /**
+     * Hands a delayed gripper command to the gripper thread when the
+     * running trajectory is close to its end.
+     */
+    void releaseScheduledGripper();
+
+    /**
+     * Hands a gripper command to the gripper thread, a command which wasn't
+     * sent yet is replaced.
+     *
+     * @param command The command
+     */
+    void releaseGripper(const ArmCommand &command);
+
+    /**
+     * Main function of the gripper thread.
+     */
+    void gripperLoop();
+
+    /**
+     * Reports the completion of a gripper command.
+     *
+     * @param gripper Number of the gripper command
+     */
+    void completeGripper(unsigned long gripper);
+
+    /**
+     * Checks if the current motion arrived and reports its completion.
+     *
+     * @param state The state of this cycle
+     */
+    void detectArrival(const JointStateSnapshot &state);
+
+    /**
+     * Measures the time from a motion command until a joint moves
+     * (PROBE_MOTION_START).
+     *
+     * @param state The state of this cycle
+     */
+    void detectMotionStart(const JointStateSnapshot &state);
+
+    /**
+     * Connects the manipulator to the arm: commutation, calibration or warm
+     * start, configuration and the start of the control thread.
+     *
+     * @param backend The arm
+     * @param name The name of the config file (without ".cfg")
+     * @param path The path to the config files
+     * @param calibrationFile The calibration state file (empty for none)
+     * @param forceCalibration Flag if the arm is calibrated in any case
+     * @param start Start of the connection (for the startup timing)
+     */
+    void initialiseArm(ArmBackend *backend, const string &name, const string &path, const string &calibrationFile,
+                       bool forceCalibration, const chrono::steady_clock::time_point &start);
+
+    /**
+     * Compares the stored calibration with the arm. The calibration is
+     * valid if the driver marked all joints as calibrated and all encoders
+     * are close to the stored angles.
+     *
+     * @param angles Receives the sensed angles in radian (0 is centered)
+     * @return true if the arm doesn't need a calibration
+     */
+    bool verifyCalibration(JointVector &angles);
+
+    /** Maximum number of queued commands */
+    static const size_t COMMAND_QUEUE_SIZE = 256;
+
+    /** Maximum distance of the start of a trajectory from the latest setpoint in radian (1°) */
+    static constexpr double TRAJECTORY_START_TOLERANCE = 0.01745;
+
+    /** The arm (NULL for derivated classes without arm) */
+    ArmBackend *backend;
+
+    /** Commands for the control thread */
+    SpscQueue<ArmCommand, COMMAND_QUEUE_SIZE> commandQueue;
+
+    /** Latest state of the arm */
+    SeqLock<JointStateSnapshot> jointState;
+
+    /** Published timing of the commands and the cycles */
+    SeqLock<CommandStatistics> commandTiming;
+    SeqLock<CycleStatistics> cycleTiming;
+
+    /** Buffers of the driver data, allocated once (control thread) */
+    vector<JointSensedAngle> sensedAngleData;
+    vector<JointSensedVelocity> sensedVelocityData;
+    vector<JointSensedCurrent> sensedCurrentData;
+    vector<JointSensedTorque> sensedTorqueData;
+    vector<JointAngleSetpoint> setpointData;
+
+    /** Profile of the synchronized motions, which keeps its memory (control thread) */
+    MotionProfile synchronizedProfile;
+
+    /** Limits of the joints for the synchronized motions of the control thread */
+    SeqLock<MotionLimits> motionLimits;
+
+    /** true if the setpoints are sampled from the synchronized profile instead of the buffer (control thread) */
+    bool streamingProfile;
+
+    /** Setpoints of the streamed trajectory (kuka angles) */
+    vector<JointVector> trajectoryBuffer;
+
+    /** true while the control thread reads the trajectory buffer */
+    atomic<bool> streaming;
+
+    /** Index of the next and number of all setpoints of the trajectory (control thread) */
+    int streamIndex;
+    int streamCount;
+
+    /** Latest setpoint which was sent (control thread) */
+    JointVector lastSetpoint;
+
+    /** Number of the latest executed command (control thread) */
+    unsigned long executedCommand;
+
+    /** Latest setpoint and command of the control thread */
+    SeqLock<SetpointSnapshot> setpointState;
+
+    /** The control thread */
+    thread cycleThread;
+
+    /** true while the control thread should run */
+    atomic<bool> cycleRunning;
+
+    /** Core the control thread runs on (-1 for all cores) */
+    int controlCore;
+
+    /** Number of published states */
+    uint64_t cycleCount;
+
+    /** States of the latest cycles */
+    RingBuffer<JointStateSnapshot> telemetry;
+
+    /** Binary log of the commands and states */
+    TelemetryRecorder recorder;
+
+    /** Stored angles of the calibrated arm */
+    CalibrationStore calibration;
+
+    /** Number of the latest queued motion (caller thread) */
+    unsigned long motionCounter;
+
+    /** Motion whose arrival is checked (control thread, 0 if none) */
+    unsigned long pendingMotion;
+
+    /** Kuka angles the pending motion ends at (control thread) */
+    JointVector motionTarget;
+
+    /** Number of cycles the arm stayed within the tolerances (control thread) */
+    int settledCycles;
+
+    /** Number of the latest complete motion */
+    atomic<unsigned long> completedMotion;
+
+    /** Number of the latest rejected trajectory */
+    atomic<unsigned long> rejectedMotion;
+
+    /** Conditions of an arrived motion */
+    SeqLock<ArrivalCriteria> arrivalCriteria;
+
+    /** Guards the callback and the wake up of waiting threads */
+    mutex arrivalMutex;
+
+    /** Signals a complete motion to waiting threads */
+    condition_variable arrivalCondition;
+
+    /** Function which is called on a complete motion */
+    MotionCallback motionCallback;
+
+    /** Flag if a motion was sent and no joint moved yet (control thread) */
+    bool motionStartPending;
+
+    /** Time the pending motion was commanded (control thread) */
+    chrono::steady_clock::time_point motionCommandTime;
+
+    /** Sensed angles of the latest cycle (control thread) */
+    JointVector sensedAngles;
+
+    /** Number of the latest queued gripper command (caller thread) */
+    unsigned long gripperCounter;
+
+    /** Gripper command which waits for the end of the trajectory (control thread) */
+    ArmCommand scheduledGripper;
+    bool gripperScheduled;
+
+    /** Latest gripper command for the gripper thread */
+    SeqLock<ArmCommand> gripperRequest;
+
+    /** Number of the latest gripper command which was handed to the gripper thread */
+    atomic<unsigned long> requestedGripper;
+
+    /** Number of the latest complete gripper command */
+    atomic<unsigned long> completedGripper;
+
+    /** The gripper thread */
+    thread gripperThread;
+
+    /** Guards the gripper callback and the wake up of the gripper thread and waiting threads */
+    mutex gripperMutex;
+
+    /** Wakes the gripper thread on a new command */
+    condition_variable gripperWakeup;
+
+    /** Signals a complete gripper command to waiting threads */
+    condition_variable gripperCompletion;
+
+    /** Function which is called on a complete gripper command */
+    MotionCallback gripperCallback;
 };
 
 #endif // MANIPULATOR_H
@@ -0,0 +1,230 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MonteCarloEvaluator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+/** Number of chunks the runs of one thread are split into, so idle threads can steal work */
+static const int RUNS_PER_THREAD_CHUNKS = 8;
+
+/**
+ * Scales each element of a vector by its own random factor.
+ *
+ * @param values The vector
+ * @param scale Uniform distribution of the factor
+ * @param generator The random generator
+ */
+static void vary(JointVector &values, uniform_real_distribution<double> &scale, mt19937 &generator)
+{
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        values[i] *= scale(generator);
+    }
+}
+
+double EvaluationResult::percentile(const vector<double> &values, double percent)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    int index = (int) round(percent / 100. * (values.size() - 1));
+    return values[min(max(index, 0), (int) values.size() - 1)];
+}
+
+MonteCarloEvaluator::MonteCarloEvaluator(const KinematicsSolver &solver, int threads) : solver(solver), pool(threads)
+{
+}
+
+void MonteCarloEvaluator::setSimulationParameters(const SimulationParameters &parameters)
+{
+    this->parameters = parameters;
+}
+
+void MonteCarloEvaluator::setArrivalCriteria(const ArrivalCriteria &criteria)
+{
+    this->criteria = criteria;
+}
+
+void MonteCarloEvaluator::setVariation(const ProgramVariation &variation)
+{
+    this->variation = variation;
+}
+
+int MonteCarloEvaluator::threads() const
+{
+    return this->pool.size();
+}
+
+bool MonteCarloEvaluator::evaluate(const JointVector *poses, const double *grippers, int count, int runs,
+                                   unsigned int seed, EvaluationResult &result)
+{
+    if (count < 1)
+    {
+        return false;
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    /* A pick is a pose at which the gripper closes, the spacing is unknown at the start */
+    double spacing = numeric_limits<double>::quiet_NaN();
+    result.picksPerCycle = 0;
+
+    for (int n = 0; n < count && grippers != NULL; n++)
+    {
+        if (!std::isnan(grippers[n]))
+        {
+            double previous = std::isnan(spacing) ? GRIPPER_LIMIT[1] * 1000. : spacing;
+            result.picksPerCycle += (grippers[n] < previous) ? 1 : 0;
+            spacing = grippers[n];
+        }
+    }
+
+    /*
+     * The arm has only 5 joints, so a noisy tcp is generally unreachable. The
+     * noise is mapped to the joints like one step of the iterative inverse
+     * kinematics, which weights the orientation against the position.
+     */
+    IterativeIKParameters settings;
+    double weight = settings.orientationWeight * settings.orientationWeight;
+    vector<Matrix<double, 5, 6>, aligned_allocator<Matrix<double, 5, 6> > > projections(count);
+
+    for (int n = 0; n < count; n++)
+    {
+        JacobianMatrix jacobian;
+        Matrix4d transformation;
+        this->solver.jacobian(poses[n], jacobian, transformation);
+
+        Matrix<double, 6, 6> weights = Matrix<double, 6, 1>(1, 1, 1, weight, weight, weight).asDiagonal();
+        Matrix<double, 5, 5> normal = jacobian.transpose() * weights * jacobian;
+        normal.diagonal().array() += settings.damping * settings.damping;
+        projections[n] = normal.ldlt().solve(jacobian.transpose() * weights);
+    }
+
+    vector<Run> timings(runs);
+
+    /* Each call of the task owns its simulator, so the threads share nothing but read only data */
+    int grainSize = max(1, runs / (RUNS_PER_THREAD_CHUNKS * this->pool.size()));
+    this->pool.parallelFor(runs, grainSize, [&](int begin, int end)
+    {
+        ProgramSimulator simulator;
+        ProgramTiming timing;
+        vector<JointVector> noisy(count);
+        uniform_real_distribution<double> limitScale(1. - this->variation.limits, 1. + this->variation.limits);
+        uniform_real_distribution<double> gainScale(1. - this->variation.gains, 1. + this->variation.gains);
+        uniform_real_distribution<double> toleranceScale(1. - this->variation.tolerances, 1. + this->variation.tolerances);
+        normal_distribution<double> noise(0, 1);
+
+        for (int r = begin; r < end; r++)
+        {
+            seed_seq sequence = {seed, (unsigned int) r};
+            mt19937 generator(sequence);
+
+            SimulationParameters parameters = this->parameters;
+            vary(parameters.limits.velocity, limitScale, generator);
+            vary(parameters.limits.acceleration, limitScale, generator);
+            vary(parameters.limits.jerk, limitScale, generator);
+            vary(parameters.p, gainScale, generator);
+            vary(parameters.i, gainScale, generator);
+            vary(parameters.d, gainScale, generator);
+
+            ArrivalCriteria criteria = this->criteria;
+            vary(criteria.positionTolerance, toleranceScale, generator);
+            vary(criteria.velocityTolerance, toleranceScale, generator);
+
+            /* Position error and orientation error as rotation vector, the joints stay inside their limits */
+            for (int n = 0; n < count; n++)
+            {
+                Matrix<double, 6, 1> error;
+                for (int k = 0; k < 6; k++)
+                {
+                    error[k] = noise(generator) * ((k < 3) ? this->variation.positionNoise : this->variation.orientationNoise);
+                }
+                noisy[n] = poses[n] + projections[n] * error;
+
+                for (int i = 0; i < ARMJOINTS; i++)
+                {
+                    noisy[n][i] = max(BOTTOM_LIMIT_SD[i], min(TOP_LIMIT_SD[i], noisy[n][i]));
+                }
+            }
+
+            simulator.setSimulationParameters(parameters);
+            simulator.setJointLimits(this->parameters.limits);
+            simulator.setArrivalCriteria(criteria);
+
+            Run &run = timings[r];
+            run.complete = simulator.run(noisy[count - 1], noisy.data(), grippers, count, timing);
+            run.total = timing.total;
+            run.segments = timing.segments;
+        }
+    });
+
+    /* The statistics are collected by the calling thread */
+    result.runs = runs;
+    result.failed = 0;
+    result.cycleTimes.clear();
+    result.throughput.clear();
+    result.meanSegments.assign(count, 0);
+    result.worstSegments.assign(count, 0);
+    result.worstRuns.assign(count, -1);
+
+    for (int r = 0; r < runs; r++)
+    {
+        const Run &run = timings[r];
+
+        if (!run.complete)
+        {
+            result.failed++;
+            continue;
+        }
+        result.cycleTimes.push_back(run.total);
+
+        /* A program without picks has no throughput */
+        if (result.picksPerCycle > 0)
+        {
+            result.throughput.push_back(3600. * result.picksPerCycle / run.total);
+        }
+
+        for (int n = 0; n < count; n++)
+        {
+            result.meanSegments[n] += run.segments[n];
+
+            if (run.segments[n] > result.worstSegments[n])
+            {
+                result.worstSegments[n] = run.segments[n];
+                result.worstRuns[n] = r;
+            }
+        }
+    }
+
+    for (int n = 0; n < count && !result.cycleTimes.empty(); n++)
+    {
+        result.meanSegments[n] /= result.cycleTimes.size();
+    }
+    sort(result.cycleTimes.begin(), result.cycleTimes.end());
+    sort(result.throughput.begin(), result.throughput.end());
+    result.wallTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return !result.cycleTimes.empty();
+}
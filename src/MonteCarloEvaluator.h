@@ -0,0 +1,208 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MONTECARLOEVALUATOR_H
+#define MONTECARLOEVALUATOR_H
+
+#include <vector>
+#include "ProgramSimulator.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+/**
+ * Random variation of the simulated arm between two runs. The relative
+ * variations scale each value by a uniform factor in [1 - v, 1 + v], the
+ * noise is added to each pose as normal distributed error.
+ */
+struct ProgramVariation
+{
+    /** Variation of the velocity, acceleration and jerk limits of each joint */
+    double limits;
+
+    /** Variation of the controller gains of each joint */
+    double gains;
+
+    /** Variation of the arrival tolerances of each joint */
+    double tolerances;
+
+    /** Standard deviation of the tcp position in meter */
+    double positionNoise;
+
+    /** Standard deviation of the tcp orientation in radian */
+    double orientationNoise;
+
+    /**
+     * Constructor:
+     * Creates the default variation (see ybparams.h).
+     */
+    ProgramVariation() : limits(VARIATION_LIMITS), gains(VARIATION_GAINS), tolerances(VARIATION_TOLERANCES),
+        positionNoise(VARIATION_POSITION_NOISE), orientationNoise(VARIATION_ORIENTATION_NOISE)
+    {
+    }
+};
+
+/**
+ * Result of a Monte Carlo evaluation of a pose program.
+ */
+struct EvaluationResult
+{
+    /** Number of runs */
+    int runs;
+
+    /** Number of runs with a motion which didn't arrive */
+    int failed;
+
+    /** Picks of one program (the poses at which the gripper closes, 0 without gripper) */
+    int picksPerCycle;
+
+    /** Cycle times of the successful runs in seconds, sorted */
+    vector<double> cycleTimes;
+
+    /** Throughput of the successful runs in picks per hour, sorted, empty without picks */
+    vector<double> throughput;
+
+    /** Mean and longest time of each motion over all successful runs in seconds */
+    vector<double> meanSegments;
+    vector<double> worstSegments;
+
+    /** Run in which each motion took longest */
+    vector<int> worstRuns;
+
+    /** Time of the evaluation in seconds */
+    double wallTime;
+
+    /**
+     * Returns a percentile of a sorted list.
+     *
+     * @param values The sorted values
+     * @param percent The percentile (0 - 100)
+     * @return the value, 0 if the list is empty
+     */
+    static double percentile(const vector<double> &values, double percent);
+};
+
+/**
+ * An object of this class runs many simulated executions of a pose program
+ * in parallel to estimate the throughput of a cell and its spread.
+ *
+ * Each run varies the joint limits, the controller gains and the arrival
+ * tolerances of the simulated arm and adds noise to the tcp of each pose,
+ * which is mapped to the joints with the Jacobian of the pose. The motions
+ * are still planned with the nominal limits of the config file, so slower
+ * joints lag behind their trajectory like on the real arm. A run is a
+ * ProgramSimulator on the virtual clock (see ProgramSimulator).
+ *
+ * The runs are distributed over the threads of an own WorkerPool. Every
+ * thread has its own simulator and random generator and writes only the
+ * results of its own runs, the solver is only read. The random numbers of
+ * a run only depend on the seed and the number of the run, so the result
+ * doesn't depend on the number of threads.
+ *
+ * @author Stefan Wilkes
+ */
+class MonteCarloEvaluator
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an evaluator with the default arm and variation.
+     *
+     * @param solver Solver for the Jacobians of the poses, must not be changed during an evaluation
+     * @param threads Number of threads (0 uses one thread per core)
+     */
+    MonteCarloEvaluator(const KinematicsSolver &solver, int threads = 0);
+
+    /**
+     * Sets the nominal parameters of the simulated joints. The motions are
+     * planned with their joint limits.
+     *
+     * @param parameters The parameters
+     */
+    void setSimulationParameters(const SimulationParameters &parameters);
+
+    /**
+     * Sets the nominal arrival criteria.
+     *
+     * @param criteria The tolerances and the settle time
+     */
+    void setArrivalCriteria(const ArrivalCriteria &criteria);
+
+    /**
+     * Sets the variation between the runs.
+     *
+     * @param variation The variation
+     */
+    void setVariation(const ProgramVariation &variation);
+
+    /**
+     * Returns the number of threads.
+     *
+     * @return the number of threads which run the simulations
+     */
+    int threads() const;
+
+    /**
+     * Runs a pose program several times. Each run starts at the last pose
+     * like a repeated program.
+     *
+     * @param poses Axis values of the poses in radian (0 is centered)
+     * @param grippers Gripper spacing of each pose in mm (NaN keeps the gripper) or NULL
+     * @param count Number of poses
+     * @param runs Number of runs
+     * @param seed Seed of the random variation
+     * @param result Receives the statistics of all runs
+     * @return true if at least one run was successful, false without poses
+     */
+    bool evaluate(const JointVector *poses, const double *grippers, int count, int runs, unsigned int seed,
+                  EvaluationResult &result);
+
+private:
+
+    /**
+     * Timing of one run.
+     */
+    struct Run
+    {
+        bool complete;
+        double total;
+        vector<double> segments;
+    };
+
+    /** Solver for the Jacobians of the poses */
+    const KinematicsSolver &solver;
+
+    /** Threads of the runs */
+    WorkerPool pool;
+
+    /** Nominal parameters of the simulated joints */
+    SimulationParameters parameters;
+
+    /** Nominal arrival criteria */
+    ArrivalCriteria criteria;
+
+    /** Variation between the runs */
+    ProgramVariation variation;
+};
+
+#endif // MONTECARLOEVALUATOR_H
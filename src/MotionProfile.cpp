@@ -0,0 +1,238 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MotionProfile.h"
+#include <algorithm>
+#include <cmath>
+
+MotionProfile::MotionProfile()
+{
+}
+
+bool MotionProfile::set(const JointVector *poses, int count, const MotionLimits &limits)
+{
+    bool valid = (count >= 2);
+
+    for (int i = 0; i < ARMJOINTS && valid; i++)
+    {
+        valid = (limits.velocity[i] > 0) && (limits.acceleration[i] > 0) && (limits.jerk[i] > 0);
+    }
+
+    this->poses.clear();
+    this->times.clear();
+    this->profiles.clear();
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    this->poses.assign(poses, poses + count);
+    this->times.resize(count);
+    this->profiles.resize((count - 1) * ARMJOINTS);
+    this->times[0] = 0;
+
+    for (int s = 0; s < count - 1; s++)
+    {
+        AxisProfile *axes = &this->profiles[s * ARMJOINTS];
+        double axisTimes[ARMJOINTS];
+        double segmentTime = 0;
+
+        /* The slowest joint defines the duration of the segment */
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            axisTimes[i] = minimumTime(poses[s + 1][i] - poses[s][i], limits.velocity[i],
+                                       limits.acceleration[i], limits.jerk[i], &axes[i]);
+            segmentTime = max(segmentTime, axisTimes[i]);
+        }
+
+        /*
+         * Stretching a profile by a factor k divides the velocity by k, the
+         * acceleration by k^2 and the jerk by k^3, so all limits hold
+         */
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            axes[i].timeScale = (axisTimes[i] > 0) ? segmentTime / axisTimes[i] : 1;
+        }
+        this->times[s + 1] = this->times[s] + segmentTime;
+    }
+
+    return true;
+}
+
+double MotionProfile::duration() const
+{
+    return this->times.empty() ? 0. : this->times.back();
+}
+
+int MotionProfile::segments() const
+{
+    return this->times.empty() ? 0 : this->times.size() - 1;
+}
+
+double MotionProfile::segmentDuration(int segment) const
+{
+    return this->times[segment + 1] - this->times[segment];
+}
+
+double MotionProfile::minimumTime(double distance, double velocity, double acceleration, double jerk, AxisProfile *profile)
+{
+    double h = fabs(distance);
+    double tj;
+    double ta;
+    double tv;
+
+    /* Acceleration phase if the maximum velocity is reached */
+    if (velocity * jerk >= acceleration * acceleration)
+    {
+        tj = acceleration / jerk;
+        ta = tj + velocity / acceleration;
+    }
+    else
+    {
+        tj = sqrt(velocity / jerk);
+        ta = 2 * tj;
+    }
+    tv = h / velocity - ta;
+
+    /* The distance is too short for the maximum velocity */
+    if (tv < 0)
+    {
+        tv = 0;
+
+        if (h >= 2 * acceleration * acceleration * acceleration / (jerk * jerk))
+        {
+            tj = acceleration / jerk;
+            ta = tj / 2 + sqrt(tj * tj / 4 + h / acceleration);
+        }
+        else
+        {
+            tj = cbrt(h / (2 * jerk));
+            ta = 2 * tj;
+        }
+    }
+
+    if (profile != NULL)
+    {
+        profile->distance = distance;
+        profile->jerk = jerk;
+        profile->jerkTime = tj;
+        profile->accelerationTime = ta;
+        profile->cruiseTime = tv;
+        profile->timeScale = 1;
+    }
+    return (h > 0) ? 2 * ta + tv : 0.;
+}
+
+void MotionProfile::sample(double time, JointVector &position, JointVector *velocity, JointVector *acceleration) const
+{
+    if (this->poses.empty())
+    {
+        return;
+    }
+
+    time = min(max(time, 0.), this->duration());
+    int segment = upper_bound(this->times.begin(), this->times.end(), time) - this->times.begin() - 1;
+    segment = min(max(segment, 0), this->segments() - 1);
+
+    const AxisProfile *axes = &this->profiles[segment * ARMJOINTS];
+    double t = time - this->times[segment];
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        double k = axes[i].timeScale;
+        double p;
+        double v;
+        double a;
+
+        sampleAxis(axes[i], t / k, p, v, a);
+        position[i] = this->poses[segment][i] + p;
+
+        if (velocity != NULL)
+        {
+            (*velocity)[i] = v / k;
+        }
+        if (acceleration != NULL)
+        {
+            (*acceleration)[i] = a / (k * k);
+        }
+    }
+}
+
+void MotionProfile::sampleAxis(const AxisProfile &profile, double time, double &position, double &velocity, double &acceleration)
+{
+    double h = fabs(profile.distance);
+    double sign = (profile.distance < 0) ? -1 : 1;
+    double j = profile.jerk;
+    double tj = profile.jerkTime;
+    double ta = profile.accelerationTime;
+    double total = 2 * ta + profile.cruiseTime;
+
+    if (h == 0)
+    {
+        position = velocity = acceleration = 0;
+        return;
+    }
+
+    /* The deceleration mirrors the acceleration */
+    time = min(max(time, 0.), total);
+    bool mirrored = (time > total / 2);
+    double t = mirrored ? total - time : time;
+
+    double a = j * tj;
+    double v = (ta - tj) * a;
+
+    if (t < tj)
+    {
+        position = j * t * t * t / 6;
+        velocity = j * t * t / 2;
+        acceleration = j * t;
+    }
+    else if (t < ta - tj)
+    {
+        position = a / 6 * (3 * t * t - 3 * tj * t + tj * tj);
+        velocity = a * (t - tj / 2);
+        acceleration = a;
+    }
+    else if (t < ta)
+    {
+        double r = ta - t;
+        position = v * ta / 2 - v * r + j * r * r * r / 6;
+        velocity = v - j * r * r / 2;
+        acceleration = j * r;
+    }
+    else
+    {
+        position = v * ta / 2 + v * (t - ta);
+        velocity = v;
+        acceleration = 0;
+    }
+
+    if (mirrored)
+    {
+        position = h - position;
+        acceleration = -acceleration;
+    }
+    position *= sign;
+    velocity *= sign;
+    acceleration *= sign;
+}
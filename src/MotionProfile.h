@@ -0,0 +1,184 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MOTIONPROFILE_H
+#define MOTIONPROFILE_H
+
+#include <eigen3/Eigen/Dense>
+#include <vector>
+#include "Trajectory.h"
+#include "ybparams.h"
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * Kinematic limits of all joints.
+ */
+struct MotionLimits
+{
+    /** Maximum velocity in radian per second */
+    JointVector velocity;
+
+    /** Maximum acceleration in radian per second squared */
+    JointVector acceleration;
+
+    /** Maximum jerk in radian per second cubed */
+    JointVector jerk;
+
+    /**
+     * Constructor:
+     * Creates the limits of the datasheet.
+     */
+    MotionLimits() : velocity(MAX_VELOCITY_SD), acceleration(MAX_ACCELERATION_SD), jerk(MAX_JERK_SD)
+    {
+    }
+};
+
+/**
+ * Jerk limited motion of one joint from rest to rest (double S profile).
+ * The profile is symmetric: jerk phase, constant acceleration, jerk phase,
+ * constant velocity and the same phases mirrored for the deceleration.
+ */
+struct AxisProfile
+{
+    /** Signed distance in radian */
+    double distance;
+
+    /** Jerk of the jerk phases */
+    double jerk;
+
+    /** Duration of one jerk phase */
+    double jerkTime;
+
+    /** Duration of the whole acceleration (including both jerk phases) */
+    double accelerationTime;
+
+    /** Duration of the constant velocity */
+    double cruiseTime;
+
+    /** Factor which stretches the profile to the duration of the segment */
+    double timeScale;
+};
+
+/**
+ * An object of this class calculates a minimum time motion through a list
+ * of poses under the velocity, acceleration and jerk limits of each joint.
+ *
+ * The arm stops at every pose, like in the automatic mode. Within a segment
+ * each joint gets its own time optimal double S profile. The profiles of
+ * the faster joints are stretched to the duration of the slowest one, so
+ * all joints start and arrive together and no joint exceeds its limits.
+ * The duration of the whole motion is the predicted cycle time of a pose
+ * program.
+ *
+ * @author Stefan Wilkes
+ */
+class MotionProfile : public Trajectory
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an empty motion.
+     */
+    MotionProfile();
+
+    /**
+     * Calculates the motion through the given poses.
+     *
+     * @param poses Axis values in radian (0 is centered)
+     * @param count Number of poses (at least 2)
+     * @param limits Limits of the joints (all values must be positive)
+     * @return true if the motion is valid
+     */
+    bool set(const JointVector *poses, int count, const MotionLimits &limits = MotionLimits());
+
+    /**
+     * Returns the duration of the whole motion.
+     *
+     * @return the predicted time from the first to the last pose in seconds
+     */
+    virtual double duration() const;
+
+    /**
+     * Returns the number of segments.
+     *
+     * @return the number of poses minus one (0 if the motion is empty)
+     */
+    int segments() const;
+
+    /**
+     * Returns the duration of a segment.
+     *
+     * @param segment Index of the segment (from pose segment to segment + 1)
+     * @return the time of the segment in seconds
+     */
+    double segmentDuration(int segment) const;
+
+    /**
+     * Returns the time the arm needs for one joint motion from rest to rest.
+     *
+     * @param distance Signed distance in radian
+     * @param velocity Maximum velocity
+     * @param acceleration Maximum acceleration
+     * @param jerk Maximum jerk
+     * @param profile Optional pointer which receives the profile
+     * @return the minimum time in seconds
+     */
+    static double minimumTime(double distance, double velocity, double acceleration, double jerk, AxisProfile *profile = NULL);
+
+    /**
+     * Evaluates the motion. Times outside the motion are clamped
+     * to the first or last pose.
+     *
+     * @param time Time since the start in seconds
+     * @param position Receives the axis values in radian
+     * @param velocity Optional pointer which receives the axis velocities
+     * @param acceleration Optional pointer which receives the axis accelerations
+     */
+    virtual void sample(double time, JointVector &position, JointVector *velocity = NULL, JointVector *acceleration = NULL) const;
+
+private:
+
+    /**
+     * Evaluates the profile of one joint.
+     *
+     * @param profile The profile
+     * @param time Time since the start of the segment
+     * @param position Receives the travelled distance
+     * @param velocity Receives the velocity
+     * @param acceleration Receives the acceleration
+     */
+    static void sampleAxis(const AxisProfile &profile, double time, double &position, double &velocity, double &acceleration);
+
+    /** Poses of the motion */
+    vector<JointVector> poses;
+
+    /** Time of each pose since the start */
+    vector<double> times;
+
+    /** Profiles of each segment (ARMJOINTS per segment) */
+    vector<AxisProfile> profiles;
+};
+
+#endif // MOTIONPROFILE_H
@@ -21,54 +21,179 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "OfflineManipulator.h"
+#include <cmath>
+#include <sstream>
 #include "ybparams.h"
 
 OfflineManipulator::OfflineManipulator()
 {
     /* Same as for the real manipulator without arm initialisation */
-    this->latestDesiredPosition = VectorXd(ARMJOINTS);
+    this->setInitialSetpoint(JointVector::Zero());
+    this->simulationParameters.store(SimulationParameters());
+    this->replayIndex = 0;
+    this->replaying = false;
     this->solver = new KinematicsSolver();
+    this->startCycle(DEFAULT_CYCLE_TIME_US);
 }
 
-void OfflineManipulator::getSensedAxis(VectorXd &axisAnglesRad)
+OfflineManipulator::~OfflineManipulator()
 {
-    /* Simply return the desired position as absolute angles */
-    axisAnglesRad = this->latestDesiredPosition;
+    this->stopCycle();
+}
+
+bool OfflineManipulator::readJointState(JointStateSnapshot &state)
+{
+    if (this->replaying.load(memory_order_relaxed) && this->replayJointState(state))
+    {
+        return true;
+    }
+
+    /* The simulation time advances by one cycle per cycle */
+    SimulationParameters parameters;
+    this->simulationParameters.load(parameters);
+    this->joints.step(parameters, this->cycleTime * 1e-6);
 
     for (int i = 0; i < ARMJOINTS; i++)
     {
         /* Convert kuka angle to angle (0 is centered) */
-        axisAnglesRad[i] += (i == 2) ? TOP_LIMIT_SD[i] : BOTTOM_LIMIT_SD[i];
+        state.angles[i] = this->joints.getPosition()[i] + KUKA_ANGLE_OFFSET[i];
     }
+    state.velocities = this->joints.getVelocity();
+    state.currents.setZero();
+    state.torques.setZero();
+
+    return true;
 }
 
-bool OfflineManipulator::sendAxisCommandToManipulator(int jointIndex, JointAngleSetpoint &targetAngle)
+bool OfflineManipulator::sendAxisCommandsToManipulator(const JointVector &targetAngles, const bool changed[ARMJOINTS])
 {
-    /* Simply store the desired value */
-    this->latestDesiredPosition[jointIndex - 1] = quantity_cast<double>(targetAngle.angle);
-
+    /* The simulated joints move to the new setpoints */
+    this->joints.setTarget(targetAngles, changed);
     return true;
 }
 
-bool OfflineManipulator::positionReached()
+bool OfflineManipulator::sendGripperCommandToManipulator(const ArmCommand &command)
 {
-    /* A bad simulator always reaches the position! */
+    /* It was successful, of course :) */
     return true;
 }
 
-void OfflineManipulator::openGripper()
+void OfflineManipulator::setSimulationParameters(const SimulationParameters &parameters)
 {
-    /* Simply do nothing */
+    this->simulationParameters.store(parameters);
+    this->setJointLimits(parameters.limits);
 }
 
-void OfflineManipulator::closeGripper()
+void OfflineManipulator::getSimulationParameters(SimulationParameters &parameters)
 {
-    /* Simply do nothing */
+    this->simulationParameters.load(parameters);
 }
 
-bool OfflineManipulator::setGripper(int distance)
+bool OfflineManipulator::loadSimulationParameters(const string &name, const string &path)
 {
-    /* It was successful, of course :) */
+    SimulationParameters parameters;
+    if (!readSimulationParameters(name, path, parameters))
+    {
+        return false;
+    }
+
+    this->setSimulationParameters(parameters);
     return true;
 }
 
+bool OfflineManipulator::readSimulationParameters(const string &name, const string &path,
+                                                  SimulationParameters &parameters)
+{
+    if (!readJointLimits(name, path, parameters.limits))
+    {
+        return false;
+    }
+
+    try
+    {
+        ConfigFile configFile(name + ".cfg", path);
+
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            stringstream section;
+            section << "Joint_" << (i + 1);
+
+            configFile.readInto(parameters.p[i], section.str(), "trajectory_controller_P");
+            configFile.readInto(parameters.i[i], section.str(), "trajectory_controller_I");
+            configFile.readInto(parameters.d[i], section.str(), "trajectory_controller_D");
+            configFile.readInto(parameters.iMax[i], section.str(), "trajectory_controller_I_max");
+            configFile.readInto(parameters.iMin[i], section.str(), "trajectory_controller_I_min");
+        }
+    }
+    catch (std::exception &e)
+    {
+        return false;
+    }
+    return true;
+}
+
+bool OfflineManipulator::startReplay(const string &fileName)
+{
+    TelemetryLog log;
+    if (!log.load(fileName))
+    {
+        return false;
+    }
+
+    /* The control thread doesn't run while the log is exchanged */
+    this->stopCycle();
+    this->replayLog = log;
+    this->replayIndex = 0;
+    this->replaying = true;
+
+    int cycleTime = this->replayLog.getHeader().cycleTime;
+    this->startCycle((cycleTime > 0) ? cycleTime : DEFAULT_CYCLE_TIME_US);
+
+    return true;
+}
+
+bool OfflineManipulator::replayActive()
+{
+    return this->replaying;
+}
+
+bool OfflineManipulator::replayJointState(JointStateSnapshot &state)
+{
+    /* Commands are recorded before the state of their cycle */
+    while (this->replayIndex < this->replayLog.size())
+    {
+        const TelemetryRecord &record = this->replayLog.record(this->replayIndex++);
+
+        if (record.type == TELEMETRY_COMMAND)
+        {
+            JointVector setpoint;
+            bool changed[ARMJOINTS];
+
+            for (int i = 0; i < ARMJOINTS; i++)
+            {
+                setpoint[i] = record.values[0][i];
+                changed[i] = (record.flags & (1 << i)) != 0;
+            }
+            this->joints.setTarget(setpoint, changed);
+        }
+        else if (record.type == TELEMETRY_STATE)
+        {
+            /* The simulated joints continue from the recorded state after the log ends */
+            JointVector position;
+
+            for (int i = 0; i < ARMJOINTS; i++)
+            {
+                state.angles[i] = record.values[0][i];
+                state.velocities[i] = record.values[1][i];
+                state.currents[i] = record.values[2][i];
+                state.torques[i] = record.values[3][i];
+                position[i] = state.angles[i] - KUKA_ANGLE_OFFSET[i];
+            }
+            this->joints.setState(position, state.velocities);
+            return true;
+        }
+    }
+
+    this->replaying = false;
+    return false;
+}
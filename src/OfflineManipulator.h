@@ -24,13 +24,25 @@
 #define OFFLINEMANIPULATOR_H
 
 #include "Manipulator.h"
+#include "JointSimulation.h"
 
 /**
  * An object of this class is based on the manipualator object and overides
  * all hardware communications thus you can use it as an offline manipulator
  * for algorthmic testing purposes like the kinematics implementation.
  *
- * It assumes that all given positions are reached exactly and instantly.
+ * Each joint is simulated like the trajectory controller of the driver (see
+ * JointSimulation). The joints advance by one cycle time per cycle of the
+ * control thread, independent of the time the cycle really took, so a run
+ * is reproducible and the arrival detection sees the same lag as on the
+ * real arm. The gripper thread waits for the travel time of the gripper
+ * like for the real arm.
+ *
+ * A telemetry log of the real arm can be replayed: the control thread then
+ * reads one recorded state per cycle instead of the simulated one, so the
+ * sensed values, the arrival detection and the timing of the control thread
+ * behave like during the recording. The recorded commands move the
+ * simulated arm, which continues from the last setpoint after the log ends.
  *
  * @author Stefan Wilkes
  */
@@ -44,50 +56,115 @@ public:
     OfflineManipulator();
 
     /**
-     * Overides the original communication function.
-     * A position in the simulator is always reached.
+     * Destructor:
+     * Stops the control thread.
+     */
+    ~OfflineManipulator();
+
+    /**
+     * Sets the parameters of the simulated joints. The joint limits of the
+     * synchronized motions are set to the same values.
      *
-     * @return true
+     * @param parameters The parameters
      */
-    bool positionReached();
+    void setSimulationParameters(const SimulationParameters &parameters);
 
     /**
-     * Overides the original communication function.
-     * The sensed value is always the desired value.
+     * Returns the parameters of the simulated joints.
      *
-     * @param axisAnglesRad Vector for receiving the sensed values
+     * @param parameters Receives the parameters
      */
-    void getSensedAxis(VectorXd &axisAnglesRad);
+    void getSimulationParameters(SimulationParameters &parameters);
 
     /**
-     * Overides the original communication function.
-     * This function does actually nothing
+     * Reads the parameters of the simulated joints from the config file of
+     * a real arm (trajectory_controller_P/I/D/I_max/I_min, MaxVelocity_ and
+     * MaxAcceleration_ of each joint section).
+     *
+     * @param name The name of the config file (without ".cfg")
+     * @param path The path to the config file
+     * @return true if the file was read
      */
-    void openGripper();
+    bool loadSimulationParameters(const string &name, const string &path);
 
     /**
-     * Overides the original communication function.
-     * This function does actually nothing
+     * Reads the parameters of the simulated joints from a config file
+     * without an arm, e.g. for the ProgramSimulator.
+     *
+     * @param name The name of the config file (without ".cfg")
+     * @param path The path to the config file
+     * @param parameters Receives the parameters
+     * @return true if the file was read
+     */
+    static bool readSimulationParameters(const string &name, const string &path, SimulationParameters &parameters);
+
+    /**
+     * Replays a telemetry log (see TelemetryRecorder). The control thread is
+     * restarted with the cycle time of the recording and replays one
+     * recorded cycle per cycle, independent of the commands given meanwhile.
+     *
+     * @param fileName The log file
+     * @return true if the log was loaded and the replay started
+     */
+    bool startReplay(const string &fileName);
+
+    /**
+     * Checks if a log is replayed.
+     *
+     * @return true until the last recorded state was read
      */
-    void closeGripper();
+    bool replayActive();
+
+private:
 
     /**
      * Overides the original communication function.
-     * This function does actually nothing.
+     * Advances the simulated joints by one cycle time.
      *
+     * @param state Receives the simulated angles and velocities, currents and torques are zero
      * @return true
      */
-    bool setGripper(int distance);
+    bool readJointState(JointStateSnapshot &state);
 
-private:
+    /**
+     * Overides the original communication function.
+     * This function stores the new setpoints of the simulated joints.
+     *
+     * @return true
+     */
+    bool sendAxisCommandsToManipulator(const JointVector &targetAngles, const bool changed[ARMJOINTS]);
 
     /**
      * Overides the original communication function.
-     * This function simply store the desired axis values.
+     * This function does actually nothing.
      *
      * @return true
      */
-    bool sendAxisCommandToManipulator(int jointIndex, JointAngleSetpoint &targetAngle);
+    bool sendGripperCommandToManipulator(const ArmCommand &command);
+
+    /**
+     * Reads the next recorded state and applies the commands of its cycle.
+     * Called by the control thread.
+     *
+     * @param state Receives the recorded angles, velocities, currents and torques
+     * @return false at the end of the log
+     */
+    bool replayJointState(JointStateSnapshot &state);
+
+    /** The simulated joints (control thread) */
+    JointSimulation joints;
+
+    /** Parameters of the simulated joints */
+    SeqLock<SimulationParameters> simulationParameters;
+
+    /** The replayed log (only changed while the control thread is stopped) */
+    TelemetryLog replayLog;
+
+    /** Index of the next record to replay (control thread) */
+    size_t replayIndex;
+
+    /** true while the log is replayed */
+    atomic<bool> replaying;
 };
 
 #endif // OFFLINEMANIPULATOR_H
@@ -0,0 +1,139 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "PoseProgram.h"
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+PoseProgram::PoseProgram()
+{
+}
+
+bool PoseProgram::load(const string &fileName, const KinematicsSolver &solver, const JointVector &start)
+{
+    this->angles.clear();
+    this->spacings.clear();
+    this->error.clear();
+
+    ifstream poseFile(fileName.c_str());
+    if (!poseFile)
+    {
+        return this->fail("Can't open input file");
+    }
+
+    string line;
+    getline(poseFile, line);
+    bool posMode = (line == "#POSITIONS");
+    bool angleMode = (line == "#ANGLES");
+
+    if (!posMode && !angleMode)
+    {
+        return this->fail("Missing operation mode in first line");
+    }
+
+    /* Get vector size (5 for angles, 6 for positions), optionally followed by the gripper spacing */
+    int vectorSize = (angleMode) ? 5 : 6;
+    vector<PoseVector, aligned_allocator<PoseVector> > tcps;
+
+    for (int lineNumber = 2; getline(poseFile, line); lineNumber++)
+    {
+        istringstream values(line);
+        vector<double> numbers;
+        double number;
+
+        while (values >> number)
+        {
+            numbers.push_back(number);
+        }
+
+        if (!values.eof() || ((int) numbers.size() != vectorSize && (int) numbers.size() != vectorSize + 1))
+        {
+            stringstream message;
+            message << "Can't parse line " << lineNumber << " from input file";
+            return this->fail(message.str());
+        }
+
+        this->spacings.push_back(((int) numbers.size() > vectorSize) ? numbers[vectorSize] :
+                                                                        numeric_limits<double>::quiet_NaN());
+        if (posMode)
+        {
+            tcps.push_back(PoseVector(Map<PoseVector>(&numbers[0])));
+        }
+        else
+        {
+            this->angles.push_back(JointVector(Map<JointVector>(&numbers[0])));
+        }
+    }
+
+    if (posMode && !tcps.empty())
+    {
+        /* Solve the kinematics of all positions in parallel */
+        int count = tcps.size();
+        this->angles.resize(count);
+        unique_ptr<bool[]> success(new bool[count]);
+        solver.inverseTransformationSequence(tcps.data(), count, start, this->angles.data(), success.get());
+
+        int unreachable = 0;
+        while (unreachable < count && success[unreachable])
+        {
+            unreachable++;
+        }
+
+        if (unreachable < count)
+        {
+            stringstream message;
+            message << "Can't reach position in line " << (unreachable + 2) << " from input file";
+            return this->fail(message.str());
+        }
+    }
+    return true;
+}
+
+int PoseProgram::size() const
+{
+    return this->angles.size();
+}
+
+const JointVector *PoseProgram::poses() const
+{
+    return this->angles.data();
+}
+
+const double *PoseProgram::grippers() const
+{
+    return this->spacings.data();
+}
+
+const string &PoseProgram::getError() const
+{
+    return this->error;
+}
+
+bool PoseProgram::fail(const string &error)
+{
+    this->angles.clear();
+    this->spacings.clear();
+    this->error = error;
+    return false;
+}
@@ -0,0 +1,111 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef POSEPROGRAM_H
+#define POSEPROGRAM_H
+
+#include <string>
+#include <vector>
+#include "KinematicsSolver.h"
+
+using namespace std;
+
+/**
+ * An object of this class reads a youBot pose file (*.ybposes) without the
+ * GUI. The first line selects the mode: "#ANGLES" for 5 axis values in
+ * radian or "#POSITIONS" for 6 values of the tcp pose per line, each line
+ * optionally followed by the gripper spacing in mm. Positions are solved
+ * at once like in the JointController (see
+ * KinematicsSolver::inverseTransformationSequence).
+ *
+ * @author Stefan Wilkes
+ */
+class PoseProgram
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an empty program.
+     */
+    PoseProgram();
+
+    /**
+     * Reads a pose file. On failure the program is empty and the error
+     * describes the reason.
+     *
+     * @param fileName The pose file
+     * @param solver Solver for the inverse kinematics of a position file
+     * @param start Axis values the arm starts from in radian (0 is centered)
+     * @return true if all poses were read and are reachable
+     */
+    bool load(const string &fileName, const KinematicsSolver &solver, const JointVector &start);
+
+    /**
+     * Returns the number of poses.
+     *
+     * @return the number of poses
+     */
+    int size() const;
+
+    /**
+     * Returns the axis values of all poses.
+     *
+     * @return contiguous array of size() poses in radian (0 is centered)
+     */
+    const JointVector *poses() const;
+
+    /**
+     * Returns the gripper spacings of all poses.
+     *
+     * @return contiguous array of size() spacings in mm (NaN keeps the gripper)
+     */
+    const double *grippers() const;
+
+    /**
+     * Returns the reason why the last file couldn't be read.
+     *
+     * @return the error message (empty after a successful load)
+     */
+    const string &getError() const;
+
+private:
+
+    /**
+     * Empties the program and keeps the error.
+     *
+     * @param error The error message
+     * @return always false
+     */
+    bool fail(const string &error);
+
+    /** Axis values of the poses */
+    vector<JointVector> angles;
+
+    /** Gripper spacing of each pose */
+    vector<double> spacings;
+
+    /** Error message of the last load */
+    string error;
+};
+
+#endif // POSEPROGRAM_H
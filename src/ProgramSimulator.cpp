@@ -0,0 +1,184 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ProgramSimulator.h"
+#include <cmath>
+#include <limits>
+
+ProgramSimulator::ProgramSimulator(int cycleTime) : cycleTime(cycleTime * 1e-6), settledCycles(0), cycle(0)
+{
+}
+
+void ProgramSimulator::setSimulationParameters(const SimulationParameters &parameters)
+{
+    this->parameters = parameters;
+    this->limits = parameters.limits;
+}
+
+void ProgramSimulator::setJointLimits(const MotionLimits &limits)
+{
+    this->limits = limits;
+}
+
+void ProgramSimulator::setArrivalCriteria(const ArrivalCriteria &criteria)
+{
+    this->criteria = criteria;
+}
+
+bool ProgramSimulator::run(const JointVector &start, const JointVector *poses, const double *grippers, int count,
+                           ProgramTiming &timing)
+{
+    timing.total = 0;
+    timing.predicted = 0;
+    timing.segments.clear();
+    timing.dwells.clear();
+    timing.meanDwell = 0;
+    timing.maxDwell = 0;
+    timing.totalDwell = 0;
+    timing.cycles = 0;
+    timing.complete = true;
+
+    /* The joints rest at the start pose and hold it */
+    JointVector desired = start;
+    JointVector setpoint;
+    JointVector target;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        setpoint[i] = start[i] - KUKA_ANGLE_OFFSET[i];
+    }
+    this->joints.reset(setpoint);
+    this->cycle = 0;
+
+    /* The spacing is unknown at the start, so the first gripper command takes the full travel time */
+    double spacing = numeric_limits<double>::quiet_NaN();
+    double gripperEnd = 0;
+
+    for (int n = 0; n < count && timing.complete; n++)
+    {
+        /* Planned like Manipulator::setAxisSynchronized, a motion without distance is a single setpoint */
+        JointVector motion[2] = {desired, poses[n]};
+        double duration = (this->profile.set(motion, 2, this->limits) &&
+                           this->profile.duration() > 0) ? this->profile.duration() : 0;
+        int setpoints = (duration > 0) ? (int) ceil(duration / this->cycleTime) + 1 : 1;
+        bool gripperScheduled = (grippers != NULL) && !std::isnan(grippers[n]);
+
+        for (int i = 0; i < ARMJOINTS; i++)
+        {
+            target[i] = poses[n][i] - KUKA_ANGLE_OFFSET[i];
+        }
+
+        uint64_t startCycle = this->cycle;
+        uint64_t timeoutCycle = startCycle + (uint64_t) ceil((duration + SIMULATION_ARRIVAL_TIMEOUT) / this->cycleTime);
+        bool arrived = false;
+        this->settledCycles = 0;
+
+        for (int index = 0; !arrived && timing.complete; )
+        {
+            /* One setpoint per cycle, only the joints which move are written */
+            if (index < setpoints)
+            {
+                JointVector position = poses[n];
+                if (duration > 0)
+                {
+                    this->profile.sample(index * this->cycleTime, position);
+                }
+
+                bool changed[ARMJOINTS];
+                for (int i = 0; i < ARMJOINTS; i++)
+                {
+                    double angle = position[i] - KUKA_ANGLE_OFFSET[i];
+                    changed[i] = (angle != setpoint[i]);
+                    setpoint[i] = angle;
+                }
+                this->joints.setTarget(setpoint, changed);
+                index++;
+            }
+
+            /* The gripper starts during the final approach, like Manipulator::releaseScheduledGripper */
+            if (gripperScheduled && (setpoints - index) * this->cycleTime <= GRIPPER_LEAD_TIME)
+            {
+                double spacingTarget = min(max(round(grippers[n]) / 1000., GRIPPER_LIMIT[0]), GRIPPER_LIMIT[1]);
+                double distance = std::isnan(spacing) ? GRIPPER_LIMIT[1] - GRIPPER_LIMIT[0] : fabs(spacingTarget - spacing);
+                gripperEnd = this->cycle * this->cycleTime + distance / GRIPPER_VELOCITY;
+                spacing = spacingTarget;
+                gripperScheduled = false;
+            }
+
+            /* A trajectory arrives after its last setpoint was sent */
+            bool settled = this->stepCycle(target);
+            arrived = settled && index >= setpoints;
+            timing.complete = arrived || this->cycle < timeoutCycle;
+        }
+
+        if (!arrived)
+        {
+            break;
+        }
+
+        double arrival = this->cycle * this->cycleTime;
+        timing.segments.push_back((this->cycle - startCycle) * this->cycleTime);
+        timing.predicted += duration;
+        desired = poses[n];
+
+        /* The arm holds the pose until the gripper stopped, the next command is sent one cycle later */
+        while (this->cycle * this->cycleTime < gripperEnd)
+        {
+            this->stepCycle(target);
+        }
+        if (n < count - 1)
+        {
+            this->stepCycle(target);
+        }
+        timing.dwells.push_back(this->cycle * this->cycleTime - arrival);
+    }
+
+    for (size_t n = 0; n < timing.dwells.size(); n++)
+    {
+        timing.totalDwell += timing.dwells[n];
+        timing.maxDwell = max(timing.maxDwell, timing.dwells[n]);
+    }
+    timing.meanDwell = timing.dwells.empty() ? 0 : timing.totalDwell / timing.dwells.size();
+    timing.total = this->cycle * this->cycleTime;
+    timing.cycles = this->cycle;
+
+    return timing.complete;
+}
+
+bool ProgramSimulator::stepCycle(const JointVector &target)
+{
+    this->joints.step(this->parameters, this->cycleTime);
+    this->cycle++;
+
+    const JointVector &position = this->joints.getPosition();
+    const JointVector &velocity = this->joints.getVelocity();
+    bool settled = true;
+
+    for (int i = 0; i < ARMJOINTS && settled; i++)
+    {
+        settled = (fabs(position[i] - target[i]) <= this->criteria.positionTolerance[i]) &&
+                  (fabs(velocity[i]) <= this->criteria.velocityTolerance[i]);
+    }
+    this->settledCycles = settled ? this->settledCycles + 1 : 0;
+
+    return this->settledCycles * this->cycleTime >= this->criteria.settleTime;
+}
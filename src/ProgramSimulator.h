@@ -0,0 +1,163 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PROGRAMSIMULATOR_H
+#define PROGRAMSIMULATOR_H
+
+#include <stdint.h>
+#include <vector>
+#include "JointSimulation.h"
+#include "Manipulator.h"
+
+using namespace std;
+
+/**
+ * Result of a simulated pose program. All times are in seconds of the
+ * virtual clock.
+ */
+struct ProgramTiming
+{
+    /** Time from the start of the first motion until the last pose was reached and the gripper stopped */
+    double total;
+
+    /** Sum of the planned trajectory durations (like Manipulator::predictCycleTime) */
+    double predicted;
+
+    /** Time of each motion from its first setpoint until the arrival */
+    vector<double> segments;
+
+    /** Time the arm stands at each pose until the next motion starts (the program ends for the last pose) */
+    vector<double> dwells;
+
+    /** Statistics of the dwell times */
+    double meanDwell;
+    double maxDwell;
+    double totalDwell;
+
+    /** Number of simulated control cycles */
+    uint64_t cycles;
+
+    /** true if every pose was reached */
+    bool complete;
+};
+
+/**
+ * An object of this class runs a pose program like the automatic mode of
+ * the JointController on a virtual clock, so a program of half an hour is
+ * simulated within seconds.
+ *
+ * Each motion is planned like Manipulator::setAxisSynchronized, one setpoint
+ * per cycle is sent to the simulated joints (see JointSimulation) and the
+ * arrival is detected with the same criteria as the control thread. The
+ * gripper starts GRIPPER_LEAD_TIME before the end of the trajectory and needs
+ * the same travel time as in the gripper thread. The next motion starts one
+ * cycle after the arm arrived and the gripper stopped. There are no threads
+ * and no sleeps, every run of the same program gives the same result.
+ *
+ * @author Stefan Wilkes
+ */
+class ProgramSimulator
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates a simulator with the default joints and arrival criteria.
+     *
+     * @param cycleTime Cycle time of the simulated control thread in microseconds
+     */
+    ProgramSimulator(int cycleTime = DEFAULT_CYCLE_TIME_US);
+
+    /**
+     * Sets the parameters of the simulated joints. The motions are planned
+     * with the joint limits of the parameters.
+     *
+     * @param parameters The parameters
+     */
+    void setSimulationParameters(const SimulationParameters &parameters);
+
+    /**
+     * Sets the limits the motions are planned with, e.g. the limits of the
+     * config file for joints which are slower or faster than configured.
+     * Must be called after setSimulationParameters.
+     *
+     * @param limits Limits of the joints (all values must be positive)
+     */
+    void setJointLimits(const MotionLimits &limits);
+
+    /**
+     * Sets the conditions under which a motion is complete.
+     *
+     * @param criteria The tolerances and the settle time
+     */
+    void setArrivalCriteria(const ArrivalCriteria &criteria);
+
+    /**
+     * Runs a pose program. The arm rests at the start pose and drives to all
+     * poses in the given order.
+     *
+     * @param start Axis values the arm starts from in radian (0 is centered)
+     * @param poses Axis values of the poses in radian (0 is centered)
+     * @param grippers Gripper spacing of each pose in mm (NaN keeps the gripper) or NULL
+     * @param count Number of poses
+     * @param timing Receives the times of the program
+     * @return true if every pose was reached
+     */
+    bool run(const JointVector &start, const JointVector *poses, const double *grippers, int count,
+             ProgramTiming &timing);
+
+private:
+
+    /**
+     * Advances the joints by one cycle and checks the arrival criteria.
+     *
+     * @param target Kuka angles of the motion target
+     * @return true if the arm stayed within the tolerances for the settle time
+     */
+    bool stepCycle(const JointVector &target);
+
+    /** Cycle time of the simulated control thread in seconds */
+    double cycleTime;
+
+    /** The simulated joints */
+    JointSimulation joints;
+
+    /** Parameters of the simulated joints */
+    SimulationParameters parameters;
+
+    /** Arrival criteria of the motions */
+    ArrivalCriteria criteria;
+
+    /** Limits the motions are planned with */
+    MotionLimits limits;
+
+    /** Planner of the motions */
+    MotionProfile profile;
+
+    /** Number of cycles the arm stayed within the arrival tolerances */
+    int settledCycles;
+
+    /** Number of simulated cycles */
+    uint64_t cycle;
+};
+
+#endif // PROGRAMSIMULATOR_H
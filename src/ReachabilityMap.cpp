@@ -0,0 +1,299 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ReachabilityMap.h"
+#include "ybparams.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Number of configurations which are transformed at once while sampling */
+static const int SAMPLE_CHUNK_SIZE = 4096;
+
+/**
+ * Checks if an angle of joint 1 is inside the datasheet limits.
+ */
+static inline bool validBaseAngle(double angle)
+{
+    return (angle >= BOTTOM_LIMIT_SD[0]) && (angle <= TOP_LIMIT_SD[0]);
+}
+
+ReachabilityMap::ReachabilityMap()
+{
+    this->mapping = NULL;
+    this->mappingSize = 0;
+    this->header = NULL;
+    this->voxels = NULL;
+}
+
+ReachabilityMap::~ReachabilityMap()
+{
+    this->close();
+}
+
+bool ReachabilityMap::generate(const string &fileName, const KinematicsSolver &solver, double resolution)
+{
+    const DHParameters &parameters = solver.getDHParameters();
+    double reach = fabs(parameters.r[0]) + fabs(parameters.r[1]) + fabs(parameters.r[2]) + fabs(parameters.d[4]);
+
+    /* The planar map covers the arm plane in front of (rho > 0) and behind the base */
+    int planarCells[2];
+    double planarOrigin[2] = {-reach - resolution, parameters.d[0] - reach - resolution};
+    planarCells[0] = (int) ceil(2. * (reach + resolution) / resolution);
+    planarCells[1] = planarCells[0];
+    /* Cells of the planar map (signed radial distance and height) which the TCP reaches */
+    vector<bool> planar(planarCells[0] * planarCells[1], false);
+
+    /* Sample joints 2 - 4, the TCP moves at most half a voxel per step */
+    double step = resolution / (2. * reach);
+    vector<double> samples(ARMJOINTS * SAMPLE_CHUNK_SIZE, 0.);
+    vector<double> poses(6 * SAMPLE_CHUNK_SIZE);
+    const double *angleArrays[ARMJOINTS];
+    double *poseArrays[6];
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        angleArrays[i] = &samples[i * SAMPLE_CHUNK_SIZE];
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        poseArrays[i] = &poses[i * SAMPLE_CHUNK_SIZE];
+    }
+
+    int count = 0;
+    double *q2 = &samples[1 * SAMPLE_CHUNK_SIZE];
+    double *q3 = &samples[2 * SAMPLE_CHUNK_SIZE];
+    double *q4 = &samples[3 * SAMPLE_CHUNK_SIZE];
+
+    /* Transforms the collected samples and enters them into the planar map */
+    auto transformSamples = [&]()
+    {
+        solver.forwardTransformation(angleArrays, count, poseArrays);
+
+        for (int n = 0; n < count; n++)
+        {
+            /* Joint 1 is zero, so x is the signed radial distance */
+            double rho = (poseArrays[0][n] - planarOrigin[0]) / resolution;
+            double z = (poseArrays[2][n] - planarOrigin[1]) / resolution;
+            int i = (int) rho;
+            int j = (int) z;
+
+            if (i >= 0 && j >= 0 && i < planarCells[0] && j < planarCells[1])
+            {
+                planar[j * planarCells[0] + i] = true;
+            }
+        }
+        count = 0;
+    };
+
+    for (double a2 = BOTTOM_LIMIT_SD[1]; a2 <= TOP_LIMIT_SD[1]; a2 += step)
+    {
+        for (double a3 = BOTTOM_LIMIT_SD[2]; a3 <= TOP_LIMIT_SD[2]; a3 += step)
+        {
+            for (double a4 = BOTTOM_LIMIT_SD[3]; a4 <= TOP_LIMIT_SD[3]; a4 += step)
+            {
+                q2[count] = a2;
+                q3[count] = a3;
+                q4[count] = a4;
+
+                if (++count == SAMPLE_CHUNK_SIZE)
+                {
+                    transformSamples();
+                }
+            }
+        }
+    }
+    transformSamples();
+
+    /* Fill the voxels from the planar map turned by joint 1 */
+    ReachabilityMapHeader header;
+    memcpy(header.magic, "YBRM", 4);
+    header.version = REACHABILITY_MAP_VERSION;
+    header.cells[0] = planarCells[0];
+    header.cells[1] = planarCells[0];
+    header.cells[2] = planarCells[1];
+    header.voxelSize = sizeof(ReachabilityVoxel);
+    header.origin[0] = planarOrigin[0];
+    header.origin[1] = planarOrigin[0];
+    header.origin[2] = planarOrigin[1];
+    header.resolution = resolution;
+    header.parameterHash = solver.getParameterHash();
+
+    vector<ReachabilityVoxel> voxels(header.cells[0] * header.cells[1] * header.cells[2]);
+    double half = 0.5 * resolution;
+
+    for (uint32_t k = 0; k < header.cells[2]; k++)
+    {
+        for (uint32_t j = 0; j < header.cells[1]; j++)
+        {
+            for (uint32_t i = 0; i < header.cells[0]; i++)
+            {
+                ReachabilityVoxel &voxel = voxels[(k * header.cells[1] + j) * header.cells[0] + i];
+                double x = header.origin[0] + (i + 0.5) * resolution;
+                double y = header.origin[1] + (j + 0.5) * resolution;
+                double rho = hypot(x, y);
+
+                /* Joint 1 can turn to the voxel if one of its corners is inside the limits */
+                bool front = false;
+                bool back = false;
+                for (int corner = 0; corner < 4; corner++)
+                {
+                    double angle = atan2(y + ((corner & 2) ? half : -half), x + ((corner & 1) ? half : -half));
+                    front = front || validBaseAngle(angle);
+                    back = back || validBaseAngle(atan2(sin(angle + M_PI), cos(angle + M_PI)));
+                }
+
+                /* Search the planar cell and its neighbours for a reachable sample */
+                bool reachable = false;
+
+                for (int side = 0; side < 2 && !reachable; side++)
+                {
+                    bool validSide = (side == 0) ? front : back;
+                    double sideRho = (side == 0) ? rho : -rho;
+                    int pi = (int) ((sideRho - planarOrigin[0]) / resolution);
+
+                    for (int dj = -1; dj <= 1 && validSide && !reachable; dj++)
+                    {
+                        for (int di = -1; di <= 1 && !reachable; di++)
+                        {
+                            int ci = pi + di;
+                            int cj = (int) k + dj;
+
+                            reachable = (ci >= 0 && cj >= 0 && ci < planarCells[0] && cj < planarCells[1] &&
+                                         planar[cj * planarCells[0] + ci]);
+                        }
+                    }
+                }
+                voxel.reachable = reachable ? 1 : 0;
+            }
+        }
+    }
+
+    /* Write the file */
+    FILE *file = fopen(fileName.c_str(), "wb");
+    bool written = (file != NULL);
+
+    if (written)
+    {
+        written = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+                  (fwrite(&voxels[0], sizeof(ReachabilityVoxel), voxels.size(), file) == voxels.size());
+        written = (fclose(file) == 0) && written;
+    }
+    return written;
+}
+
+bool ReachabilityMap::open(const string &fileName, const KinematicsSolver &solver)
+{
+    this->close();
+
+    int file = ::open(fileName.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    bool valid = (fstat(file, &status) == 0) && (status.st_size >= (off_t) sizeof(ReachabilityMapHeader));
+
+    if (valid)
+    {
+        this->mappingSize = status.st_size;
+        this->mapping = mmap(NULL, this->mappingSize, PROT_READ, MAP_SHARED, file, 0);
+        valid = (this->mapping != MAP_FAILED);
+        this->mapping = valid ? this->mapping : NULL;
+    }
+    ::close(file);
+
+    if (valid)
+    {
+        /* Check the file against the current format and the parameters of the solver */
+        this->header = static_cast<const ReachabilityMapHeader *>(this->mapping);
+        size_t voxelCount = (size_t) this->header->cells[0] * this->header->cells[1] * this->header->cells[2];
+
+        valid = (memcmp(this->header->magic, "YBRM", 4) == 0) &&
+                (this->header->version == REACHABILITY_MAP_VERSION) &&
+                (this->header->voxelSize == sizeof(ReachabilityVoxel)) &&
+                (this->header->parameterHash == solver.getParameterHash()) &&
+                (this->mappingSize == sizeof(ReachabilityMapHeader) + voxelCount * sizeof(ReachabilityVoxel));
+
+        this->voxels = reinterpret_cast<const ReachabilityVoxel *>(this->header + 1);
+    }
+
+    if (!valid)
+    {
+        this->close();
+    }
+    return valid;
+}
+
+void ReachabilityMap::close()
+{
+    if (this->mapping != NULL)
+    {
+        munmap(this->mapping, this->mappingSize);
+    }
+    this->mapping = NULL;
+    this->mappingSize = 0;
+    this->header = NULL;
+    this->voxels = NULL;
+}
+
+bool ReachabilityMap::isOpen() const
+{
+    return this->mapping != NULL;
+}
+
+bool ReachabilityMap::matches(const KinematicsSolver &solver) const
+{
+    return (this->header != NULL) && (this->header->parameterHash == solver.getParameterHash());
+}
+
+bool ReachabilityMap::isReachable(const PoseVector &tcp) const
+{
+    const ReachabilityVoxel *voxel = this->voxel(tcp);
+    return (voxel != NULL) && voxel->reachable;
+}
+
+const ReachabilityVoxel *ReachabilityMap::voxel(const PoseVector &tcp) const
+{
+    if (this->header == NULL)
+    {
+        return NULL;
+    }
+
+    int index[3];
+    for (int i = 0; i < 3; i++)
+    {
+        double cell = floor((tcp[i] - this->header->origin[i]) / this->header->resolution);
+
+        if (!(cell >= 0 && cell < this->header->cells[i]))
+        {
+            return NULL;
+        }
+        index[i] = (int) cell;
+    }
+    return &this->voxels[(index[2] * this->header->cells[1] + index[1]) * this->header->cells[0] + index[0]];
+}
@@ -0,0 +1,178 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef REACHABILITYMAP_H
+#define REACHABILITYMAP_H
+
+#include <stdint.h>
+#include <string>
+#include "KinematicsSolver.h"
+
+using namespace std;
+
+/** Version of the binary file format, increment on every layout change */
+#define REACHABILITY_MAP_VERSION 3
+
+/**
+ * File header of a reachability map. The voxels follow directly.
+ */
+struct ReachabilityMapHeader
+{
+    /** Always "YBRM" */
+    char magic[4];
+
+    /** Format version (REACHABILITY_MAP_VERSION) */
+    uint32_t version;
+
+    /** Number of voxels in x, y and z direction */
+    uint32_t cells[3];
+
+    /** Size of one voxel in bytes */
+    uint32_t voxelSize;
+
+    /** Position of the lower corner of the first voxel in meter */
+    double origin[3];
+
+    /** Edge length of a voxel in meter */
+    double resolution;
+
+    /** Hash of the DH parameters and joint limits the map was created with (see KinematicsSolver::getParameterHash) */
+    uint64_t parameterHash;
+};
+
+/**
+ * One voxel of a reachability map.
+ */
+struct ReachabilityVoxel
+{
+    /** 1 if the TCP can reach the voxel with any orientation */
+    uint32_t reachable;
+};
+
+/**
+ * An object of this class provides a precomputed map of the workspace of
+ * the arm. Each voxel stores if the TCP can reach it, so impossible targets
+ * are rejected before the inverse kinematics.
+ *
+ * The map is generated once from the DH parameters of a kinematics solver
+ * and the joint limits and stored in a versioned binary file. At startup
+ * the file is memory mapped, so a lookup is a single array access. The
+ * file keeps a hash of the parameters, so a map is only used with a solver
+ * of the same parameters.
+ *
+ * The map is conservative: a voxel is marked reachable if the arm reaches
+ * the voxel or one of its neighbours. An unreachable voxel can't be
+ * reached for sure.
+ *
+ * @author Stefan Wilkes
+ */
+class ReachabilityMap
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an empty map, use open() to load a map file.
+     */
+    ReachabilityMap();
+
+    /**
+     * Destructor:
+     * Unmaps the map file.
+     */
+    ~ReachabilityMap();
+
+    /**
+     * Samples the workspace and writes a new map file.
+     *
+     * @param fileName The file to write
+     * @param solver The solver whose DH parameters are used
+     * @param resolution Edge length of a voxel in meter
+     * @return true if the file was written successfully
+     */
+    static bool generate(const string &fileName, const KinematicsSolver &solver, double resolution = 0.02);
+
+    /**
+     * Maps a map file into memory. The file is rejected if the version or
+     * the parameters of the solver don't match.
+     *
+     * @param fileName The file to open
+     * @param solver The solver the map is used with
+     * @return true if the map is valid and can be used
+     */
+    bool open(const string &fileName, const KinematicsSolver &solver);
+
+    /**
+     * Checks if the map was created with the parameters of a solver.
+     *
+     * @param solver The solver
+     * @return true if a map is loaded and the parameters are the same
+     */
+    bool matches(const KinematicsSolver &solver) const;
+
+    /**
+     * Unmaps a previously opened file.
+     */
+    void close();
+
+    /**
+     * Checks if a map is loaded.
+     *
+     * @return true if a map is loaded
+     */
+    bool isOpen() const;
+
+    /**
+     * Checks if the position of a TCP can be reached. Positions outside
+     * the map are never reachable.
+     *
+     * @param tcp The desired pose (X, Y, Z, Roll, Pitch, Yaw)
+     * @return true if the position is (probably) reachable
+     */
+    bool isReachable(const PoseVector &tcp) const;
+
+private:
+
+    ReachabilityMap(const ReachabilityMap &);
+    ReachabilityMap &operator=(const ReachabilityMap &);
+
+    /**
+     * Returns the voxel which contains the given position.
+     *
+     * @return the voxel or NULL if the position is outside the map
+     */
+    const ReachabilityVoxel *voxel(const PoseVector &tcp) const;
+
+    /** Start of the mapped file */
+    void *mapping;
+
+    /** Size of the mapped file in bytes */
+    size_t mappingSize;
+
+    /** Header inside the mapped file */
+    const ReachabilityMapHeader *header;
+
+    /** Voxels inside the mapped file */
+    const ReachabilityVoxel *voxels;
+};
+
+#endif // REACHABILITYMAP_H
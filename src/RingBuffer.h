@@ -0,0 +1,168 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "SeqLock.h"
+
+/**
+ * An object of this class keeps the latest values of one writer, e.g. one
+ * sample per control cycle. Older values are overwritten.
+ *
+ * The memory is allocated once, afterwards neither the writer nor the
+ * readers allocate memory or lock. Any number of readers can copy the
+ * history while the writer continues, each value is copied consistently
+ * (see SeqLock) and values which were overwritten during the copy are
+ * dropped.
+ *
+ * @author Stefan Wilkes
+ */
+template<class T>
+class RingBuffer
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates a buffer without capacity.
+     */
+    RingBuffer() : slots(NULL), slotCount(0), written(0), claimed(0)
+    {
+    }
+
+    /**
+     * Destructor:
+     * Releases the memory.
+     */
+    ~RingBuffer()
+    {
+        delete[] this->slots;
+    }
+
+    /**
+     * Allocates the memory and clears the buffer. Must not be called while
+     * the buffer is used by other threads.
+     *
+     * @param capacity Number of values to keep
+     */
+    void allocate(size_t capacity)
+    {
+        delete[] this->slots;
+        this->slots = (capacity > 0) ? new SeqLock<T>[capacity] : NULL;
+        this->slotCount = capacity;
+        this->written.store(0, std::memory_order_release);
+        this->claimed.store(0, std::memory_order_release);
+    }
+
+    /**
+     * Appends a value and overwrites the oldest one if the buffer is full.
+     * Must only be called by one thread.
+     *
+     * @param value The value
+     */
+    void push(const T &value)
+    {
+        uint64_t position = this->written.load(std::memory_order_relaxed);
+
+        if (this->slotCount > 0)
+        {
+            this->claimed.store(position + 1, std::memory_order_relaxed);
+            this->slots[position % this->slotCount].store(value);
+            this->written.store(position + 1, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Copies the latest values in the order they were written.
+     *
+     * @param values Array which receives the values
+     * @param maximum Maximum number of values to copy
+     * @return the number of copied values
+     */
+    size_t read(T *values, size_t maximum) const
+    {
+        uint64_t end = this->written.load(std::memory_order_acquire);
+        uint64_t count = std::min<uint64_t>(std::min<uint64_t>(maximum, this->slotCount), end);
+        uint64_t first = end - count;
+
+        for (uint64_t n = first; n < end; n++)
+        {
+            this->slots[n % this->slotCount].load(values[n - first]);
+        }
+
+        /* Slots which the writer reached meanwhile may hold newer values */
+        uint64_t overwritten = this->claimed.load(std::memory_order_acquire);
+        uint64_t valid = (overwritten > this->slotCount) ? overwritten - this->slotCount : 0;
+
+        if (valid > first)
+        {
+            uint64_t dropped = std::min(valid - first, count);
+            for (uint64_t n = dropped; n < count; n++)
+            {
+                values[n - dropped] = values[n];
+            }
+            count -= dropped;
+        }
+        return count;
+    }
+
+    /**
+     * Returns the number of values the buffer can keep.
+     *
+     * @return the capacity
+     */
+    size_t capacity() const
+    {
+        return this->slotCount;
+    }
+
+    /**
+     * Returns the number of values written so far.
+     *
+     * @return the number of push() calls since the allocation
+     */
+    uint64_t total() const
+    {
+        return this->written.load(std::memory_order_acquire);
+    }
+
+private:
+
+    /** The values */
+    SeqLock<T> *slots;
+
+    /** Number of slots */
+    size_t slotCount;
+
+    /** Number of written values */
+    std::atomic<uint64_t> written;
+
+    /** Number of values whose writing started */
+    std::atomic<uint64_t> claimed;
+};
+
+#endif // RINGBUFFER_H
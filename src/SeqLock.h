@@ -0,0 +1,129 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+
+/**
+ * An object of this class shares a value of one writer with any number of
+ * readers without locking (sequence lock).
+ *
+ * The writer never waits. A reader copies the value and retries if the
+ * writer changed it meanwhile, so readers always get a consistent value.
+ * The value is copied bytewise into atomic words, thus the type must be
+ * plain data without pointers to itself (e.g. fixed size Eigen types).
+ *
+ * @author Stefan Wilkes
+ */
+template<class T>
+class SeqLock
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates a lock which holds a zero initialized value.
+     */
+    SeqLock() : sequence(0)
+    {
+        for (int i = 0; i < WORDS; i++)
+        {
+            this->words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Publishes a new value. Must only be called by one thread.
+     *
+     * @param value The new value
+     */
+    void store(const T &value)
+    {
+        uint64_t buffer[WORDS] = {0};
+        memcpy(buffer, &value, sizeof(T));
+
+        /* An odd sequence marks a running write */
+        uint32_t start = this->sequence.load(std::memory_order_relaxed);
+        this->sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int i = 0; i < WORDS; i++)
+        {
+            this->words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        this->sequence.store(start + 2, std::memory_order_release);
+    }
+
+    /**
+     * Reads the latest consistent value.
+     *
+     * @param value Receives the value
+     */
+    void load(T &value) const
+    {
+        uint64_t buffer[WORDS];
+        uint32_t before;
+        uint32_t after;
+
+        do
+        {
+            before = this->sequence.load(std::memory_order_acquire);
+
+            for (int i = 0; i < WORDS; i++)
+            {
+                buffer[i] = this->words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = this->sequence.load(std::memory_order_relaxed);
+        }
+        while ((before & 1) != 0 || before != after);
+
+        memcpy(static_cast<void *>(&value), buffer, sizeof(T));
+    }
+
+    /**
+     * Returns the number of values stored so far.
+     *
+     * @return the number of store() calls
+     */
+    uint32_t version() const
+    {
+        return this->sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+
+    /** Number of 64 bit words of the value */
+    static const int WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    /** Write counter (odd while a write is running) */
+    std::atomic<uint32_t> sequence;
+
+    /** The value */
+    std::atomic<uint64_t> words[WORDS];
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,256 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SIMDMATH_H
+#define SIMDMATH_H
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Vectorized math functions for structure of arrays kernels like the
+ * batch forward kinematics.
+ *
+ * Each operation set (ScalarOps, Sse2Ops, AvxOps) wraps one register type
+ * with the same static interface, so the kernels are written once as
+ * templates. SimdOps selects the widest set which is enabled by the compiler
+ * flags, the scalar set processes the remaining elements.
+ *
+ * Sine, cosine and arc tangent use the polynomial approximations of the
+ * Cephes library and are accurate to about 1e-15 for the angle ranges
+ * of the arm.
+ *
+ * @author Stefan Wilkes
+ */
+namespace simd
+{
+
+/** Operations on single doubles (fallback and remainder loops) */
+struct ScalarOps
+{
+    typedef double Type;
+    typedef bool Mask;
+    enum { WIDTH = 1 };
+
+    static inline Type load(const double *p) { return *p; }
+    static inline void store(double *p, Type a) { *p = a; }
+    static inline Type set(double a) { return a; }
+    static inline Type add(Type a, Type b) { return a + b; }
+    static inline Type sub(Type a, Type b) { return a - b; }
+    static inline Type mul(Type a, Type b) { return a * b; }
+    static inline Type div(Type a, Type b) { return a / b; }
+    static inline Type madd(Type a, Type b, Type c) { return a * b + c; }
+    static inline Type sqrt(Type a) { return std::sqrt(a); }
+    static inline Type abs(Type a) { return std::fabs(a); }
+    static inline Type min(Type a, Type b) { return (a < b) ? a : b; }
+    static inline Type max(Type a, Type b) { return (a > b) ? a : b; }
+    static inline Type truncate(Type a) { return (double) (long long) a; }
+    static inline Mask greater(Type a, Type b) { return a > b; }
+    static inline Mask equal(Type a, Type b) { return a == b; }
+    static inline Mask maskOr(Mask a, Mask b) { return a || b; }
+    static inline Type select(Mask m, Type a, Type b) { return m ? a : b; }
+    static inline Type negateIf(Mask m, Type a) { return m ? -a : a; }
+    static inline Type mulSign(Type a, Type sign) { return std::signbit(sign) ? -a : a; }
+};
+
+#if defined(__SSE2__)
+/** Operations on two doubles with SSE2 */
+struct Sse2Ops
+{
+    typedef __m128d Type;
+    typedef __m128d Mask;
+    enum { WIDTH = 2 };
+
+    static inline Type load(const double *p) { return _mm_loadu_pd(p); }
+    static inline void store(double *p, Type a) { _mm_storeu_pd(p, a); }
+    static inline Type set(double a) { return _mm_set1_pd(a); }
+    static inline Type add(Type a, Type b) { return _mm_add_pd(a, b); }
+    static inline Type sub(Type a, Type b) { return _mm_sub_pd(a, b); }
+    static inline Type mul(Type a, Type b) { return _mm_mul_pd(a, b); }
+    static inline Type div(Type a, Type b) { return _mm_div_pd(a, b); }
+    static inline Type madd(Type a, Type b, Type c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static inline Type sqrt(Type a) { return _mm_sqrt_pd(a); }
+    static inline Type abs(Type a) { return _mm_andnot_pd(_mm_set1_pd(-0.), a); }
+    static inline Type min(Type a, Type b) { return _mm_min_pd(a, b); }
+    static inline Type max(Type a, Type b) { return _mm_max_pd(a, b); }
+    static inline Type truncate(Type a)
+    {
+        /* Only used for the quadrant of (small) angles, which fit into 32 bit */
+        return _mm_cvtepi32_pd(_mm_cvttpd_epi32(a));
+    }
+    static inline Mask greater(Type a, Type b) { return _mm_cmpgt_pd(a, b); }
+    static inline Mask equal(Type a, Type b) { return _mm_cmpeq_pd(a, b); }
+    static inline Mask maskOr(Mask a, Mask b) { return _mm_or_pd(a, b); }
+    static inline Type select(Mask m, Type a, Type b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+    static inline Type negateIf(Mask m, Type a) { return _mm_xor_pd(a, _mm_and_pd(m, _mm_set1_pd(-0.))); }
+    static inline Type mulSign(Type a, Type sign) { return _mm_xor_pd(a, _mm_and_pd(_mm_set1_pd(-0.), sign)); }
+};
+#endif
+
+#if defined(__AVX__)
+/** Operations on four doubles with AVX (and FMA if available) */
+struct AvxOps
+{
+    typedef __m256d Type;
+    typedef __m256d Mask;
+    enum { WIDTH = 4 };
+
+    static inline Type load(const double *p) { return _mm256_loadu_pd(p); }
+    static inline void store(double *p, Type a) { _mm256_storeu_pd(p, a); }
+    static inline Type set(double a) { return _mm256_set1_pd(a); }
+    static inline Type add(Type a, Type b) { return _mm256_add_pd(a, b); }
+    static inline Type sub(Type a, Type b) { return _mm256_sub_pd(a, b); }
+    static inline Type mul(Type a, Type b) { return _mm256_mul_pd(a, b); }
+    static inline Type div(Type a, Type b) { return _mm256_div_pd(a, b); }
+#if defined(__FMA__)
+    static inline Type madd(Type a, Type b, Type c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+    static inline Type madd(Type a, Type b, Type c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+    static inline Type sqrt(Type a) { return _mm256_sqrt_pd(a); }
+    static inline Type abs(Type a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.), a); }
+    static inline Type min(Type a, Type b) { return _mm256_min_pd(a, b); }
+    static inline Type max(Type a, Type b) { return _mm256_max_pd(a, b); }
+    static inline Type truncate(Type a) { return _mm256_round_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+    static inline Mask greater(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static inline Mask equal(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static inline Mask maskOr(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+    static inline Type select(Mask m, Type a, Type b) { return _mm256_blendv_pd(b, a, m); }
+    static inline Type negateIf(Mask m, Type a) { return _mm256_xor_pd(a, _mm256_and_pd(m, _mm256_set1_pd(-0.))); }
+    static inline Type mulSign(Type a, Type sign) { return _mm256_xor_pd(a, _mm256_and_pd(_mm256_set1_pd(-0.), sign)); }
+};
+#endif
+
+/** The widest operation set enabled by the compiler flags */
+#if defined(__AVX__)
+typedef AvxOps SimdOps;
+#elif defined(__SSE2__)
+typedef Sse2Ops SimdOps;
+#else
+typedef ScalarOps SimdOps;
+#endif
+
+/**
+ * Calculates sine and cosine of all elements at once.
+ *
+ * @param x The angles in radian
+ * @param s Receives the sine values
+ * @param c Receives the cosine values
+ */
+template <class Ops>
+inline void sincos(typename Ops::Type x, typename Ops::Type &s, typename Ops::Type &c)
+{
+    typedef typename Ops::Type V;
+
+    /* Reduce to z in [-PI/4, PI/4] with x = j * PI/4 + z and even j */
+    V ax = Ops::abs(x);
+    V j = Ops::truncate(Ops::mul(ax, Ops::set(4. / M_PI)));
+    j = Ops::add(j, Ops::sub(j, Ops::mul(Ops::set(2.), Ops::truncate(Ops::mul(j, Ops::set(0.5))))));
+    V z = Ops::sub(ax, Ops::mul(j, Ops::set(7.85398125648498535156E-1)));
+    z = Ops::sub(z, Ops::mul(j, Ops::set(3.77489470793079817668E-8)));
+    z = Ops::sub(z, Ops::mul(j, Ops::set(2.69515142907905952645E-15)));
+    V zz = Ops::mul(z, z);
+
+    /* Polynomials for sine and cosine of z */
+    V ps = Ops::set(1.58962301576546568060E-10);
+    ps = Ops::madd(ps, zz, Ops::set(-2.50507477628578072866E-8));
+    ps = Ops::madd(ps, zz, Ops::set(2.75573136213857245213E-6));
+    ps = Ops::madd(ps, zz, Ops::set(-1.98412698295895385996E-4));
+    ps = Ops::madd(ps, zz, Ops::set(8.33333333332211858878E-3));
+    ps = Ops::madd(ps, zz, Ops::set(-1.66666666666666307295E-1));
+    V sinZ = Ops::madd(Ops::mul(ps, zz), z, z);
+
+    V pc = Ops::set(-1.13585365213876817300E-11);
+    pc = Ops::madd(pc, zz, Ops::set(2.08757008419747316778E-9));
+    pc = Ops::madd(pc, zz, Ops::set(-2.75573141792967388112E-7));
+    pc = Ops::madd(pc, zz, Ops::set(2.48015872888517045348E-5));
+    pc = Ops::madd(pc, zz, Ops::set(-1.38888888888730564116E-3));
+    pc = Ops::madd(pc, zz, Ops::set(4.16666666666665929218E-2));
+    V cosZ = Ops::add(Ops::sub(Ops::set(1.), Ops::mul(Ops::set(0.5), zz)), Ops::mul(Ops::mul(zz, zz), pc));
+
+    /* Octant (0, 2, 4 or 6) decides about swapping and signs */
+    V octant = Ops::sub(j, Ops::mul(Ops::set(8.), Ops::truncate(Ops::mul(j, Ops::set(0.125)))));
+    typename Ops::Mask is2 = Ops::equal(octant, Ops::set(2.));
+    typename Ops::Mask is4 = Ops::equal(octant, Ops::set(4.));
+    typename Ops::Mask is6 = Ops::equal(octant, Ops::set(6.));
+    typename Ops::Mask swap = Ops::maskOr(is2, is6);
+
+    V sinX = Ops::select(swap, cosZ, sinZ);
+    V cosX = Ops::select(swap, sinZ, cosZ);
+    sinX = Ops::negateIf(Ops::maskOr(is4, is6), sinX);
+    cosX = Ops::negateIf(Ops::maskOr(is2, is4), cosX);
+
+    s = Ops::mulSign(sinX, x);
+    c = cosX;
+}
+
+/**
+ * Calculates the arc tangent of y / x for all elements in the range [-PI, PI].
+ *
+ * @param y The y values
+ * @param x The x values
+ * @return the angles in radian
+ */
+template <class Ops>
+inline typename Ops::Type atan2(typename Ops::Type y, typename Ops::Type x)
+{
+    typedef typename Ops::Type V;
+
+    /* Reduce to t = min / max in [0, 1] */
+    V ay = Ops::abs(y);
+    V ax = Ops::abs(x);
+    V num = Ops::min(ax, ay);
+    V den = Ops::max(ax, ay);
+    V t = Ops::div(num, Ops::max(den, Ops::set(1e-300)));
+
+    /* Reduce further for t > 0.66: atan(t) = PI/4 + atan((t - 1) / (t + 1)) */
+    typename Ops::Mask large = Ops::greater(t, Ops::set(0.66));
+    V u = Ops::select(large, Ops::div(Ops::sub(t, Ops::set(1.)), Ops::add(t, Ops::set(1.))), t);
+    V offset = Ops::select(large, Ops::set(M_PI_4), Ops::set(0.));
+
+    V z = Ops::mul(u, u);
+    V p = Ops::set(-8.750608600031904122785E-1);
+    p = Ops::madd(p, z, Ops::set(-1.615753718733365076637E1));
+    p = Ops::madd(p, z, Ops::set(-7.500855792314704667340E1));
+    p = Ops::madd(p, z, Ops::set(-1.228866684490136173410E2));
+    p = Ops::madd(p, z, Ops::set(-6.485021904942025371773E1));
+    V q = Ops::add(z, Ops::set(2.485846490142306297962E1));
+    q = Ops::madd(q, z, Ops::set(1.650270098316988542046E2));
+    q = Ops::madd(q, z, Ops::set(4.328810604912902668951E2));
+    q = Ops::madd(q, z, Ops::set(4.853903996359136964868E2));
+    q = Ops::madd(q, z, Ops::set(1.945506571482613964425E2));
+    V angle = Ops::add(offset, Ops::madd(u, Ops::div(Ops::mul(z, p), q), u));
+
+    /* Back to the full circle */
+    angle = Ops::select(Ops::greater(ay, ax), Ops::sub(Ops::set(M_PI_2), angle), angle);
+    angle = Ops::select(Ops::greater(Ops::set(0.), x), Ops::sub(Ops::set(M_PI), angle), angle);
+    return Ops::mulSign(angle, y);
+}
+
+} // namespace simd
+
+#endif // SIMDMATH_H
@@ -0,0 +1,200 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SplineTrajectory.h"
+#include <algorithm>
+
+SplineTrajectory::SplineTrajectory()
+{
+}
+
+bool SplineTrajectory::set(const JointVector *waypoints, const double *times, int count, Interpolation interpolation)
+{
+    bool valid = (count >= 2);
+
+    for (int i = 1; i < count && valid; i++)
+    {
+        valid = (times[i] > times[i - 1]);
+    }
+
+    this->waypoints.clear();
+    this->times.clear();
+    this->segments.clear();
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        this->waypoints.push_back(waypoints[i]);
+        this->times.push_back(times[i] - times[0]);
+    }
+
+    /* Velocities and accelerations at the waypoints */
+    vector<JointVector> velocities(count);
+    vector<JointVector> accelerations(count, JointVector::Zero());
+
+    if (interpolation == CUBIC)
+    {
+        this->splineVelocities(velocities);
+    }
+    else
+    {
+        this->averageVelocities(velocities);
+
+        for (int i = 1; i < count - 1; i++)
+        {
+            accelerations[i] = (velocities[i + 1] - velocities[i - 1]) / (this->times[i + 1] - this->times[i - 1]);
+        }
+    }
+
+    /* Hermite polynomials of each segment */
+    for (int i = 0; i < count - 1; i++)
+    {
+        double h = this->times[i + 1] - this->times[i];
+        JointVector dq = this->waypoints[i + 1] - this->waypoints[i];
+        const JointVector &v0 = velocities[i];
+        const JointVector &v1 = velocities[i + 1];
+        const JointVector &a0 = accelerations[i];
+        const JointVector &a1 = accelerations[i + 1];
+        SegmentCoefficients c;
+
+        c.row(0) = this->waypoints[i].transpose();
+        c.row(1) = v0.transpose();
+
+        if (interpolation == CUBIC)
+        {
+            c.row(2) = ((3. * dq / h - 2. * v0 - v1) / h).transpose();
+            c.row(3) = ((-2. * dq / h + v0 + v1) / (h * h)).transpose();
+            c.row(4).setZero();
+            c.row(5).setZero();
+        }
+        else
+        {
+            c.row(2) = (0.5 * a0).transpose();
+            c.row(3) = ((20. * dq - (8. * v1 + 12. * v0) * h - (3. * a0 - a1) * h * h) / (2. * h * h * h)).transpose();
+            c.row(4) = ((-30. * dq + (14. * v1 + 16. * v0) * h + (3. * a0 - 2. * a1) * h * h) / (2. * h * h * h * h)).transpose();
+            c.row(5) = ((12. * dq - 6. * (v1 + v0) * h - (a0 - a1) * h * h) / (2. * h * h * h * h * h)).transpose();
+        }
+        this->segments.push_back(c);
+    }
+    return true;
+}
+
+double SplineTrajectory::duration() const
+{
+    return this->times.empty() ? 0. : this->times.back();
+}
+
+int SplineTrajectory::size() const
+{
+    return this->waypoints.size();
+}
+
+const JointVector &SplineTrajectory::waypoint(int index) const
+{
+    return this->waypoints[index];
+}
+
+void SplineTrajectory::sample(double time, JointVector &position, JointVector *velocity, JointVector *acceleration) const
+{
+    if (this->segments.empty())
+    {
+        return;
+    }
+
+    /* Segment which contains the time, the time is clamped to the trajectory */
+    time = min(max(time, 0.), this->duration());
+    int segment = upper_bound(this->times.begin(), this->times.end(), time) - this->times.begin() - 1;
+    segment = min(max(segment, 0), (int) this->segments.size() - 1);
+
+    const SegmentCoefficients &c = this->segments[segment];
+    double t = time - this->times[segment];
+
+    /* Horner scheme */
+    position = (c.row(0) + t * (c.row(1) + t * (c.row(2) + t * (c.row(3) + t * (c.row(4) + t * c.row(5)))))).transpose();
+
+    if (velocity != NULL)
+    {
+        *velocity = (c.row(1) + t * (2. * c.row(2) + t * (3. * c.row(3) + t * (4. * c.row(4) + t * 5. * c.row(5))))).transpose();
+    }
+
+    if (acceleration != NULL)
+    {
+        *acceleration = (2. * c.row(2) + t * (6. * c.row(3) + t * (12. * c.row(4) + t * 20. * c.row(5)))).transpose();
+    }
+}
+
+void SplineTrajectory::splineVelocities(vector<JointVector> &velocities) const
+{
+    int n = this->waypoints.size();
+
+    /* Tridiagonal system of the inner velocities (Thomas algorithm), the end velocities are zero */
+    vector<double> diagonal(n, 1.);
+    vector<double> upper(n, 0.);
+    vector<JointVector> right(n, JointVector::Zero());
+
+    for (int i = 1; i < n - 1; i++)
+    {
+        double h0 = this->times[i] - this->times[i - 1];
+        double h1 = this->times[i + 1] - this->times[i];
+        double lower = h1;
+
+        diagonal[i] = 2. * (h0 + h1);
+        upper[i] = h0;
+        right[i] = 3. * (h1 / h0 * (this->waypoints[i] - this->waypoints[i - 1]) +
+                         h0 / h1 * (this->waypoints[i + 1] - this->waypoints[i]));
+
+        /* Eliminate the lower diagonal */
+        double factor = lower / diagonal[i - 1];
+        diagonal[i] -= factor * upper[i - 1];
+        right[i] -= factor * right[i - 1];
+    }
+
+    velocities[n - 1].setZero();
+    for (int i = n - 2; i > 0; i--)
+    {
+        velocities[i] = (right[i] - upper[i] * velocities[i + 1]) / diagonal[i];
+    }
+    velocities[0].setZero();
+}
+
+void SplineTrajectory::averageVelocities(vector<JointVector> &velocities) const
+{
+    int n = this->waypoints.size();
+
+    velocities[0].setZero();
+    velocities[n - 1].setZero();
+
+    for (int i = 1; i < n - 1; i++)
+    {
+        JointVector slope0 = (this->waypoints[i] - this->waypoints[i - 1]) / (this->times[i] - this->times[i - 1]);
+        JointVector slope1 = (this->waypoints[i + 1] - this->waypoints[i]) / (this->times[i + 1] - this->times[i]);
+
+        for (int j = 0; j < ARMJOINTS; j++)
+        {
+            velocities[i][j] = (slope0[j] * slope1[j] > 0) ? 0.5 * (slope0[j] + slope1[j]) : 0.;
+        }
+    }
+}
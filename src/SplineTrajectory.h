@@ -0,0 +1,137 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPLINETRAJECTORY_H
+#define SPLINETRAJECTORY_H
+
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/StdVector>
+#include <vector>
+#include "Trajectory.h"
+
+using namespace std;
+using namespace Eigen;
+
+/** Polynomial coefficients of one segment (row: power of the time, column: joint) */
+typedef Matrix<double, 6, ARMJOINTS> SegmentCoefficients;
+
+/**
+ * An object of this class interpolates a joint space trajectory through a
+ * list of waypoints which are reached at given times.
+ *
+ * Two interpolations are supported:
+ * - CUBIC: A cubic spline with continuous acceleration through all
+ *   waypoints. The arm starts and stops with zero velocity. Between
+ *   waypoints the spline may overshoot.
+ * - QUINTIC: Quintic polynomials per segment. At a direction change of a
+ *   joint its velocity is zero at the waypoint, so nothing overshoots.
+ *   The acceleration is continuous and zero at the start and the end.
+ *
+ * @author Stefan Wilkes
+ */
+class SplineTrajectory : public Trajectory
+{
+public:
+
+    /** Kind of interpolation between the waypoints */
+    enum Interpolation
+    {
+        CUBIC,
+        QUINTIC
+    };
+
+    /**
+     * Constructor:
+     * Creates an empty trajectory.
+     */
+    SplineTrajectory();
+
+    /**
+     * Calculates the trajectory through the given waypoints.
+     *
+     * @param waypoints Axis values in radian (0 is centered)
+     * @param times Time from the start in seconds when each waypoint is reached
+     *              (strictly increasing)
+     * @param count Number of waypoints (at least 2)
+     * @param interpolation Kind of interpolation
+     * @return true if the trajectory is valid
+     */
+    bool set(const JointVector *waypoints, const double *times, int count, Interpolation interpolation = QUINTIC);
+
+    /**
+     * Returns the duration of the trajectory.
+     *
+     * @return the time from the first to the last waypoint in seconds
+     */
+    virtual double duration() const;
+
+    /**
+     * Returns the number of waypoints.
+     *
+     * @return the number of waypoints (0 if the trajectory is empty)
+     */
+    int size() const;
+
+    /**
+     * Returns a waypoint.
+     *
+     * @param index Index of the waypoint
+     * @return the axis values of the waypoint
+     */
+    const JointVector &waypoint(int index) const;
+
+    /**
+     * Evaluates the trajectory. Times outside the trajectory are clamped
+     * to the first or last waypoint.
+     *
+     * @param time Time since the start in seconds
+     * @param position Receives the axis values in radian
+     * @param velocity Optional pointer which receives the axis velocities
+     * @param acceleration Optional pointer which receives the axis accelerations
+     */
+    virtual void sample(double time, JointVector &position, JointVector *velocity = NULL, JointVector *acceleration = NULL) const;
+
+private:
+
+    /**
+     * Calculates the knot velocities of a cubic spline with zero velocity
+     * at both ends (continuous acceleration).
+     */
+    void splineVelocities(vector<JointVector> &velocities) const;
+
+    /**
+     * Calculates knot velocities from the neighbouring slopes, the velocity is
+     * zero if a joint changes its direction.
+     */
+    void averageVelocities(vector<JointVector> &velocities) const;
+
+    /** Waypoints of the trajectory */
+    vector<JointVector> waypoints;
+
+    /** Time of each waypoint since the start */
+    vector<double> times;
+
+    /** Coefficients of each segment in the local time of the segment */
+    vector<SegmentCoefficients, aligned_allocator<SegmentCoefficients> > segments;
+};
+
+#endif // SPLINETRAJECTORY_H
@@ -0,0 +1,117 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * An object of this class is a bounded queue for one producer and one
+ * consumer thread. Both sides never lock and never allocate memory, so it
+ * can be used to pass commands into a real time thread.
+ *
+ * @author Stefan Wilkes
+ */
+template<class T, size_t CAPACITY>
+class SpscQueue
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an empty queue.
+     */
+    SpscQueue() : head(0), tail(0)
+    {
+    }
+
+    /**
+     * Appends an item. Must only be called by the producer thread.
+     *
+     * @param item The item to append
+     * @return false if the queue is full
+     */
+    bool push(const T &item)
+    {
+        size_t position = this->tail.load(std::memory_order_relaxed);
+
+        if (position - this->head.load(std::memory_order_acquire) == CAPACITY)
+        {
+            return false;
+        }
+        this->items[position % CAPACITY] = item;
+        this->tail.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Removes the oldest item. Must only be called by the consumer thread.
+     *
+     * @param item Receives the item
+     * @return false if the queue is empty
+     */
+    bool pop(T &item)
+    {
+        size_t position = this->head.load(std::memory_order_relaxed);
+
+        if (position == this->tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = this->items[position % CAPACITY];
+        this->head.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Checks if the queue is empty. The result may be outdated
+     * if the other thread uses the queue meanwhile.
+     *
+     * @return true if no item is queued
+     */
+    bool empty() const
+    {
+        return this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire);
+    }
+
+private:
+
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue needs a power of two capacity");
+
+    /** Index of the next item to pop (consumer side) */
+    std::atomic<size_t> head;
+
+    /** Padding, so producer and consumer don't share a cache line */
+    char padding[64];
+
+    /** Index of the next item to push (producer side) */
+    std::atomic<size_t> tail;
+
+    /** The items */
+    T items[CAPACITY];
+};
+
+#endif // SPSCQUEUE_H
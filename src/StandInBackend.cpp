@@ -0,0 +1,280 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "StandInBackend.h"
+#include <chrono>
+#include <stdexcept>
+
+StandInBackend::StandInBackend(int cycleTime, bool calibrated) : cycleTime(cycleTime), calibrated(calibrated),
+    gripperSpacing(0), statistics(), mailboxDelay(0), faultInterval(0), calls(0), running(true)
+{
+    this->setpoint.setZero();
+    this->sensedPosition.setZero();
+    this->sensedVelocity.setZero();
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        this->released[i] = false;
+    }
+    this->etherCatThread = thread(&StandInBackend::etherCatLoop, this);
+}
+
+StandInBackend::~StandInBackend()
+{
+    this->running = false;
+    this->etherCatThread.join();
+}
+
+void StandInBackend::setSimulationParameters(const SimulationParameters &parameters)
+{
+    lock_guard<mutex> lock(this->dataMutex);
+    this->parameters = parameters;
+}
+
+void StandInBackend::setMailboxDelay(int delay)
+{
+    this->mailboxDelay = delay;
+}
+
+void StandInBackend::setFaultInterval(int interval)
+{
+    this->faultInterval = interval;
+}
+
+void StandInBackend::getStatistics(StandInStatistics &statistics)
+{
+    lock_guard<mutex> lock(this->dataMutex);
+    statistics = this->statistics;
+}
+
+void StandInBackend::doJointCommutation()
+{
+    this->mailboxRoundTrip();
+}
+
+void StandInBackend::calibrateManipulator(bool forceCalibration)
+{
+    lock_guard<mutex> lock(this->dataMutex);
+
+    /* The calibration ends at the mechanical stops, where the kuka angles are 0 */
+    if (!this->calibrated || forceCalibration)
+    {
+        this->joints.reset(JointVector::Zero());
+        this->setpoint.setZero();
+        this->calibrated = true;
+    }
+}
+
+void StandInBackend::getConfigurationParameter(int joint, YouBotSlaveMailboxMsg &message)
+{
+    checkJoint(joint);
+    this->injectFault();
+    this->mailboxRoundTrip();
+
+    lock_guard<mutex> lock(this->dataMutex);
+    bool calibrationFlag = (message.stctOutput.commandNumber == GGP) &&
+                           (message.stctOutput.motorNumber == USER_VARIABLE_BANK) &&
+                           (message.stctOutput.typeNumber == CALIBRATION_FLAG_VARIABLE);
+
+    /* Only the calibration flag of the driver is known, all other parameters are 0 */
+    message.stctInput.value = (calibrationFlag && this->calibrated) ? 1 : 0;
+    message.stctInput.status = NO_ERROR;
+}
+
+void StandInBackend::getJointData(vector<JointSensedAngle> &data)
+{
+    /* The arms of a process share the EtherCAT master */
+    lock_guard<mutex> bus(etherCatMutex);
+    this->injectFault();
+    lock_guard<mutex> lock(this->dataMutex);
+    data.resize(ARMJOINTS);
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        data[i].angle = this->sensedPosition[i] * radian;
+    }
+    this->statistics.readouts++;
+}
+
+void StandInBackend::getJointData(vector<JointSensedVelocity> &data)
+{
+    lock_guard<mutex> bus(etherCatMutex);
+    this->injectFault();
+    lock_guard<mutex> lock(this->dataMutex);
+    data.resize(ARMJOINTS);
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        data[i].angularVelocity = this->sensedVelocity[i] * radian_per_second;
+    }
+    this->statistics.readouts++;
+}
+
+void StandInBackend::getJointData(vector<JointSensedCurrent> &data)
+{
+    lock_guard<mutex> bus(etherCatMutex);
+    this->injectFault();
+    lock_guard<mutex> lock(this->dataMutex);
+    data.resize(ARMJOINTS);
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        data[i].current = 0 * ampere;
+    }
+    this->statistics.readouts++;
+}
+
+void StandInBackend::getJointData(vector<JointSensedTorque> &data)
+{
+    lock_guard<mutex> bus(etherCatMutex);
+    this->injectFault();
+    lock_guard<mutex> lock(this->dataMutex);
+    data.resize(ARMJOINTS);
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        data[i].torque = 0 * newton_meter;
+    }
+    this->statistics.readouts++;
+}
+
+void StandInBackend::setJointData(const vector<JointAngleSetpoint> &data, const bool changed[ARMJOINTS])
+{
+    if (data.size() != ARMJOINTS)
+    {
+        throw std::out_of_range("Wrong number of joint setpoints");
+    }
+    lock_guard<mutex> bus(etherCatMutex);
+    this->injectFault();
+    lock_guard<mutex> lock(this->dataMutex);
+
+    /* All changed joints are released to the same cycle */
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        if (changed[i])
+        {
+            this->setpoint[i] = data[i].angle.value();
+            this->released[i] = true;
+        }
+    }
+}
+
+void StandInBackend::setJointData(int joint, const JointVelocitySetpoint &data)
+{
+    /* The joints only follow angles, a velocity setpoint is replaced by the next angle */
+    checkJoint(joint);
+    this->injectFault();
+}
+
+void StandInBackend::openGripper()
+{
+    this->mailboxRoundTrip();
+    lock_guard<mutex> lock(this->dataMutex);
+    this->gripperSpacing = GRIPPER_LIMIT[1];
+}
+
+void StandInBackend::closeGripper()
+{
+    this->mailboxRoundTrip();
+    lock_guard<mutex> lock(this->dataMutex);
+    this->gripperSpacing = GRIPPER_LIMIT[0];
+}
+
+void StandInBackend::setGripperData(const GripperBarSpacingSetPoint &data)
+{
+    this->injectFault();
+    this->mailboxRoundTrip();
+    lock_guard<mutex> lock(this->dataMutex);
+    this->gripperSpacing = data.barSpacing.value();
+}
+
+void StandInBackend::etherCatLoop()
+{
+    chrono::steady_clock::time_point nextCycle = chrono::steady_clock::now();
+    double timeStep = this->cycleTime * 1e-6;
+
+    while (this->running)
+    {
+        {
+            lock_guard<mutex> lock(this->dataMutex);
+
+            /* The released setpoints reach the joints with this cycle */
+            for (int i = 0; i < ARMJOINTS; i++)
+            {
+                this->statistics.setpoints += this->released[i] ? 1 : 0;
+            }
+            this->joints.setTarget(this->setpoint, this->released);
+
+            for (int i = 0; i < ARMJOINTS; i++)
+            {
+                this->released[i] = false;
+            }
+
+            this->joints.step(this->parameters, timeStep);
+            this->sensedPosition = this->joints.getPosition();
+            this->sensedVelocity = this->joints.getVelocity();
+            this->statistics.cycles++;
+        }
+
+        /* A late cycle starts the schedule again, the next cycles aren't shortened */
+        nextCycle += chrono::microseconds(this->cycleTime);
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        nextCycle = (nextCycle < now) ? now : nextCycle;
+        this_thread::sleep_until(nextCycle);
+    }
+}
+
+void StandInBackend::injectFault()
+{
+    int interval = this->faultInterval.load(memory_order_relaxed);
+
+    if (interval > 0 && (this->calls.fetch_add(1, memory_order_relaxed) + 1) % interval == 0)
+    {
+        {
+            lock_guard<mutex> lock(this->dataMutex);
+            this->statistics.faults++;
+        }
+        throw std::runtime_error("Injected fault of the stand-in backend");
+    }
+}
+
+void StandInBackend::mailboxRoundTrip()
+{
+    int delay = this->mailboxDelay.load(memory_order_relaxed);
+
+    {
+        lock_guard<mutex> lock(this->dataMutex);
+        this->statistics.mailbox++;
+    }
+    if (delay > 0)
+    {
+        this_thread::sleep_for(chrono::microseconds(delay));
+    }
+}
+
+void StandInBackend::checkJoint(int joint)
+{
+    if (joint < 1 || joint > ARMJOINTS)
+    {
+        throw std::out_of_range("Invalid joint number");
+    }
+}
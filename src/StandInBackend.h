@@ -0,0 +1,200 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STANDINBACKEND_H
+#define STANDINBACKEND_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include "ArmBackend.h"
+#include "JointSimulation.h"
+
+/**
+ * Counters of a stand-in backend.
+ */
+struct StandInStatistics
+{
+    /** Number of emulated EtherCAT cycles */
+    uint64_t cycles;
+
+    /** Number of joint setpoints which reached the joints */
+    uint64_t setpoints;
+
+    /** Number of readouts of sensed values */
+    uint64_t readouts;
+
+    /** Number of mailbox messages (configuration parameters and gripper commands) */
+    uint64_t mailbox;
+
+    /** Number of calls which threw an injected fault */
+    uint64_t faults;
+};
+
+/**
+ * An object of this class stands in for the youBot arm, so the real
+ * Manipulator with its control thread, command and readback pipeline and
+ * error handling can be benchmarked and profiled on a plain Linux box.
+ *
+ * A background thread emulates the EtherCAT thread of the driver: once per
+ * cycle it passes the released setpoints to the simulated joints (see
+ * JointSimulation), advances them and publishes the sensed values. Like in
+ * the driver, the process data is exchanged under a mutex and the changed
+ * joints of a command are released to the same cycle. The process data
+ * calls take the lock of the process like the YouBotBackend, so several
+ * stand-in arms wait for each other like arms on one EtherCAT master.
+ * Mailbox messages (the calibration flags and the gripper) wait for an
+ * adjustable round trip time. Currents and torques aren't simulated and
+ * are always 0.
+ *
+ * Faults can be injected: every n-th data call then throws an exception
+ * like a lost connection in the driver.
+ *
+ * @author Stefan Wilkes
+ */
+class StandInBackend : public ArmBackend
+{
+public:
+
+    /**
+     * Constructor:
+     * Starts the emulated EtherCAT thread. The joints rest at kuka angle 0.
+     *
+     * @param cycleTime Cycle time of the emulated EtherCAT thread in microseconds
+     * @param calibrated Flag if the motor controllers are calibrated already (for a warm start)
+     */
+    StandInBackend(int cycleTime = DEFAULT_CYCLE_TIME_US, bool calibrated = false);
+
+    /**
+     * Destructor:
+     * Stops the emulated EtherCAT thread.
+     */
+    virtual ~StandInBackend();
+
+    /**
+     * Sets the parameters of the simulated joints.
+     *
+     * @param parameters The parameters
+     */
+    void setSimulationParameters(const SimulationParameters &parameters);
+
+    /**
+     * Sets the round trip time of a mailbox message.
+     *
+     * @param delay The time in microseconds (0 answers at once)
+     */
+    void setMailboxDelay(int delay);
+
+    /**
+     * Injects faults into the data calls.
+     *
+     * @param interval Every interval-th call throws (0 for no faults)
+     */
+    void setFaultInterval(int interval);
+
+    /**
+     * Returns the counters of the backend.
+     *
+     * @param statistics Receives the counters
+     */
+    void getStatistics(StandInStatistics &statistics);
+
+    virtual void doJointCommutation();
+    virtual void calibrateManipulator(bool forceCalibration);
+    virtual void getConfigurationParameter(int joint, YouBotSlaveMailboxMsg &message);
+    virtual void getJointData(vector<JointSensedAngle> &data);
+    virtual void getJointData(vector<JointSensedVelocity> &data);
+    virtual void getJointData(vector<JointSensedCurrent> &data);
+    virtual void getJointData(vector<JointSensedTorque> &data);
+    virtual void setJointData(const vector<JointAngleSetpoint> &data, const bool changed[ARMJOINTS]);
+    virtual void setJointData(int joint, const JointVelocitySetpoint &data);
+    virtual void openGripper();
+    virtual void closeGripper();
+    virtual void setGripperData(const GripperBarSpacingSetPoint &data);
+
+private:
+
+    /**
+     * Main function of the emulated EtherCAT thread.
+     */
+    void etherCatLoop();
+
+    /**
+     * Throws an exception if a fault is due.
+     */
+    void injectFault();
+
+    /**
+     * Waits for the round trip of a mailbox message.
+     */
+    void mailboxRoundTrip();
+
+    /**
+     * Checks a joint number.
+     *
+     * @param joint Number of the joint (1 - ARMJOINTS)
+     */
+    static void checkJoint(int joint);
+
+    /** Cycle time of the emulated EtherCAT thread in microseconds */
+    int cycleTime;
+
+    /** The simulated joints */
+    JointSimulation joints;
+
+    /** Parameters of the simulated joints */
+    SimulationParameters parameters;
+
+    /** Setpoints which are sent with the next cycle (kuka angles) */
+    JointVector setpoint;
+    bool released[ARMJOINTS];
+
+    /** Published sensed values (kuka angles) */
+    JointVector sensedPosition;
+    JointVector sensedVelocity;
+
+    /** Flag if the motor controllers are calibrated */
+    bool calibrated;
+
+    /** Spacing of the gripper in meter */
+    double gripperSpacing;
+
+    /** Counters */
+    StandInStatistics statistics;
+
+    /** Protects all values above, like the process data of the driver */
+    mutex dataMutex;
+
+    /** Round trip time of the mailbox in microseconds */
+    atomic<int> mailboxDelay;
+
+    /** Fault injection */
+    atomic<int> faultInterval;
+    atomic<uint64_t> calls;
+
+    /** The emulated EtherCAT thread */
+    thread etherCatThread;
+    atomic<bool> running;
+};
+
+#endif // STANDINBACKEND_H
@@ -0,0 +1,337 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "TelemetryRecorder.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Size by which the log file grows in bytes */
+static const size_t TELEMETRY_FILE_CHUNK = 16 << 20;
+
+/** Time the background thread sleeps if the queue is empty in microseconds */
+static const int TELEMETRY_FLUSH_INTERVAL_US = 2000;
+
+/**
+ * Returns the nanoseconds of a steady clock time.
+ *
+ * @param time The time
+ * @return the nanoseconds since the clock's epoch
+ */
+static inline int64_t steadyNanoseconds(const chrono::steady_clock::time_point &time)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+TelemetryRecorder::TelemetryRecorder() : active(false), session(0), startTime(0), flushing(false), written(0),
+    dropped(0), fileSize(0), file(-1), mapping(NULL), mappingSize(0)
+{
+    /* The queue is too large for the stack of the owner */
+    this->queue = new SpscQueue<QueuedRecord, QUEUE_SIZE>();
+}
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+    this->close();
+    delete this->queue;
+}
+
+bool TelemetryRecorder::open(const string &fileName, int cycleTime)
+{
+    if (this->flusher.joinable())
+    {
+        return false;
+    }
+
+    this->file = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (this->file < 0)
+    {
+        return false;
+    }
+
+    this->mapping = NULL;
+    this->mappingSize = 0;
+    this->written = 0;
+    this->dropped = 0;
+
+    if (!this->reserve(0))
+    {
+        ::close(this->file);
+        this->file = -1;
+        return false;
+    }
+
+    TelemetryLogHeader *header = static_cast<TelemetryLogHeader *>(this->mapping);
+    memcpy(header->magic, "YBTL", 4);
+    header->version = TELEMETRY_LOG_VERSION;
+    header->recordSize = sizeof(TelemetryRecord);
+    header->joints = ARMJOINTS;
+    header->cycleTime = cycleTime;
+    header->reserved = 0;
+    header->records = 0;
+    header->startTime = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    this->fileSize = sizeof(TelemetryLogHeader);
+
+    /* Records of an earlier recording which are still queued are skipped by the session */
+    this->session++;
+    this->startTime = steadyNanoseconds(chrono::steady_clock::now());
+    this->flushing = true;
+    this->flusher = thread(&TelemetryRecorder::flushLoop, this);
+    this->active.store(true, memory_order_release);
+
+    return true;
+}
+
+void TelemetryRecorder::close()
+{
+    if (!this->flusher.joinable())
+    {
+        return;
+    }
+
+    /* The background thread writes all records which are queued until now */
+    this->active = false;
+    this->flushing = false;
+    this->flusher.join();
+
+    /* Cut the unused part of the last chunk */
+    munmap(this->mapping, this->mappingSize);
+    if (ftruncate(this->file, this->fileSize) != 0)
+    {
+        perror("TelemetryRecorder");
+    }
+    ::close(this->file);
+
+    this->file = -1;
+    this->mapping = NULL;
+    this->mappingSize = 0;
+}
+
+bool TelemetryRecorder::isOpen() const
+{
+    return this->active.load(memory_order_acquire);
+}
+
+void TelemetryRecorder::recordState(uint64_t cycle, const chrono::steady_clock::time_point &timestamp,
+                                    const JointVector &angles, const JointVector &velocities,
+                                    const JointVector &currents, const JointVector &torques)
+{
+    if (!this->active.load(memory_order_acquire))
+    {
+        return;
+    }
+
+    TelemetryRecord record;
+    record.type = TELEMETRY_STATE;
+    record.flags = 0;
+    record.cycle = cycle;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        record.values[0][i] = angles[i];
+        record.values[1][i] = velocities[i];
+        record.values[2][i] = currents[i];
+        record.values[3][i] = torques[i];
+    }
+    this->push(record, timestamp);
+}
+
+void TelemetryRecorder::recordCommand(uint64_t cycle, const JointVector &angles, const bool changed[ARMJOINTS])
+{
+    if (!this->active.load(memory_order_acquire))
+    {
+        return;
+    }
+
+    TelemetryRecord record;
+    memset(record.values, 0, sizeof(record.values));
+    record.type = TELEMETRY_COMMAND;
+    record.flags = 0;
+    record.cycle = cycle;
+
+    for (int i = 0; i < ARMJOINTS; i++)
+    {
+        record.values[0][i] = angles[i];
+        record.flags |= changed[i] ? (1 << i) : 0;
+    }
+    this->push(record, chrono::steady_clock::now());
+}
+
+void TelemetryRecorder::getStatistics(RecorderStatistics &statistics) const
+{
+    statistics.records = this->written.load(memory_order_relaxed);
+    statistics.dropped = this->dropped.load(memory_order_relaxed);
+    statistics.bytes = this->fileSize.load(memory_order_relaxed);
+}
+
+void TelemetryRecorder::push(TelemetryRecord &record, const chrono::steady_clock::time_point &timestamp)
+{
+    QueuedRecord queued;
+    queued.session = this->session.load(memory_order_relaxed);
+    queued.record = record;
+    queued.record.time = steadyNanoseconds(timestamp) - this->startTime.load(memory_order_relaxed);
+
+    if (!this->queue->push(queued))
+    {
+        this->dropped.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void TelemetryRecorder::flushLoop()
+{
+    while (true)
+    {
+        /* The flag is read first, so the last flush sees every record queued before close() */
+        bool stopping = !this->flushing.load(memory_order_acquire);
+
+        if (this->flush() == 0)
+        {
+            if (stopping)
+            {
+                break;
+            }
+            this_thread::sleep_for(chrono::microseconds(TELEMETRY_FLUSH_INTERVAL_US));
+        }
+    }
+}
+
+int TelemetryRecorder::flush()
+{
+    uint32_t currentSession = this->session.load(memory_order_relaxed);
+    uint64_t records = this->written.load(memory_order_relaxed);
+    QueuedRecord queued;
+    int taken = 0;
+
+    while (this->queue->pop(queued))
+    {
+        taken++;
+
+        if (queued.session != currentSession)
+        {
+            continue;
+        }
+        if (!this->reserve(records + 1))
+        {
+            this->dropped.fetch_add(1, memory_order_relaxed);
+            continue;
+        }
+
+        char *end = static_cast<char *>(this->mapping) + sizeof(TelemetryLogHeader) + records * sizeof(TelemetryRecord);
+        memcpy(end, &queued.record, sizeof(TelemetryRecord));
+        records++;
+    }
+
+    if (taken > 0 && this->mapping != NULL)
+    {
+        /* The counter is written after the records, so a crashed recording stays consistent */
+        static_cast<TelemetryLogHeader *>(this->mapping)->records = records;
+        this->written.store(records, memory_order_relaxed);
+        this->fileSize.store(sizeof(TelemetryLogHeader) + records * sizeof(TelemetryRecord), memory_order_relaxed);
+    }
+    return taken;
+}
+
+bool TelemetryRecorder::reserve(uint64_t records)
+{
+    size_t required = sizeof(TelemetryLogHeader) + records * sizeof(TelemetryRecord);
+
+    if (this->mapping != NULL && required <= this->mappingSize)
+    {
+        return true;
+    }
+
+    size_t size = (required / TELEMETRY_FILE_CHUNK + 1) * TELEMETRY_FILE_CHUNK;
+    if (ftruncate(this->file, size) != 0)
+    {
+        return false;
+    }
+
+    /* The old mapping stays valid if the file can't be mapped again */
+    void *grown = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, this->file, 0);
+    if (grown == MAP_FAILED)
+    {
+        return false;
+    }
+
+    if (this->mapping != NULL)
+    {
+        munmap(this->mapping, this->mappingSize);
+    }
+    this->mapping = grown;
+    this->mappingSize = size;
+
+    return true;
+}
+
+TelemetryLog::TelemetryLog()
+{
+    memset(&this->header, 0, sizeof(this->header));
+}
+
+bool TelemetryLog::load(const string &fileName)
+{
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    this->records.clear();
+    bool valid = (fread(&this->header, sizeof(this->header), 1, file) == 1) &&
+                 (memcmp(this->header.magic, "YBTL", 4) == 0) &&
+                 (this->header.version == TELEMETRY_LOG_VERSION) &&
+                 (this->header.recordSize == sizeof(TelemetryRecord)) &&
+                 (this->header.joints == ARMJOINTS);
+
+    if (valid)
+    {
+        /* A file which wasn't closed holds a whole chunk, only the counted records are valid */
+        TelemetryRecord record;
+
+        while (this->records.size() < this->header.records && fread(&record, sizeof(record), 1, file) == 1)
+        {
+            this->records.push_back(record);
+        }
+        this->header.records = this->records.size();
+    }
+    fclose(file);
+
+    return valid;
+}
+
+const TelemetryLogHeader &TelemetryLog::getHeader() const
+{
+    return this->header;
+}
+
+size_t TelemetryLog::size() const
+{
+    return this->records.size();
+}
+
+const TelemetryRecord &TelemetryLog::record(size_t index) const
+{
+    return this->records[index];
+}
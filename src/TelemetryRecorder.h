@@ -0,0 +1,327 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TELEMETRYRECORDER_H
+#define TELEMETRYRECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "KinematicsSolver.h"
+#include "SpscQueue.h"
+
+using namespace std;
+
+/** Version of the binary file format, increment on every layout change */
+#define TELEMETRY_LOG_VERSION 1
+
+/**
+ * Enumerator definition for the kinds of telemetry records
+ */
+typedef enum
+{
+    TELEMETRY_STATE,
+    TELEMETRY_COMMAND
+} TELEMETRY_RECORD_TYPE;
+
+/**
+ * File header of a telemetry log. The records follow directly.
+ */
+struct TelemetryLogHeader
+{
+    /** Always "YBTL" */
+    char magic[4];
+
+    /** Format version (TELEMETRY_LOG_VERSION) */
+    uint32_t version;
+
+    /** Size of one record in bytes */
+    uint32_t recordSize;
+
+    /** Number of joints per record */
+    uint32_t joints;
+
+    /** Cycle time of the control thread in microseconds */
+    int32_t cycleTime;
+
+    /** Unused, always 0 */
+    uint32_t reserved;
+
+    /** Number of valid records, updated after every flush */
+    uint64_t records;
+
+    /** Start of the recording in nanoseconds since 1970 */
+    int64_t startTime;
+};
+
+/**
+ * One record of a telemetry log.
+ */
+struct TelemetryRecord
+{
+    /** Kind of the record (TELEMETRY_RECORD_TYPE) */
+    uint32_t type;
+
+    /** Bit mask of the changed joints (commands only) */
+    uint32_t flags;
+
+    /** Number of the control cycle */
+    uint64_t cycle;
+
+    /** Time since the start of the recording in nanoseconds */
+    int64_t time;
+
+    /**
+     * State: angles (0 is centered), velocities, currents and torques.
+     * Command: kuka angles of the setpoints in the first row.
+     */
+    double values[4][ARMJOINTS];
+};
+
+/**
+ * Counters of a recording.
+ */
+struct RecorderStatistics
+{
+    /** Number of records in the file */
+    uint64_t records;
+
+    /** Number of records which were lost because the queue was full or the file couldn't grow */
+    uint64_t dropped;
+
+    /** Size of the file in bytes */
+    uint64_t bytes;
+};
+
+/**
+ * An object of this class writes every joint command and sensed joint
+ * state of the control thread into an append-only binary log.
+ *
+ * The control thread only copies a record into a lock free queue. A
+ * background thread moves the queued records into the memory mapped file,
+ * which grows in chunks of 16 MB (about 45 s at 1 kHz), and updates the
+ * record counter of the header after each batch. So the file stays
+ * readable if the program crashes. Records which don't fit into the queue
+ * are counted and dropped, the control thread never waits.
+ *
+ * @author Stefan Wilkes
+ */
+class TelemetryRecorder
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates a recorder without file.
+     */
+    TelemetryRecorder();
+
+    /**
+     * Destructor:
+     * Closes the file.
+     */
+    ~TelemetryRecorder();
+
+    /**
+     * Creates a new log file and starts the recording.
+     *
+     * @param fileName The file to write (an existing file is replaced)
+     * @param cycleTime Cycle time of the control thread in microseconds
+     * @return true if the file was created, false if it failed or a recording runs
+     */
+    bool open(const string &fileName, int cycleTime);
+
+    /**
+     * Stops the recording, writes all queued records and closes the file.
+     */
+    void close();
+
+    /**
+     * Checks if a recording runs.
+     *
+     * @return true if the records are written into a file
+     */
+    bool isOpen() const;
+
+    /**
+     * Records the state of one cycle. Must only be called by the control thread.
+     *
+     * @param cycle Number of the cycle
+     * @param timestamp Time the state was read
+     * @param angles Axis values in radian (0 is centered)
+     * @param velocities Axis velocities in radian per second
+     * @param currents Motor currents in ampere
+     * @param torques Motor torques in newton meter
+     */
+    void recordState(uint64_t cycle, const chrono::steady_clock::time_point &timestamp, const JointVector &angles,
+                     const JointVector &velocities, const JointVector &currents, const JointVector &torques);
+
+    /**
+     * Records an axis command. Must only be called by the control thread.
+     *
+     * @param cycle Number of the cycle
+     * @param angles Kuka angles of the setpoints in radian
+     * @param changed Flag for each joint if its setpoint was sent
+     */
+    void recordCommand(uint64_t cycle, const JointVector &angles, const bool changed[ARMJOINTS]);
+
+    /**
+     * Returns the counters of the current or last recording.
+     *
+     * @param statistics Receives the counters
+     */
+    void getStatistics(RecorderStatistics &statistics) const;
+
+private:
+
+    /**
+     * Record in the queue, the session drops records which were queued for
+     * an earlier recording.
+     */
+    struct QueuedRecord
+    {
+        uint32_t session;
+        TelemetryRecord record;
+    };
+
+    /** Maximum number of queued records (about 2 seconds with 1 ms cycle time) */
+    static const size_t QUEUE_SIZE = 4096;
+
+    /**
+     * Passes a record to the background thread.
+     *
+     * @param record The record, the time is set here
+     * @param timestamp Time of the record
+     */
+    void push(TelemetryRecord &record, const chrono::steady_clock::time_point &timestamp);
+
+    /**
+     * Main function of the background thread.
+     */
+    void flushLoop();
+
+    /**
+     * Writes all queued records into the file.
+     *
+     * @return the number of records which were taken from the queue
+     */
+    int flush();
+
+    /**
+     * Grows the file and the mapping.
+     *
+     * @param records Number of records the file must hold
+     * @return true if the file is large enough
+     */
+    bool reserve(uint64_t records);
+
+    /** Records for the background thread */
+    SpscQueue<QueuedRecord, QUEUE_SIZE> *queue;
+
+    /** true while records are accepted */
+    atomic<bool> active;
+
+    /** Number of the current recording */
+    atomic<uint32_t> session;
+
+    /** Start of the current recording (steady clock in nanoseconds) */
+    atomic<int64_t> startTime;
+
+    /** true while the background thread should run */
+    atomic<bool> flushing;
+
+    /** Counters of the recording */
+    atomic<uint64_t> written;
+    atomic<uint64_t> dropped;
+    atomic<uint64_t> fileSize;
+
+    /** The background thread */
+    thread flusher;
+
+    /** Descriptor of the log file */
+    int file;
+
+    /** The mapped file (background thread) */
+    void *mapping;
+    size_t mappingSize;
+};
+
+/**
+ * An object of this class holds a telemetry log which was read from a file,
+ * e.g. to replay it with the OfflineManipulator.
+ *
+ * @author Stefan Wilkes
+ */
+class TelemetryLog
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates an empty log.
+     */
+    TelemetryLog();
+
+    /**
+     * Reads a log file. The records of a file which wasn't closed are read
+     * up to the last flush.
+     *
+     * @param fileName The file to read
+     * @return true if the file is a valid telemetry log
+     */
+    bool load(const string &fileName);
+
+    /**
+     * Returns the header of the file.
+     *
+     * @return the header
+     */
+    const TelemetryLogHeader &getHeader() const;
+
+    /**
+     * Returns the number of records.
+     *
+     * @return the number of records
+     */
+    size_t size() const;
+
+    /**
+     * Returns a record.
+     *
+     * @param index Index of the record (0 - size() - 1)
+     * @return the record
+     */
+    const TelemetryRecord &record(size_t index) const;
+
+private:
+
+    /** Header of the file */
+    TelemetryLogHeader header;
+
+    /** All records in the order they were written */
+    vector<TelemetryRecord> records;
+};
+
+#endif // TELEMETRYRECORDER_H
@@ -0,0 +1,63 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "KinematicsSolver.h"
+
+/**
+ * Interface of a joint space trajectory which can be streamed to the arm.
+ *
+ * @author Stefan Wilkes
+ */
+class Trajectory
+{
+public:
+
+    /**
+     * Destructor.
+     */
+    virtual ~Trajectory()
+    {
+    }
+
+    /**
+     * Returns the duration of the trajectory.
+     *
+     * @return the time from the start to the end in seconds
+     */
+    virtual double duration() const = 0;
+
+    /**
+     * Evaluates the trajectory. Times outside the trajectory are clamped
+     * to the start or the end.
+     *
+     * @param time Time since the start in seconds
+     * @param position Receives the axis values in radian (0 is centered)
+     * @param velocity Optional pointer which receives the axis velocities
+     * @param acceleration Optional pointer which receives the axis accelerations
+     */
+    virtual void sample(double time, JointVector &position, JointVector *velocity = NULL, JointVector *acceleration = NULL) const = 0;
+};
+
+#endif // TRAJECTORY_H
@@ -0,0 +1,232 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "WorkerPool.h"
+#include <algorithm>
+
+/**
+ * Packs a range into one 64 bit value (begin in the upper half).
+ */
+static inline uint64_t packRange(uint32_t begin, uint32_t end)
+{
+    return (((uint64_t) begin) << 32) | end;
+}
+
+WorkerPool::WorkerPool(int threads)
+{
+    if (threads <= 0)
+    {
+        threads = max(1, (int) thread::hardware_concurrency());
+    }
+
+    this->ranges = new Range[threads];
+    for (int i = 0; i < threads; i++)
+    {
+        this->ranges[i].bounds = 0;
+    }
+
+    this->task = NULL;
+    this->grainSize = 1;
+    this->generation = 0;
+    this->pendingWorkers = 0;
+    this->stopWorkers = false;
+
+    /* The calling thread takes part as thread 0 */
+    for (int i = 1; i < threads; i++)
+    {
+        this->workers.push_back(thread(&WorkerPool::workerLoop, this, i));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        unique_lock<mutex> lock(this->stateMutex);
+        this->stopWorkers = true;
+    }
+    this->loopStarted.notify_all();
+
+    for (size_t i = 0; i < this->workers.size(); i++)
+    {
+        this->workers[i].join();
+    }
+    delete[] this->ranges;
+}
+
+WorkerPool &WorkerPool::instance()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+int WorkerPool::size() const
+{
+    return this->workers.size() + 1;
+}
+
+void WorkerPool::parallelFor(int count, int grainSize, const function<void(int, int)> &task)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    unique_lock<mutex> loopLock(this->loopMutex);
+    int threads = this->size();
+
+    /* Small loops aren't worth waking up the workers */
+    if (threads == 1 || count <= grainSize)
+    {
+        task(0, count);
+        return;
+    }
+
+    /* Split the index range evenly between all threads */
+    for (int i = 0; i < threads; i++)
+    {
+        uint32_t begin = (uint32_t) (((int64_t) count * i) / threads);
+        uint32_t end = (uint32_t) (((int64_t) count * (i + 1)) / threads);
+        this->ranges[i].bounds = packRange(begin, end);
+    }
+
+    {
+        unique_lock<mutex> lock(this->stateMutex);
+        this->task = &task;
+        this->grainSize = max(1, grainSize);
+        this->pendingWorkers = this->workers.size();
+        this->generation++;
+    }
+    this->loopStarted.notify_all();
+
+    /* Take part in the loop and wait for the workers afterwards */
+    this->processRanges(0);
+
+    unique_lock<mutex> lock(this->stateMutex);
+    while (this->pendingWorkers > 0)
+    {
+        this->loopFinished.wait(lock);
+    }
+    this->task = NULL;
+}
+
+void WorkerPool::workerLoop(int index)
+{
+    uint64_t lastGeneration = 0;
+
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(this->stateMutex);
+            while (!this->stopWorkers && this->generation == lastGeneration)
+            {
+                this->loopStarted.wait(lock);
+            }
+
+            if (this->stopWorkers)
+            {
+                return;
+            }
+            lastGeneration = this->generation;
+        }
+
+        this->processRanges(index);
+
+        unique_lock<mutex> lock(this->stateMutex);
+        if (--this->pendingWorkers == 0)
+        {
+            this->loopFinished.notify_one();
+        }
+    }
+}
+
+void WorkerPool::processRanges(int index)
+{
+    int begin;
+    int end;
+
+    do
+    {
+        while (this->takeChunk(index, begin, end))
+        {
+            (*this->task)(begin, end);
+        }
+    }
+    while (this->stealRange(index));
+}
+
+bool WorkerPool::takeChunk(int index, int &begin, int &end)
+{
+    atomic<uint64_t> &bounds = this->ranges[index].bounds;
+    uint64_t current = bounds.load();
+
+    while (true)
+    {
+        uint32_t first = (uint32_t) (current >> 32);
+        uint32_t last = (uint32_t) current;
+
+        if (first >= last)
+        {
+            return false;
+        }
+
+        uint32_t next = min(last, first + (uint32_t) this->grainSize);
+        if (bounds.compare_exchange_weak(current, packRange(next, last)))
+        {
+            begin = first;
+            end = next;
+            return true;
+        }
+    }
+}
+
+bool WorkerPool::stealRange(int index)
+{
+    int threads = this->size();
+
+    for (int offset = 1; offset < threads; offset++)
+    {
+        atomic<uint64_t> &victim = this->ranges[(index + offset) % threads].bounds;
+        uint64_t current = victim.load();
+
+        while (true)
+        {
+            uint32_t first = (uint32_t) (current >> 32);
+            uint32_t last = (uint32_t) current;
+
+            if (first >= last)
+            {
+                break;
+            }
+
+            /* Take the back half, but at least one chunk */
+            uint32_t half = max((last - first) / 2, min(last - first, (uint32_t) this->grainSize));
+            uint32_t split = last - half;
+
+            if (victim.compare_exchange_weak(current, packRange(first, split)))
+            {
+                this->ranges[index].bounds = packRange(split, last);
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is part of youbot_arm_controller
+ *
+ * Copyright (c)2014 by Robotics Lab 
+ * in the Computer Science Department of the 
+ * University of Applied Science Gelsenkirchen
+ * 
+ * Author: Stefan Wilkes <stefan.wilkes@studmail.w-hs.de>
+ *  
+ * The package is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ * 
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * An object of this class implements a small work stealing thread pool
+ * for data parallel loops, e.g. solving the kinematics of a whole pose program.
+ *
+ * The index range of a loop is split evenly between all participating threads
+ * (the workers and the calling thread). Each thread processes its own range in
+ * chunks of the given grain size from the front. A thread which runs out of work
+ * steals the back half of the range of another thread. All range operations are
+ * lock free, the mutex is only used to wake up and join the workers.
+ *
+ * @author Stefan Wilkes
+ */
+class WorkerPool
+{
+public:
+
+    /**
+     * Constructor:
+     * Creates a new pool and starts the worker threads.
+     *
+     * @param threads Total number of threads including the calling thread
+     *                (0 uses one thread per core)
+     */
+    explicit WorkerPool(int threads = 0);
+
+    /**
+     * Destructor:
+     * Stops and joins all worker threads.
+     */
+    ~WorkerPool();
+
+    /**
+     * Returns the process wide pool with one thread per core.
+     *
+     * @return the shared pool
+     */
+    static WorkerPool &instance();
+
+    /**
+     * Returns the number of threads which take part in a loop.
+     *
+     * @return the number of worker threads plus the calling thread
+     */
+    int size() const;
+
+    /**
+     * Runs the task for the index range [0, count) and returns after all
+     * indices have been processed. The task is called with sub ranges
+     * [begin, end) from several threads at the same time.
+     *
+     * @param count Number of indices
+     * @param grainSize Number of indices which are processed at once
+     * @param task Function which processes a sub range
+     */
+    void parallelFor(int count, int grainSize, const function<void(int, int)> &task);
+
+private:
+
+    /** Index range of one thread, begin and end are packed for atomic updates */
+    struct Range
+    {
+        atomic<uint64_t> bounds;
+
+        /** Keeps the ranges of different threads in different cache lines */
+        char padding[64 - sizeof(atomic<uint64_t>)];
+    };
+
+    WorkerPool(const WorkerPool &);
+    WorkerPool &operator=(const WorkerPool &);
+
+    /**
+     * Main function of a worker thread.
+     *
+     * @param index Index of the worker (1 - size), 0 is the calling thread
+     */
+    void workerLoop(int index);
+
+    /**
+     * Processes the own range and steals from the other threads
+     * until no work is left.
+     *
+     * @param index Index of the thread
+     */
+    void processRanges(int index);
+
+    /**
+     * Takes the next chunk from the front of the own range.
+     *
+     * @return true if a chunk was taken
+     */
+    bool takeChunk(int index, int &begin, int &end);
+
+    /**
+     * Steals the back half of the range of another thread and
+     * stores it as own range.
+     *
+     * @return true if work was stolen
+     */
+    bool stealRange(int index);
+
+    /** Ranges of all threads */
+    Range *ranges;
+
+    /** Worker threads */
+    vector<thread> workers;
+
+    /** Task of the running loop */
+    const function<void(int, int)> *task;
+
+    /** Grain size of the running loop */
+    int grainSize;
+
+    /** Incremented for every loop to wake up the workers */
+    uint64_t generation;
+
+    /** Number of workers which haven't finished the running loop */
+    int pendingWorkers;
+
+    /** Flag to stop the workers */
+    bool stopWorkers;
+
+    /** Mutex for the loop state above */
+    mutex stateMutex;
+
+    /** Serializes concurrent calls of parallelFor */
+    mutex loopMutex;
+
+    /** Wakes up the workers for a new loop */
+    condition_variable loopStarted;
+
+    /** Signals the end of a loop to the calling thread */
+    condition_variable loopFinished;
+};
+
+#endif // WORKERPOOL_H
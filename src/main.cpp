@@ -22,7 +22,7 @@
  */
 #include <cstdlib>
 #include <cstdio>
-#include "Manipulator.h"
+#include "ArmManager.h"
 #include "OfflineManipulator.h"
 #include "JointController.h"
 #include <QApplication>
@@ -30,35 +30,194 @@
 
 /**
  * Main function:
- * Creates a new manipulator object if a connection is available. Otherwise
- * an offline manipualator is created for testing purpose.
- * The created manipualator object is given to the GUI object for controlling.
+ * Creates a new manipulator object for each arm if a connection is
+ * available. Otherwise an offline manipualator is created for testing purpose.
+ * Each manipualator object is given to its own GUI window for controlling.
  *
- * @param argc Number of given arguments (not used)
- * @param argv List of given arguments (not used)
+ * Options:
+ *   --arm NAME       Controls the arm of config/NAME.cfg, can be given for several arms (default youbot-manipulator)
+ *   --ik-cache       Caches the inverse kinematics of recently used poses
+ *   --command-stats  Prints the timing of the commands and the control thread on exit
+ *   --latency-report FILE  Prints the latency histograms on exit and writes their buckets to FILE
+ *   --record FILE    Records all axis commands and sensed states into FILE (FILE.<arm> for further arms)
+ *   --replay FILE    Replays a recorded FILE with the offline simulator
+ *   --recalibrate    Calibrates the arms even if the stored calibration is valid
+ *
+ * @param argc Number of given arguments
+ * @param argv List of given arguments
  * @return true if program quits successfully
  */
 int main(int argc, char **argv)
 {
     QApplication app(argc, argv);
-    Manipulator *manipulator;
+    ArmManager arms;
+    vector<string> armNames;
+    string replayFile;
+    bool recalibrate = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        replayFile = (string(argv[i]) == "--replay" && i + 1 < argc) ? argv[i + 1] : replayFile;
+        recalibrate = recalibrate || (string(argv[i]) == "--recalibrate");
+
+        if (string(argv[i]) == "--arm" && i + 1 < argc)
+        {
+            armNames.push_back(argv[++i]);
+        }
+    }
+
+    if (armNames.empty())
+    {
+        armNames.push_back("youbot-manipulator");
+    }
+
+    if (!replayFile.empty())
+    {
+        /* A replay never connects to the arm */
+        OfflineManipulator *simulator = new OfflineManipulator();
+        if (!simulator->startReplay(replayFile))
+        {
+            QMessageBox::warning(NULL, "Replay...", "Couldn't read the telemetry log.", QMessageBox::Ok);
+        }
+        arms.addArm(simulator, "replay");
+    }
+    else
+    {
+        for (size_t i = 0; i < armNames.size(); i++)
+        {
+            /* Try to connect to youBot with given configfile, otherwise use offline simulator */
+            if (!arms.addArm(armNames[i], "../config", recalibrate))
+            {
+                QMessageBox::warning(NULL, "No connection to youBot...",
+                            QString("Couldn't connect to %1. Using simulation mode instead.").arg(armNames[i].c_str()),
+                            QMessageBox::Ok);
+                /* The simulated joints behave like the joints of the config file */
+                OfflineManipulator *simulator = new OfflineManipulator();
+                simulator->loadSimulationParameters(armNames[i], "../config");
+                arms.addArm(simulator, armNames[i]);
+                continue;
+            }
 
-    /* Try to connect to youBot, otherwise use offline simulator */
-    try
+            /* A valid calibration is kept, so a restart only takes the time of the connection */
+            StartupTiming startup;
+            arms.getArm(i)->getStartupTiming(startup);
+            printf("Startup [s]:   %.3f %s (%s start)\n", startup.total, armNames[i].c_str(),
+                   startup.warmStart ? "warm" : "cold");
+            printf("               driver %.3f, commutation %.3f, verification %.3f, calibration %.3f, configuration %.3f\n",
+                   startup.driver, startup.commutation, startup.verification, startup.calibration,
+                   startup.configuration);
+        }
+    }
+
+    /* Load the workspace of the arms, the map is generated once if it's missing or outdated */
+    string mapFile = "../config/youbot-reachability.map";
+    if (!arms.getArm(0)->loadReachabilityMap(mapFile))
     {
-        /* Create a manipulator object with given configfile */
-        manipulator = new Manipulator("youbot-manipulator", "../config");
+        ReachabilityMap::generate(mapFile, *arms.getArm(0)->getKinematicsSolver());
+        arms.getArm(0)->loadReachabilityMap(mapFile);
     }
-    catch (exception e)
+
+    for (int a = 1; a < arms.size(); a++)
     {
-        QMessageBox::warning(NULL, "No connection to youBot...",
-                    "Couldn't connect to youBot. Using simulation mode instead.", QMessageBox::Ok);
-        manipulator = new OfflineManipulator();
+        arms.getArm(a)->loadReachabilityMap(mapFile);
     }
 
-    /* Create a new GUI window and pass the manipulator for controlling */
-    JointController gui(manipulator);
-    gui.show();
+    bool commandStatistics = false;
+    string latencyFile;
 
-    return app.exec();
+    for (int i = 1; i < argc; i++)
+    {
+        /* Optional cache for repeated cartesian targets (0.1 mm / 0.1 mrad cells) */
+        if (string(argv[i]) == "--ik-cache")
+        {
+            for (int a = 0; a < arms.size(); a++)
+            {
+                arms.getArm(a)->getKinematicsSolver()->enableCache(4096, 1e-4, 1e-4);
+            }
+        }
+        commandStatistics = commandStatistics || (string(argv[i]) == "--command-stats");
+
+        if (string(argv[i]) == "--latency-report" && i + 1 < argc)
+        {
+            latencyFile = argv[++i];
+        }
+
+        if (string(argv[i]) == "--record" && i + 1 < argc)
+        {
+            string recordFile = argv[++i];
+
+            for (int a = 0; a < arms.size(); a++)
+            {
+                string fileName = (a == 0) ? recordFile : recordFile + "." + arms.getName(a);
+                if (!arms.getArm(a)->startRecording(fileName))
+                {
+                    printf("Couldn't create the telemetry log %s\n", fileName.c_str());
+                }
+            }
+        }
+    }
+
+    LatencyProbes::setThreadName("gui");
+
+    /* Create a new GUI window for each arm and pass the manipulator for controlling */
+    vector<JointController *> windows;
+    for (int a = 0; a < arms.size(); a++)
+    {
+        JointController *gui = new JointController(arms.getArm(a));
+        if (arms.size() > 1)
+        {
+            gui->setWindowTitle(QString("%1 - %2").arg(gui->windowTitle()).arg(arms.getName(a).c_str()));
+        }
+        gui->show();
+        windows.push_back(gui);
+    }
+
+    int result = app.exec();
+
+    for (size_t a = 0; a < windows.size(); a++)
+    {
+        delete windows[a];
+    }
+
+    for (int a = 0; a < arms.size(); a++)
+    {
+        Manipulator *manipulator = arms.getArm(a);
+
+        if (arms.size() > 1)
+        {
+            printf("%s (core %d):\n", arms.getName(a).c_str(), arms.getCore(a));
+        }
+
+        if (commandStatistics)
+        {
+            CommandStatistics statistics;
+            manipulator->getCommandStatistics(statistics);
+            printf("Axis commands: %lu (%lu unchanged joints skipped)\n", statistics.commands, statistics.skippedJoints);
+            printf("Latency [us]:  mean %.1f, max. %.1f\n", statistics.meanLatency, statistics.maxLatency);
+            printf("Skew [us]:     max. %.1f\n", statistics.maxSkew);
+
+            CycleStatistics cycles;
+            manipulator->getCycleStatistics(cycles);
+            printf("Cycles:        %lu (%lu overruns)\n", cycles.cycles, cycles.overruns);
+            printf("Jitter [us]:   mean %.1f, max. %.1f (max. execution time %.1f)\n", cycles.meanJitter, cycles.maxJitter,
+                   cycles.maxExecutionTime);
+        }
+
+        RecorderStatistics recording;
+        manipulator->stopRecording();
+        manipulator->getRecorderStatistics(recording);
+
+        if (recording.records > 0)
+        {
+            printf("Telemetry:     %llu records (%llu dropped)\n", (unsigned long long) recording.records,
+                   (unsigned long long) recording.dropped);
+        }
+    }
+
+    if (!latencyFile.empty())
+    {
+        LatencyProbes::printReport(stdout);
+        LatencyProbes::writeFile(latencyFile);
+    }
+    return result;
 }
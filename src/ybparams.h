@@ -26,6 +26,11 @@
 #include <cmath>
 #include <string>
 
+#ifndef ARMJOINTS
+/** The number of manipulator joints (same value as used by the youBot API) */
+#define ARMJOINTS 5
+#endif
+
 /** Bottom limits of the angles defined in the datasheet. */
 const double BOTTOM_LIMIT_SD[5] = {-2.949606, // -169 Degree
                                    -1.134464, // -65 Degree
@@ -40,6 +45,16 @@ const double TOP_LIMIT_SD[5] = {2.949606, // 169 Degree
                                 1.788962, // 102.5 Degree
                                 2.923426};// 167.5 Degree
 
+/**
+ * Offsets from kuka angles (0 is at the bottom limit, joint 3 at the top
+ * limit) to angles (0 is centered): angle = kuka angle + offset.
+ */
+const double KUKA_ANGLE_OFFSET[5] = {BOTTOM_LIMIT_SD[0],
+                                     BOTTOM_LIMIT_SD[1],
+                                     TOP_LIMIT_SD[2],
+                                     BOTTOM_LIMIT_SD[3],
+                                     BOTTOM_LIMIT_SD[4]};
+
 /** Bottom limits of the angles defined by the motor controllers */
 const double BOTTOM_LIMIT_YB[5] = {0.0100692,
                                    0.0100692,
@@ -54,36 +69,129 @@ const double TOP_LIMIT_YB[5] = {5.84014,
                                 3.4292,
                                 5.64159};
 
+/** Maximum angular velocity of the joints in radian per second (90 degree per second) */
+const double MAX_VELOCITY_SD[5] = {1.570796,
+                                   1.570796,
+                                   1.570796,
+                                   1.570796,
+                                   1.570796};
+
+/** Maximum angular acceleration of the joints in radian per second squared */
+const double MAX_ACCELERATION_SD[5] = {2.0,
+                                       2.0,
+                                       2.0,
+                                       2.0,
+                                       2.0};
+
+/** Maximum angular jerk of the joints in radian per second cubed */
+const double MAX_JERK_SD[5] = {10.0,
+                               10.0,
+                               10.0,
+                               10.0,
+                               10.0};
+
+/** Default cycle time of the EtherCAT communication in microseconds (EtherCATUpdateRate_[usec]) */
+const int DEFAULT_CYCLE_TIME_US = 1000;
+
+/** Capacity of the trajectory buffer in setpoints (60 seconds with 1 ms cycle time) */
+const int MAX_TRAJECTORY_SETPOINTS = 60000;
+
+/** Distance a joint has to move until a motion counts as started in radian */
+const double MOTION_START_THRESHOLD = 0.001;
+
+/** Length of the telemetry history in seconds (one sample per cycle) */
+const double TELEMETRY_HISTORY_SECONDS = 10;
+
+/** Priority of the control thread (SCHED_FIFO, needs root permissions) */
+const int CONTROL_THREAD_PRIORITY = 50;
+
+/** Default position tolerance of an arrived motion in radian (1 degree) */
+const double ARRIVAL_POSITION_TOLERANCE = 0.01745;
+
+/** Default velocity tolerance of an arrived motion in radian per second */
+const double ARRIVAL_VELOCITY_TOLERANCE = 0.05;
+
+/** Default time the arm has to stay within the arrival tolerances in seconds */
+const double ARRIVAL_SETTLE_TIME = 0.005;
+
 /** Limits of the gripper space */
 const double GRIPPER_LIMIT[2] = {0,
                                  0.023};
 
-/** DH-Parameter: Theta */
-const double DH_THETA[5] = {0,
-                            0,
-                            0,
-                            0,
-                            0};
+/** Velocity of the gripper spacing in meter per second (about 2 seconds from closed to open) */
+const double GRIPPER_VELOCITY = 0.0115;
 
-/** DH-Parameter: D */
-const double DH_D[5] = {0,
-                        0,
-                        0,
-                        0,
-                        0};
+/** Time before the arrival at which a pose program starts to move the gripper in seconds */
+const double GRIPPER_LEAD_TIME = 0.3;
 
-/** DH-Parameter: R */
-const double DH_R[5] = {0,
-                        0,
-                        0,
-                        0,
-                        0};
+/** Gains of the simulated joint controllers (trajectory_controller_P/I/D of youbot-manipulator.cfg) */
+const double SIMULATION_P = 20;
+const double SIMULATION_I = 1;
+const double SIMULATION_D = 0;
 
-/** DH-Parameter: Alpha */
-const double DH_ALPHA[5] = {0,
+/** Limit of the integral term of the simulated joint controllers in radian per second */
+const double SIMULATION_I_LIMIT = 1000;
+
+/** Time a simulated motion may take longer than its trajectory before it counts as failed in seconds */
+const double SIMULATION_ARRIVAL_TIMEOUT = 10;
+
+/** Default relative variation of the joint limits, controller gains and arrival tolerances of a Monte Carlo run */
+const double VARIATION_LIMITS = 0.1;
+const double VARIATION_GAINS = 0.2;
+const double VARIATION_TOLERANCES = 0.2;
+
+/** Default standard deviation of the tcp noise of a Monte Carlo run in meter and radian */
+const double VARIATION_POSITION_NOISE = 0.001;
+const double VARIATION_ORIENTATION_NOISE = 0.005;
+
+/** Number of the user variable the driver sets after it calibrated a joint */
+const int CALIBRATION_FLAG_VARIABLE = 16;
+
+/** Maximum distance between the stored angles and the encoders for a warm start in radian (5 degree) */
+const double CALIBRATION_POSITION_TOLERANCE = 0.0873;
+
+/**
+ * DH-Parameter: Theta (offset added to the joint angle).
+ * The offsets are chosen so that all angles equal to zero describe the
+ * candle position, i.e. the arm pointing straight up.
+ */
+constexpr double DH_THETA[5] = {0,
+                                -M_PI_2,
+                                0,
+                                M_PI_2,
+                                0};
+
+/** DH-Parameter: D in meter */
+constexpr double DH_D[5] = {0.147,
                             0,
                             0,
                             0,
+                            0.2175};
+
+/** DH-Parameter: R in meter */
+constexpr double DH_R[5] = {0.033,
+                            0.155,
+                            0.135,
+                            0,
                             0};
 
+/** DH-Parameter: Alpha */
+constexpr double DH_ALPHA[5] = {-M_PI_2,
+                                0,
+                                0,
+                                M_PI_2,
+                                0};
+
+/**
+ * DH parameters of the youBot arm as compile time constants
+ * for the KinematicChain template.
+ */
+struct YouBotDH
+{
+    static constexpr double theta(int joint) { return DH_THETA[joint]; }
+    static constexpr double d(int joint) { return DH_D[joint]; }
+    static constexpr double r(int joint) { return DH_R[joint]; }
+    static constexpr double alpha(int joint) { return DH_ALPHA[joint]; }
+};
+
 #endif // YBPARAMS_H